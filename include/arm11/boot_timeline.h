@@ -0,0 +1,47 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "types.h"
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define BOOT_TIMELINE_MAX_MARKS  (24u)
+
+
+
+// Starts the cycle counter. Everything timed with it must use differences from here on.
+void bootTimelineStart(void);
+
+// Records the end of a boot phase. name must be a string literal.
+// Does nothing after bootTimelineWrite().
+void bootTimelineMark(const char *const name);
+
+// Writes "boot_timeline.txt" to the work dir if bootTimeline is enabled in the config.
+// Only the first call does anything.
+void bootTimelineWrite(void);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
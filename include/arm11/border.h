@@ -0,0 +1,43 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "types.h"
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define BORDER_WIDTH   (400u)
+#define BORDER_HEIGHT  (240u)
+#define BORDER_SIZE    (BORDER_WIDTH * BORDER_HEIGHT * 3)
+
+
+
+// Loads border.qoi (a regular 400x240 QOI image) or the raw border.bgr into fb.
+// fb gets the top LCD frame buffer layout (BGR8, rotated) and is flushed from the cache.
+// Returns RES_FR_NO_FILE if neither exists.
+Result borderLoad(void *const fb);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,66 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "types.h"
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define COLOR_LUT_ADDR     (0x1FF00000u)  // 2 tables back to back. The converter uses one at a time.
+#define COLOR_LUT_SIZE     (4u * 32768)
+#define COLOR_PROFILE_NUM  (8u)           // Not counting "none".
+
+
+// Color correction done by the GPU instead of the table.
+typedef struct
+{
+	u8 exponent;      // The GPU linearizes with x² or x³.
+	u32 matrix[5];    // Constant colors for red, green and blue input followed by the negative blue and green parts.
+	u8 gamma[3][256]; // Per channel display value for each GPU output value.
+} ColorLutGpu;
+
+
+
+// Loads the table for the g_oafConfig color settings from the cache or computes it.
+// Half of it is computed by a core 1 job. Must be called before core 1 is handed over to the converter.
+void colorLutInit(void);
+
+// Rebuilds the table for the current g_oafConfig color settings in the background.
+// Both cores build it and it is swapped in on a frame boundary.
+void colorLutRequestRebuild(void);
+
+// Called by core 0 once per frame.
+void colorLutUpdate(void);
+
+// Called by core 1 before each frame. Builds one slice of a pending table
+// and returns the table to use for the frame.
+const u32* colorLutCore1Work(void);
+
+// Computes the GPU color correction for the g_oafConfig color settings.
+// Only approximates the table, mostly for saturated colors.
+void colorLutGetGpu(ColorLutGpu *const gpu);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
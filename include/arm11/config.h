@@ -30,6 +30,8 @@ extern "C"
 #define OAF_WORK_DIR        "sdmc:/3ds/open_agb_firm"
 #define OAF_SAVE_DIR        "saves"       // Relative to work dir.
 #define OAF_SCREENSHOT_DIR  "screenshots" // Relative to work dir.
+#define OAF_RECORDING_DIR   "recordings"  // Relative to work dir.
+#define OAF_LIBRARY_DIR     "library"     // Relative to work dir.
 
 
 typedef struct
@@ -47,6 +49,8 @@ typedef struct
 	float contrast;     // Range 0.0-1.0.
 	float brightness;   // Range 0.0-1.0.
 	float saturation;   // Range 0.0-1.0.
+	bool gpuColorCorrection;
+	bool framePacing;
 
 	// [audio]
 	u8 audioOut;        // 0 = auto, 1 = speakers, 2 = headphones.
@@ -63,6 +67,11 @@ typedef struct
 	// [advanced]
 	bool saveOverride;
 	u16 defaultSave; // TODO: Should be u8. Investigate if u8 has any downsides.
+	bool cachePatches;
+	bool frameStats;
+	bool bootTimeline;
+	u8 screenshotBurst;
+	u8 inputPolls;
 } OafConfig;
 
 extern OafConfig g_oafConfig; // Global config in config.c.
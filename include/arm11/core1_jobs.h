@@ -0,0 +1,53 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "types.h"
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef void (*Core1JobFn)(void *arg);
+
+
+
+// Core 1 has its own data cache. The submitter must flush everything a job reads,
+// the job must clean everything it writes and the waiter must invalidate it again.
+
+// Boots core 1 into the job loop. Must be called once before everything else.
+void core1JobsInit(void);
+
+// Queues fn(arg) for core 1 and returns a ticket for core1JobWait().
+// Runs fn(arg) right away and returns 0 if core 1 doesn't take jobs (anymore).
+u32 core1JobSubmit(Core1JobFn fn, void *arg);
+
+// Waits until the job with this ticket and all before it are done. 0 returns immediately.
+void core1JobWait(const u32 ticket);
+
+// Waits for all queued jobs and then lets core 1 jump to entry for good.
+// Later jobs run on core 0.
+void core1JobsHandover(void (*entry)(void));
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
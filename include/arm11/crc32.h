@@ -0,0 +1,37 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Standard CRC-32 (same as zlib). Start with crc = 0.
+u32 crc32Update(u32 crc, const void *data, u32 size);
+
+// Updates 2 CRCs with the same data. Faster than 2 crc32Update() calls.
+void crc32UpdateDual(u32 *const crcA, u32 *const crcB, const void *data, u32 size);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,62 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// The ARM11 MPCore cycle counter (CP15 c15 performance monitor).
+// It counts every 64 CPU cycles so it wraps after about 17 minutes.
+#define CYCLE_COUNTER_DIV   (64u)
+#define CYCLE_COUNTER_FREQ  (268111856u / CYCLE_COUNTER_DIV)
+
+
+
+// Enables and resets the cycle counter.
+static inline void cycleCounterStart(void)
+{
+	// E (enable), C (reset cycle counter) and D (count every 64 cycles).
+	__asm__ volatile("mcr p15, 0, %0, c15, c12, 0" : : "r" (1u | 1u<<2 | 1u<<3) : "memory");
+}
+
+static inline u32 cycleCounterRead(void)
+{
+	u32 ticks;
+	__asm__ volatile("mrc p15, 0, %0, c15, c12, 1" : "=r" (ticks) : : "memory");
+	return ticks;
+}
+
+static inline u32 cycleCounterToMs(const u32 ticks)
+{
+	return (u32)((u64)ticks * 1000 / CYCLE_COUNTER_FREQ);
+}
+
+static inline u32 cycleCounterToUs(const u32 ticks)
+{
+	return (u32)((u64)ticks * 1000000 / CYCLE_COUNTER_FREQ);
+}
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,51 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "types.h"
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// GBA frame timing. 280896 cycles at 16.78 MHz.
+#define GBA_CPU_FREQ      (16777216u)
+#define GBA_FRAME_CYCLES  (280896u)
+#define GBA_FRAME_US      (16743u)                                 // Rounded.
+#define GBA_FPS           ((float)GBA_CPU_FREQ / GBA_FRAME_CYCLES) // About 59.73 Hz.
+
+
+
+// Remembers the top LCD timing. Pacing is only done if framePacing is enabled in the config.
+void framePacingInit(void);
+
+// Called by the frame handler right after wakeup. Measures where the top LCD is
+// in its frame and stretches or shortens the next LCD frame by a few lines to keep
+// capture done just ahead of LCD VBlank. Returns the phase error in µs.
+u32 framePacingUpdate(void);
+
+// Restores the original top LCD timing.
+void framePacingExit(void);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
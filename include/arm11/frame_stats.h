@@ -0,0 +1,73 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "types.h"
+#include "arm11/cycle_counter.h"
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Timestamps taken on core 0 for each frame.
+typedef enum
+{
+	FRAME_MARK_START    = 0u, // Conversion finished IPI or frame handler wakeup without core 1.
+	FRAME_MARK_WAKE     = 1u, // Frame handler wakeup.
+	FRAME_MARK_P3D      = 2u, // GPU rendering done.
+	FRAME_MARK_TRANSFER = 3u, // Display transfer started.
+	FRAME_MARK_PPF      = 4u, // Display transfer done.
+	FRAME_MARK_SWAP     = 5u, // Buffers swapped.
+	FRAME_MARK_CAPTURE  = 6u, // Screenshot and recording copies done.
+	FRAME_MARK_INPUT    = 7u, // Newest input state pushed to the GBA at frame handler wakeup.
+	FRAME_MARK_NUM      = 8u
+} FrameMark;
+
+typedef struct
+{
+	u32 t[FRAME_MARK_NUM];
+	u32 phaseErrUs; // Capture done to LCD position error from framePacingUpdate().
+} FrameTimes;
+
+
+
+// The cycle counter is started by bootTimelineStart().
+static inline u32 frameStatsNow(void)
+{
+	return cycleCounterRead();
+}
+
+// Resets all stats. Does nothing unless frameStats is enabled in the config.
+void frameStatsInit(const u8 scaler);
+
+// Adds the stage times of one finished frame.
+void frameStatsAdd(const FrameTimes *const times);
+
+// Call when frames were intentionally skipped. The gap is not counted as a period or missed frames.
+void frameStatsResume(void);
+
+// Writes the stats to "frame_stats.txt" in the work dir.
+Result frameStatsDump(void);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -18,6 +18,7 @@
  *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+
 #include "types.h"
 
 
@@ -27,19 +28,46 @@ extern "C"
 #endif
 
 #define GPU_RENDER_BUF_ADDR  (0x18180000)
+#define GPU_RENDER_BUF2_ADDR (0x18280000) // After the 512x512 A1BGR5 texture.
 #define GPU_TEXTURE_ADDR     (0x18200000)
 #define GPU_TEXTURE2_ADDR    (0x18300000)
-#define GBA_INIT_LIST_SIZE   (1136)
-#define GBA_LIST2_SIZE       (448)
+#define GBA_INIT_LIST_WORDS  (288u)       // Capacity. The built size is in gbaGpuInitListSize.
+#define GBA_LIST2_WORDS      (64u)
+
+// PICA200 texture formats.
+#define GPU_TEX_RGBA8        (0u)
+#define GPU_TEX_RGB5A1       (2u)
 
 
-extern u8 gbaGpuInitList[GBA_INIT_LIST_SIZE];
-extern u8 gbaGpuList2[GBA_LIST2_SIZE];
+// Describes how the frame in the 512x512 texture is drawn to the 400x240 top screen.
+typedef struct
+{
+	u32 texAddr;
+	u8 texFormat;   // GPU_TEX_... .
+	bool linear;    // Bilinear magnification instead of nearest.
+	u16 srcW, srcH; // Frame size. The frame starts in the top left corner of the texture.
+	u16 dstX, dstY;
+	u16 dstW, dstH;
+} GbaGpuLayout;
+
+// The init list sets up all state and draws the first frame.
+// gbaGpuList2 only has what changes each frame (render buffer and draw).
+extern u32 gbaGpuInitList[GBA_INIT_LIST_WORDS];
+extern u32 gbaGpuList2[GBA_LIST2_WORDS];
+extern u32 gbaGpuInitListSize; // In bytes.
+extern u32 gbaGpuList2Size;
 
 
 
-void patchGbaGpuCmdList(const u8 scaleType, const bool useSecondTexture);
+// Builds both lists for the layout. Resets the color correction setup.
+void buildGbaGpuCmdLists(const GbaGpuLayout *const layout);
+
+// Sets the color buffer the lists render to.
+void patchGbaGpuCmdListRenderBuf(const u32 addr);
+
+// Programs the texture combiners for color correction on the GPU. See colorLutGetGpu().
+void patchGbaGpuCmdListColor(const u8 exponent, const u32 matrix[5]);
 
 #ifdef __cplusplus
 } // extern "C"
-#endif
\ No newline at end of file
+#endif
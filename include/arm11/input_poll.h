@@ -0,0 +1,45 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "types.h"
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Builds the button remap table from g_oafConfig.buttonMaps and starts
+// the poll task if inputPolls is above 1. Returns the LGY11 override mask.
+// The polls are timed by the MPCore watchdog so TIMER_sleep*() keeps working.
+u16 inputPollInit(void);
+
+// Pushes the remapped state of the last hidScanInput() call. Called once per frame.
+void inputPollUpdate(const u32 kHeld);
+
+// Cycle counter time of the newest input state pushed to the GBA.
+u32 inputPollLastTime(void);
+
+void inputPollExit(void);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -22,4 +22,14 @@
 
 
 KHandle OAF_videoInit(void);
+
+// Recomputes GPU color correction for the current g_oafConfig color settings.
+// Only used with gpuColorCorrection enabled.
+void OAF_videoUpdateGpuColor(void);
+// Pauses color conversion, rendering and display transfers while nothing is visible.
+// LgyCap keeps running. Rendering resumes with the next frame.
+void OAF_videoPauseRender(const bool pause);
+
+// Called by core 1 in between frames. Drains LgyCap IRQs while rendering is paused.
+void OAF_videoCore1Pause(void);
 void OAF_videoExit(void);
\ No newline at end of file
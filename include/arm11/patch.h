@@ -25,7 +25,7 @@ extern "C"
 {
 #endif
 
-Result patchRom(const char *const gamePath, u32 *romSize);
+Result patchRom(const char *const gamePath, u32 *romSize, const u64 baseSha1);
 
 #ifdef __cplusplus
 } // extern "C"
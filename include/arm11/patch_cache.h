@@ -0,0 +1,63 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+#include "error_codes.h"
+#include "arm11/rom_cache.h"
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define PATCH_CACHE_DIR  "patch_cache" // Relative to work dir.
+
+
+typedef struct
+{
+	u32 offset;
+	u32 size;
+} PatchRun;
+
+// Records which ROM areas a patch changed.
+typedef struct
+{
+	PatchRun *runs;
+	u32 count;
+	u32 capacity;
+	u32 fillStart; // 0xFF fill after resizing the ROM. fillStart == fillEnd if none.
+	u32 fillEnd;
+	bool overflow; // Out of memory. The delta is incomplete.
+} PatchDelta;
+
+
+
+void patchDeltaInit(PatchDelta *const delta);
+void patchDeltaAdd(PatchDelta *const delta, const u32 offset, const u32 size); // delta can be NULL.
+void patchDeltaFree(PatchDelta *const delta);
+
+// Returns RES_NOT_FOUND without touching the ROM if there is no valid cache file.
+Result patchCacheLoad(const RomCacheKey *const key, const u64 baseSha1, u32 *const romSize);
+Result patchCacheStore(const RomCacheKey *const key, const u64 baseSha1, const u32 romSize, const PatchDelta *const delta);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,91 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+#include "error_codes.h"
+#include "fs.h"
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define PATCH_STREAM_CHUNK_SIZE  (0x10000u) // 64 KiB.
+#define PATCH_STREAM_CHUNKS      (4u)       // Ring buffer size in chunks.
+
+
+// Reads a patch file in chunks with a reader task while the
+// chunks already received are being applied.
+typedef struct
+{
+	const u8 *ptr;    // Next byte.
+	const u8 *end;    // End of the current chunk.
+	u32 endOffset;    // Stream offset of end.
+	u32 size;         // Stream size.
+	u32 crc;          // CRC-32 of all received bytes below crcEnd.
+	u32 crcEnd;
+	u32 nextChunk;
+	u8 *buf;
+
+	// Shared with the reader task.
+	FHandle f;
+	volatile u32 chunksFilled;
+	volatile u32 chunksReleased;
+	volatile bool abort;
+	volatile bool done;
+	Result res;
+} PatchStream;
+
+
+
+// Streams the whole file from the start. crcEnd limits the CRC (0 for none).
+Result patchStreamStart(PatchStream *const s, const FHandle f, const u32 crcEnd);
+Result patchStreamNextChunk(PatchStream *const s); // RES_INVALID_PATCH at the end of the stream.
+Result patchStreamRead(PatchStream *const s, void *dst, u32 size);
+Result patchStreamSkip(PatchStream *const s, u32 size);
+void patchStreamEnd(PatchStream *const s);
+
+static inline u32 patchStreamTell(const PatchStream *const s)
+{
+	return s->endOffset - (u32)(s->end - s->ptr);
+}
+
+static inline u32 patchStreamAvail(const PatchStream *const s)
+{
+	return (u32)(s->end - s->ptr);
+}
+
+static inline Result patchStreamReadByte(PatchStream *const s, u8 *const out)
+{
+	if(s->ptr == s->end)
+	{
+		const Result res = patchStreamNextChunk(s);
+		if(res != RES_OK) return res;
+	}
+
+	*out = *s->ptr++;
+
+	return RES_OK;
+}
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
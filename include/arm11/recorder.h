@@ -0,0 +1,98 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "types.h"
+#include "drivers/lgy_common.h"
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Unused FCRAM after the ROM.
+#define RECORD_FRAME_ADDR   (LGY_ROM_LOC + LGY_MAX_ROM_SIZE)
+#define RECORD_FRAME_SIZE   (0x30000u)  // Fits a 360x240 A1BGR5 frame.
+#define RECORD_FRAMES       (4u)        // 1 reference frame for deltas + 3 queued.
+#define RECORD_STAGE_ADDR   (RECORD_FRAME_ADDR + RECORD_FRAME_SIZE * RECORD_FRAMES)
+#define RECORD_STAGE_SIZE   (0xC0000u)  // Worst case encoded 360x240 frame.
+#define RECORD_RING_ADDR    (RECORD_STAGE_ADDR + RECORD_STAGE_SIZE)
+#define RECORD_RING_SIZE    (0x400000u) // 4 MiB.
+#define RECORD_WRITE_SIZE   (0x40000u)  // SD writes are done in 256 KiB pieces.
+#define RECORD_WRITE_CHUNK  (0x8000u)   // Max size of a single fWrite() call.
+
+// File layout (little endian):
+// RecFileHeader followed by one RecFrameHeader + payload per encoded frame.
+// The payload is a list of u16 ops. Bits 14-15 are the op and bits 0-13 the pixel count - 1.
+#define RECORD_OP_SKIP      (0u<<14) // Pixels are unchanged from the last encoded frame.
+#define RECORD_OP_FILL      (1u<<14) // 1 pixel follows which is repeated.
+#define RECORD_OP_LITERAL   (2u<<14) // count pixels follow.
+#define RECORD_FLAG_KEY     (1u)     // Frame is coded against a black frame.
+
+typedef struct
+{
+	char magic[4]; // "OAFR"
+	u16 version;   // 1
+	u16 width;
+	u16 height;
+	u16 format;    // 0 = A1BGR5 like LgyCap (R in bits 11-15).
+} RecFileHeader;
+
+typedef struct
+{
+	u32 size;      // Payload size in bytes.
+	u16 flags;
+	u16 dropped;   // Frames not encoded since the last frame.
+} RecFrameHeader;
+
+typedef struct
+{
+	u32 frames;    // Encoded frames.
+	u32 dropped;   // Frames skipped because the encoder was busy.
+	u32 bytes;     // File size so far.
+	u32 maxRing;   // Ring buffer high water mark in bytes.
+} RecorderStats;
+
+
+
+// Starts recording w x h frames to a new file in OAF_RECORDING_DIR.
+// Encoding and SD writes are done by 2 low priority tasks.
+void recorderStart(const u16 w, const u16 h);
+
+// Stops recording. Queued frames are still written.
+void recorderStop(void);
+
+// Returns true while recording or still writing the file.
+bool recorderIsActive(void);
+
+// Copies the frame in the swizzled 512 pixels wide A1BGR5 texture at tex.
+// This is the only part running in the display path. It never waits for the encoder.
+// Note: Uses PPF. It must be idle.
+void recorderAddFrame(const u32 *const tex);
+
+void recorderGetStats(RecorderStats *const stats);
+
+// Stops recording and waits until the file is written.
+void recorderExit(void);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
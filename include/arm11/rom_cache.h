@@ -0,0 +1,60 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include "types.h"
+#include "error_codes.h"
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define ROM_CACHE_PATH  "rom_cache.bin" // Relative to work dir.
+
+
+typedef struct
+{
+	u32 pathHash;  // FNV-1a over the full ROM path.
+	u32 fileSize;
+	u32 fileTime;  // FAT date<<16 | FAT time.
+	u32 patchSize; // 0 if no patch file exists.
+	u32 patchTime; // FAT date<<16 | FAT time of the patch file.
+} RomCacheKey;
+
+typedef struct
+{
+	RomCacheKey key;
+	u16 saveType; // Save type from the SDK save string. 0xFF if none.
+	u16 reserved;
+	u64 sha1;     // First 8 bytes of the SHA-1 over the padded, unpatched ROM.
+} RomCacheEntry;
+static_assert(sizeof(RomCacheEntry) == 32, "Error: ROM cache entry struct is not packed!");
+
+
+
+Result romCacheMakeKey(const char *const romPath, RomCacheKey *const key);
+bool romCacheLookup(const RomCacheKey *const key, RomCacheEntry *const entry);
+Result romCacheStore(const RomCacheEntry *const entry);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
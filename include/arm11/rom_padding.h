@@ -0,0 +1,43 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// The CPU pads at least this many bytes after the end of the ROM file
+// (less if the padded ROM size is reached first). Everything after
+// that is padded by the GX engines in the background.
+#define ROM_PADDING_CPU_BYTES  (256u)
+
+
+
+// Returns the padded but unmirrored ROM size. The ROM area past the
+// CPU padded bytes must not be touched until romPaddingWait() returns.
+u32 romPaddingStart(const u32 romFileSize);
+void romPaddingWait(void); // Does nothing if no padding is in progress.
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
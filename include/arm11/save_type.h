@@ -28,6 +28,21 @@ extern "C"
 {
 #endif
 
+#define GBA_DB_MAGIC    (0x42444247u) // "GBDB"
+#define GBA_DB_VERSION  (1u)
+
+
+typedef struct
+{
+	u32 magic;       // "GBDB"
+	u16 version;
+	u16 entrySize;
+	u32 entryCount;
+	u32 reserved;
+	u16 fanout[256]; // Index of the first entry after each bucket. Indexed by the first SHA1 byte.
+} GbaDbHeader;
+static_assert(sizeof(GbaDbHeader) == 528, "Error: GBA DB header struct is not packed!");
+
 typedef struct
 {
 	u8 sha1[20];
@@ -36,10 +51,21 @@ typedef struct
 } GbaDbEntry;
 static_assert(sizeof(GbaDbEntry) == 28, "Error: GBA DB entry struct is not packed!");
 
+// Save string scan state. Can be fed with partially loaded ROMs.
+typedef struct
+{
+	u32 offset;   // ROM offset of the next word to scan.
+	u16 saveType; // Save type from the SDK save string. 0xFF if none found (yet).
+} SaveTypeScan;
+
 
 
-u16 detectSaveType(const u32 romSize, const u16 defaultSave);
-u16 getSaveType(const OafConfig *const cfg, const u32 romSize, const char *const savePath);
+void saveTypeScanInit(SaveTypeScan *const scan);
+void saveTypeScanUpdate(SaveTypeScan *const scan, const u32 size);
+void saveTypeScanFinish(SaveTypeScan *const scan, const u32 romSize);
+void saveTypeScanSetResult(SaveTypeScan *const scan, const u16 saveType);
+u16 detectSaveType(SaveTypeScan *const scan, const u32 romSize, const u16 defaultSave);
+u16 getSaveType(const OafConfig *const cfg, const u32 romSize, const u64 sha1, const u16 autoSaveType, const char *const savePath);
 
 #ifdef __cplusplus
 } // extern "C"
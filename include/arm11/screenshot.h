@@ -0,0 +1,50 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "types.h"
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define SCREENSHOT_SLOT_ADDR  (0x18400000u) // VRAM after the second texture.
+#define SCREENSHOT_SLOT_SIZE  (0x2C000u)    // Fits a 360x240 A1BGR5 frame.
+#define SCREENSHOT_SLOTS      (8u)
+
+
+
+// Starts the low priority task writing queued screenshots to SD.
+void screenshotInit(void);
+
+// Copies a frame out of the swizzled 512 pixels wide A1BGR5 texture at tex into a free slot.
+// seq 0 is a single screenshot and 1-255 is the frame number in a burst.
+// Returns false and drops the frame if all slots are in use.
+// Note: Uses PPF. It must be idle.
+bool screenshotQueue(const u32 *const tex, const u16 w, const u16 h, const u8 seq);
+
+// Waits until all queued screenshots are written and stops the task.
+void screenshotExit(void);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -34,8 +34,10 @@ enum
 	// Custom errors.
 	RES_ROM_TOO_BIG            = MAKE_CUSTOM_ERR(0u),
 	RES_INVALID_PATCH          = MAKE_CUSTOM_ERR(1u),
+	RES_PATCH_CRC_MISMATCH     = MAKE_CUSTOM_ERR(2u),
+	RES_INVALID_BORDER         = MAKE_CUSTOM_ERR(3u),
 
-	MAX_OAF_RES_VALUE          = RES_INVALID_PATCH
+	MAX_OAF_RES_VALUE          = RES_INVALID_BORDER
 };
 
 #undef MAKE_CUSTOM_ERR
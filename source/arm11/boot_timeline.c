@@ -0,0 +1,85 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+#include "arm11/boot_timeline.h"
+#include "arm11/config.h"
+#include "arm11/cycle_counter.h"
+#include "arm11/fmt.h"
+#include "fsutil.h"
+#include "oaf_error_codes.h"
+
+
+#define BOOT_TIMELINE_PATH  "boot_timeline.txt" // Relative to work dir.
+
+
+typedef struct
+{
+	const char *name;
+	u32 ticks;
+} BootMark;
+
+typedef struct
+{
+	u32 start;
+	u32 num;
+	bool written;
+	BootMark marks[BOOT_TIMELINE_MAX_MARKS];
+} BootTimeline;
+
+static BootTimeline g_bootTimeline = {0};
+
+
+
+void bootTimelineStart(void)
+{
+	cycleCounterStart();
+	g_bootTimeline.start = cycleCounterRead();
+}
+
+void bootTimelineMark(const char *const name)
+{
+	BootTimeline *const t = &g_bootTimeline;
+	if(t->written || t->num >= BOOT_TIMELINE_MAX_MARKS) return;
+
+	t->marks[t->num].name  = name;
+	t->marks[t->num].ticks = cycleCounterRead();
+	t->num++;
+}
+
+void bootTimelineWrite(void)
+{
+	BootTimeline *const t = &g_bootTimeline;
+	if(t->written) return;
+	t->written = true;
+	if(!g_oafConfig.bootTimeline) return;
+
+	// One line per phase: name, phase duration and time since start in µs.
+	static char buf[BOOT_TIMELINE_MAX_MARKS * 48];
+	u32 len = 0;
+	u32 last = t->start;
+	for(u32 i = 0; i < t->num; i++)
+	{
+		const BootMark *const m = &t->marks[i];
+		len += ee_sprintf(&buf[len], "%s: %lu %lu\n", m->name, cycleCounterToUs(m->ticks - last), cycleCounterToUs(m->ticks - t->start));
+		last = m->ticks;
+	}
+	debug_printf("%s", buf);
+	const Result res = fsQuickWrite(BOOT_TIMELINE_PATH, buf, len);
+	if(res != RES_OK) debug_printf("Failed to write boot timeline: %s\n", result2String(res));
+}
@@ -0,0 +1,207 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "types.h"
+#include "arm11/border.h"
+#include "oaf_error_codes.h"
+#include "fs.h"
+#include "fsutil.h"
+#include "drivers/cache.h"
+
+
+#define BORDER_QOI_PATH   "border.qoi"   // Relative to work dir.
+#define BORDER_RAW_PATH   "border.bgr"
+#define QOI_HEADER_SIZE   (14u)
+#define QOI_OP_INDEX      (0x00u)
+#define QOI_OP_DIFF       (0x40u)
+#define QOI_OP_LUMA       (0x80u)
+#define QOI_OP_RUN        (0xC0u)
+#define QOI_OP_RGB        (0xFEu)
+#define QOI_OP_RGBA       (0xFFu)
+#define BAND_ROWS         (8u)           // Rows decoded before they are rotated into the frame buffer.
+#define QOI_BUF_SIZE      (0x4000u)
+
+
+typedef struct
+{
+	FHandle f;
+	u32 pos;
+	u32 avail;
+	Result res;
+	alignas(4) u8 buf[QOI_BUF_SIZE];
+} QoiReader;
+
+typedef struct
+{
+	QoiReader stream;
+	u8 band[BAND_ROWS][BORDER_WIDTH * 3];
+} BorderDecoder;
+
+
+
+static NOINLINE u8 qoiRefill(QoiReader *const s)
+{
+	// Reading past the end gives zeros. The pixel count is fixed so the decode still ends.
+	u32 bytesRead = 0;
+	if(s->res == RES_OK) s->res = fRead(s->f, s->buf, QOI_BUF_SIZE, &bytesRead);
+	if(bytesRead == 0)
+	{
+		if(s->res == RES_OK) s->res = RES_INVALID_BORDER;
+		return 0;
+	}
+
+	s->pos   = 1;
+	s->avail = bytesRead;
+
+	return s->buf[0];
+}
+
+static inline u8 qoiGetU8(QoiReader *const s)
+{
+	return (s->pos < s->avail ? s->buf[s->pos++] : qoiRefill(s));
+}
+
+static inline u32 qoiGetU32BE(const u8 *const p)
+{
+	return (u32)p[0]<<24 | (u32)p[1]<<16 | (u32)p[2]<<8 | p[3];
+}
+
+// Frame buffer pixel (x, y) is at ((x * 240) + (239 - y)) * 3.
+// Writing 8 rows at once turns the scattered stores into 24 byte runs.
+static void rotateBand(u8 *const fb, const u8 (*const band)[BORDER_WIDTH * 3], const u32 y0)
+{
+	u8 *dst = fb + (BORDER_HEIGHT - BAND_ROWS - y0) * 3;
+	for(u32 x = 0; x < BORDER_WIDTH; x++)
+	{
+		for(u32 k = 0; k < BAND_ROWS; k++) memcpy(dst + k * 3, &band[BAND_ROWS - 1 - k][x * 3], 3);
+		dst += BORDER_HEIGHT * 3;
+	}
+}
+
+// Decodes a 3 or 4 channel QOI (https://qoiformat.org/qoi-specification.pdf) to BGR8.
+// Alpha is only tracked for the index hash.
+static Result decodeQoi(BorderDecoder *const d, u8 *const fb)
+{
+	QoiReader *const s = &d->stream;
+	u8 hdr[QOI_HEADER_SIZE];
+	for(u32 i = 0; i < QOI_HEADER_SIZE; i++) hdr[i] = qoiGetU8(s);
+	if(s->res != RES_OK) return s->res;
+	if(memcmp(hdr, "qoif", 4) != 0 || qoiGetU32BE(&hdr[4]) != BORDER_WIDTH || qoiGetU32BE(&hdr[8]) != BORDER_HEIGHT ||
+	   (hdr[12] != 3 && hdr[12] != 4))
+		return RES_INVALID_BORDER;
+
+	u32 index[64] = {0};
+	u32 r = 0, g = 0, b = 0, a = 255;
+	u32 run = 0;
+	for(u32 y = 0; y < BORDER_HEIGHT; y++)
+	{
+		u8 *out = d->band[y % BAND_ROWS];
+		for(u32 x = 0; x < BORDER_WIDTH; x++)
+		{
+			if(run > 0) run--;
+			else
+			{
+				const u32 op = qoiGetU8(s);
+				if(op == QOI_OP_RGB)
+				{
+					r = qoiGetU8(s);
+					g = qoiGetU8(s);
+					b = qoiGetU8(s);
+				}
+				else if(op == QOI_OP_RGBA)
+				{
+					r = qoiGetU8(s);
+					g = qoiGetU8(s);
+					b = qoiGetU8(s);
+					a = qoiGetU8(s);
+				}
+				else switch(op & 0xC0u)
+				{
+					case QOI_OP_INDEX:
+					{
+						const u32 c = index[op];
+						r = c & 0xFFu;
+						g = c>>8 & 0xFFu;
+						b = c>>16 & 0xFFu;
+						a = c>>24;
+						break;
+					}
+					case QOI_OP_DIFF:
+						r = (r + (op>>4 & 3u) - 2) & 0xFFu;
+						g = (g + (op>>2 & 3u) - 2) & 0xFFu;
+						b = (b + (op & 3u) - 2) & 0xFFu;
+						break;
+					case QOI_OP_LUMA:
+					{
+						const u32 op2 = qoiGetU8(s);
+						const u32 dg = (op & 0x3Fu) - 32;
+						r = (r + dg - 8 + (op2>>4)) & 0xFFu;
+						g = (g + dg) & 0xFFu;
+						b = (b + dg - 8 + (op2 & 0xFu)) & 0xFFu;
+						break;
+					}
+					default: // QOI_OP_RUN. Includes this pixel.
+						run = op & 0x3Fu;
+				}
+				index[(r * 3 + g * 5 + b * 7 + a * 11) & 63u] = r | g<<8 | b<<16 | a<<24;
+			}
+
+			*out++ = b;
+			*out++ = g;
+			*out++ = r;
+		}
+
+		if(y % BAND_ROWS == BAND_ROWS - 1) rotateBand(fb, (const u8 (*)[BORDER_WIDTH * 3])d->band, y + 1 - BAND_ROWS);
+	}
+
+	return s->res;
+}
+
+Result borderLoad(void *const fb)
+{
+	FHandle f;
+	Result res = fOpen(&f, BORDER_QOI_PATH, FA_OPEN_EXISTING | FA_READ);
+	if(res == RES_FR_NO_FILE)
+	{
+		// Old uncompressed border in frame buffer layout.
+		res = fsQuickRead(BORDER_RAW_PATH, fb, BORDER_SIZE);
+	}
+	else if(res == RES_OK)
+	{
+		BorderDecoder *const d = (BorderDecoder*)malloc(sizeof(BorderDecoder));
+		if(d != NULL)
+		{
+			d->stream.f     = f;
+			d->stream.pos   = 0;
+			d->stream.avail = 0;
+			d->stream.res   = RES_OK;
+			res = decodeQoi(d, (u8*)fb);
+			free(d);
+
+			// The decode went through the CPU cache.
+			flushDCacheRange(fb, BORDER_SIZE);
+		}
+		else res = RES_OUT_OF_MEM;
+
+		fClose(f);
+	}
+
+	return res;
+}
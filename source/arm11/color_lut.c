@@ -0,0 +1,638 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <math.h>
+#include <string.h>
+#include "types.h"
+#include "arm11/color_lut.h"
+#include "arm11/config.h"
+#include "drivers/cache.h"
+#include "drivers/gfx.h"
+#include "util.h"
+#include "oaf_error_codes.h"
+#include "arm11/fmt.h"
+#include "fs.h"
+#include "kernel.h"
+#include "arm11/crc32.h"
+#include "arm11/core1_jobs.h"
+
+
+#define COLOR_LUT_CACHE_PATH     "color_lut.bin" // Relative to work dir.
+#define COLOR_LUT_CACHE_MAGIC    (0x4C46414Fu)   // "OAFL".
+#define COLOR_LUT_CACHE_VERSION  (1u)
+
+#define COLOR_LUT_SLICES         (32u)           // One slice per 5 bit red value.
+#define COLOR_LUT_SLICE_ENTRIES  (32768u / COLOR_LUT_SLICES)
+
+
+typedef struct
+{
+	float targetGamma;
+	float lum;
+	float  r, gr, br;
+	float rg,  g, bg;
+	float rb, gb,  b;
+	float displayGamma;
+} ColorProfile;
+
+// libretro shader values. Credits: hunterk and Pokefan531.
+// Last updated 2024-12-03.
+static const ColorProfile g_colorProfiles[8] =
+{
+	{ // libretro GBA color (sRGB).
+		2.2f + (0.3f * 1.6f), // Darken screen. Default 0. Modified to 0.3.
+		0.91f,
+		0.905f,  0.195f,  -0.1f,
+		0.1f,    0.65f,    0.25f,
+		0.1575f, 0.1425f,  0.7f,
+		1.f / 2.2f
+	},
+	{ // libretro GB micro color (sRGB).
+		2.2f,
+		0.9f,
+		0.8025f, 0.31f,   -0.1125f,
+		0.1f,    0.6875f,  0.2125f,
+		0.1225f, 0.1125f,  0.765f,
+		1.f / 2.2f
+	},
+	{ // libretro GBA SP (AGS-101) color (sRGB).
+		2.2f,
+		0.935f,
+		0.96f,    0.11f, -0.07f,
+		0.0325f,  0.89f,  0.0775f,
+		0.001f,  -0.03f,  1.029f,
+		1.f / 2.2f
+	},
+	{ // libretro NDS color (sRGB).
+		2.2f,
+		0.905f,
+		0.835f, 0.27f,   -0.105f,
+		0.1f,   0.6375f,  0.2625f,
+		0.105f, 0.175f,   0.72f,
+		1.f / 2.2f
+	},
+	{ // libretro NDS lite color (sRGB).
+		2.2f,
+		0.935f,
+		0.93f,   0.14f, -0.07f,
+		0.025f,  0.9f,   0.075f,
+		0.008f, -0.03f,  1.022f,
+		1.f / 2.2f
+	},
+	{ // libretro Nintendo Switch Online color (sRGB).
+		2.2f + 0.8f, // Darken screen. Default 0.8.
+		1.f,
+		0.865f,  0.1225f, 0.0125f,
+		0.0575f, 0.925f,  0.0125f,
+		0.0575f, 0.1225f, 0.82f,
+		1.f / 2.2f
+	},
+	{ // libretro Visual Boy Advance/No$GBA full color.
+		1.45f + 1.f, // Darken screen. Default 1.
+		1.f,
+		0.73f,   0.27f,   0.f,
+		0.0825f, 0.6775f, 0.24f,
+		0.0825f, 0.24f,   0.6775f,
+		1.f / 1.45f
+	},
+	{ // Identity.
+		2.2f,
+		1.f,
+		1.f, 0.f, 0.f,
+		0.f, 1.f, 0.f,
+		0.f, 0.f, 1.f,
+		1.f / 2.2f
+	}
+};
+
+ALWAYS_INLINE float clamp_float(const float x, const float min, const float max)
+{
+	return (x < min ? min : (x > max ? max : x));
+}
+
+// Linear RGB contributions of one 5 bit input channel to all 3 outputs.
+typedef struct
+{
+	float r;
+	float g;
+	float b;
+} ColorLutTerm;
+
+// All inputs the color lut depends on. Hashed for the cache.
+typedef struct
+{
+	ColorProfile profile;
+	float contrast;
+	float brightness;
+	float saturation;
+} ColorLutParams;
+
+typedef struct
+{
+	u32 magic;      // "OAFL".
+	u16 version;
+	u16 reserved;
+	u32 paramsHash; // CRC-32 of ColorLutParams.
+	u32 reserved2;
+} ColorLutCacheHeader;
+
+// Everything needed to compute a slice of the table.
+typedef struct
+{
+	ColorLutTerm terms[3][32];
+	float thresholds[255]; // thresholds[k] is the smallest value which rounds to k + 1.
+} ColorLutTables;
+
+// State of a background build. Each part is written by only one core and has its own cache lines.
+// Both cores may build the same slice at the end of a build. That's fine because the result is identical.
+typedef struct
+{
+	alignas(32) ColorLutTables tables;
+
+	// Written by core 0.
+	alignas(32) struct
+	{
+		u32 gen;         // Build generation. Starting a build increments it.
+		u32 lo;          // Core 0 finished all slices below this.
+		u32 *lut;        // Table being built.
+		const u32 *active;
+	} core0;
+
+	// Written by core 1.
+	alignas(32) struct
+	{
+		u32 gen;         // Generation hi belongs to.
+		u32 hi;          // Core 1 finished all slices from this one up.
+		u32 doneGen;     // Core 1 no longer touches the table of this generation.
+		const u32 *inUse; // Table core 1 uses for the current frame.
+	} core1;
+} ColorLutBuild;
+
+alignas(32) static ColorLutBuild g_build;
+static bool g_rebuildPending = false;
+static volatile bool g_buildTaskRunning = false;
+static bool g_building = false;
+
+
+
+// Finds the 8-bit value for a linear color with 8 compares.
+static u32 lookupDisplayValue(const float *const thresholds, const float x)
+{
+	u32 idx = 0;
+	for(u32 step = 128; step > 0; step >>= 1)
+	{
+		if(x >= thresholds[idx + step - 1]) idx += step;
+	}
+
+	return idx;
+}
+
+// Saturation matrix times correction matrix. Every column is
+// the output for one input channel so each channel can be done separately.
+static void getCorrectionMatrix(ColorLutTerm cols[3], const ColorProfile *const p)
+{
+	// Calculate saturation weights.
+	// Note: We are using the Rec. 709 luminance vector here.
+	const float sat   = g_oafConfig.saturation;
+	const float rwgt  = (1.f - sat) * 0.2126f;
+	const float gwgt  = (1.f - sat) * 0.7152f;
+	const float bwgt  = (1.f - sat) * 0.0722f;
+
+	/*
+	 *               Input
+	 *                [r]
+	 *                [g]
+	 *                [b]
+	 *
+	 * Correction    Output
+	 * [ r][gr][br]   [r]
+	 * [rg][ g][bg]   [g]
+	 * [rb][gb][ b]   [b]
+	*/
+	// Red input.
+	cols[0].r = (rwgt + sat) * p->r + gwgt * p->rg + bwgt * p->rb;
+	cols[0].g = rwgt * p->r + (gwgt + sat) * p->rg + bwgt * p->rb;
+	cols[0].b = rwgt * p->r + gwgt * p->rg + (bwgt + sat) * p->rb;
+
+	// Green input.
+	cols[1].r = (rwgt + sat) * p->gr + gwgt * p->g + bwgt * p->gb;
+	cols[1].g = rwgt * p->gr + (gwgt + sat) * p->g + bwgt * p->gb;
+	cols[1].b = rwgt * p->gr + gwgt * p->g + (bwgt + sat) * p->gb;
+
+	// Blue input.
+	cols[2].r = (rwgt + sat) * p->br + gwgt * p->bg + bwgt * p->b;
+	cols[2].g = rwgt * p->br + (gwgt + sat) * p->bg + bwgt * p->b;
+	cols[2].b = rwgt * p->br + gwgt * p->bg + (bwgt + sat) * p->b;
+}
+
+static void prepareTables(ColorLutTables *const t, const ColorProfile *const p)
+{
+	const float targetGamma    = p->targetGamma;
+	const float contrast       = g_oafConfig.contrast;
+	const float brightness     = g_oafConfig.brightness / contrast;
+	const float targetContrast = powf(contrast, targetGamma);
+
+	ColorLutTerm cols[3];
+	getCorrectionMatrix(cols, p);
+
+	// All 3 channels share the gamma/luminance step.
+	// It only depends on the 5 bit value.
+	for(u32 i = 0; i < 32; i++)
+	{
+		// Convert to 8-bit, normalize and convert to linear gamma.
+		float lin = powf((float)rgbFive2Eight(i) / 255 + brightness, targetGamma);
+
+		// Apply luminance.
+		lin = clamp_float(lin * p->lum, 0.f, 1.f);
+
+		for(u32 c = 0; c < 3; c++)
+		{
+			t->terms[c][i].r = cols[c].r * lin;
+			t->terms[c][i].g = cols[c].g * lin;
+			t->terms[c][i].b = cols[c].b * lin;
+		}
+	}
+
+	// Converting to display gamma is monotonic. Instead of powf() and rounding per entry
+	// precompute where the rounded result changes: powf(targetContrast * x, displayGamma) * 255 >= k + 0.5.
+	const float displayGamma    = p->displayGamma;
+	const float invDisplayGamma = 1.f / displayGamma;
+	for(u32 k = 0; k < 255; k++)
+	{
+		float x = powf(((float)k + 0.5f) / 255, invDisplayGamma) / targetContrast;
+
+		// powf() is not exact. Move x a few ulps to where the rounded
+		// result really changes so ties round like before.
+		if(isfinite(x))
+		{
+			for(u32 i = 0; i < 16 && lroundf(powf(targetContrast * x, displayGamma) * 255) > (long)k; i++)
+				x = nextafterf(x, 0.f);
+			for(u32 i = 0; i < 16 && lroundf(powf(targetContrast * x, displayGamma) * 255) <= (long)k; i++)
+				x = nextafterf(x, INFINITY);
+		}
+		t->thresholds[k] = x;
+	}
+}
+
+// Computes all entries with the given 5 bit red value.
+static void buildSlice(const ColorLutTables *const t, u32 *const lut, const u32 r)
+{
+	u32 *colorLut = lut + r * COLOR_LUT_SLICE_ENTRIES;
+	for(u32 g = 0; g < 32; g++)
+	{
+		const ColorLutTerm rg =
+		{
+			t->terms[0][r].r + t->terms[1][g].r,
+			t->terms[0][r].g + t->terms[1][g].g,
+			t->terms[0][r].b + t->terms[1][g].b
+		};
+
+		for(u32 b = 0; b < 32; b++)
+		{
+			// Negative values are clamped to 0 by the lookup.
+			const ColorLutTerm *const bt = &t->terms[2][b];
+
+			// Convert to ABGR8 and write lut.
+			u32 entry = 255; // Alpha.
+			entry |= lookupDisplayValue(t->thresholds, rg.b + bt->b)<<8;
+			entry |= lookupDisplayValue(t->thresholds, rg.g + bt->g)<<16;
+			entry |= lookupDisplayValue(t->thresholds, rg.r + bt->r)<<24;
+			*colorLut++ = entry;
+		}
+	}
+}
+
+// Slices core 1 builds while core 0 builds the others.
+typedef struct
+{
+	alignas(32) const ColorLutTables *t;
+	u32 *lut;
+	u32 first;
+	u32 end;
+} ColorLutSliceJob;
+
+static void buildSlicesJob(void *args)
+{
+	const ColorLutSliceJob *const job = (ColorLutSliceJob*)args;
+	invalidateDCacheRange(job, sizeof(ColorLutSliceJob));
+	invalidateDCacheRange(job->t, sizeof(ColorLutTables));
+
+	u32 *const lut = job->lut;
+	for(u32 r = job->first; r < job->end; r++) buildSlice(job->t, lut, r);
+	cleanDCacheRange(lut + job->first * COLOR_LUT_SLICE_ENTRIES, (job->end - job->first) * COLOR_LUT_SLICE_ENTRIES * 4);
+}
+
+static const ColorProfile* getColorProfile(void)
+{
+	return &g_colorProfiles[g_oafConfig.colorProfile - 1];
+}
+
+static u32 hashColorLutParams(const ColorProfile *const p)
+{
+	ColorLutParams params;
+	memset(&params, 0, sizeof(params)); // No uninitialized padding in the hash.
+	params.profile    = *p;
+	params.contrast   = g_oafConfig.contrast;
+	params.brightness = g_oafConfig.brightness;
+	params.saturation = g_oafConfig.saturation;
+
+	return crc32Update(0, &params, sizeof(params));
+}
+
+static Result loadColorLutCache(const u32 paramsHash, u32 *const lut)
+{
+	FHandle f;
+	Result res = fOpen(&f, COLOR_LUT_CACHE_PATH, FA_OPEN_EXISTING | FA_READ);
+	if(res != RES_OK) return res;
+
+	do
+	{
+		ColorLutCacheHeader hdr;
+		u32 read;
+		if((res = fRead(f, &hdr, sizeof(hdr), &read)) != RES_OK) break;
+		if(read != sizeof(hdr) || hdr.magic != COLOR_LUT_CACHE_MAGIC || hdr.version != COLOR_LUT_CACHE_VERSION
+		   || hdr.paramsHash != paramsHash)
+		{
+			res = RES_NOT_FOUND;
+			break;
+		}
+
+		if((res = fRead(f, lut, COLOR_LUT_SIZE, &read)) != RES_OK) break;
+		if(read != COLOR_LUT_SIZE) res = RES_NOT_FOUND;
+	} while(0);
+
+	fClose(f);
+
+	return res;
+}
+
+static Result storeColorLutCache(const u32 paramsHash, const u32 *const lut)
+{
+	FHandle f;
+	Result res = fOpen(&f, COLOR_LUT_CACHE_PATH, FA_CREATE_ALWAYS | FA_WRITE);
+	if(res != RES_OK) return res;
+
+	const ColorLutCacheHeader hdr = {COLOR_LUT_CACHE_MAGIC, COLOR_LUT_CACHE_VERSION, 0, paramsHash, 0};
+	u32 written;
+	res = fWrite(f, &hdr, sizeof(hdr), &written);
+	if(res == RES_OK) res = fWrite(f, lut, COLOR_LUT_SIZE, &written);
+	fClose(f);
+
+	// Don't leave a truncated cache behind.
+	if(res != RES_OK) fUnlink(COLOR_LUT_CACHE_PATH);
+
+	return res;
+}
+
+void colorLutInit(void)
+{
+	ColorLutBuild *const b = &g_build;
+	u32 *const lut = (u32*)COLOR_LUT_ADDR;
+	const ColorProfile *const p = getColorProfile();
+	const u32 paramsHash = hashColorLutParams(p);
+	if(loadColorLutCache(paramsHash, lut) != RES_OK)
+	{
+		prepareTables(&b->tables, p);
+
+		// Core 1 builds the upper half. A failed cache load may have left
+		// dirty lines there so they must be gone before core 1 writes.
+		const u32 half = COLOR_LUT_SLICES / 2;
+		u32 *const upper = lut + half * COLOR_LUT_SLICE_ENTRIES;
+		alignas(32) ColorLutSliceJob job = {&b->tables, lut, half, COLOR_LUT_SLICES};
+		cleanDCacheRange(&b->tables, sizeof(ColorLutTables));
+		cleanDCacheRange(&job, sizeof(job));
+		flushDCacheRange(upper, COLOR_LUT_SIZE / 2);
+		const u32 ticket = core1JobSubmit(buildSlicesJob, &job);
+
+		for(u32 r = 0; r < half; r++) buildSlice(&b->tables, lut, r);
+		core1JobWait(ticket);
+		invalidateDCacheRange(upper, COLOR_LUT_SIZE / 2);
+
+		const Result res = storeColorLutCache(paramsHash, lut);
+		if(res != RES_OK) debug_printf("Failed to cache color lut: %s\n", result2String(res));
+	}
+
+	// No build is running. Core 1 starts with generation 0 done.
+	b->core0.gen    = 0;
+	b->core0.lo     = COLOR_LUT_SLICES;
+	b->core0.lut    = NULL;
+	b->core0.active = lut;
+	b->core1.gen    = 0;
+	b->core1.hi     = 0;
+	b->core1.doneGen = 0;
+	b->core1.inUse  = lut;
+	g_rebuildPending = false;
+	g_building = false;
+
+	flushDCacheRange(lut, COLOR_LUT_SIZE);
+	flushDCacheRange(b, sizeof(ColorLutBuild));
+}
+
+void colorLutRequestRebuild(void)
+{
+	// Builds are never interrupted. The latest settings are used once the current one is done.
+	g_rebuildPending = true;
+}
+
+static void colorLutBuildTask(UNUSED void *args)
+{
+	ColorLutBuild *const b = &g_build;
+	const u32 gen = b->core0.gen;
+	while(1)
+	{
+		// Core 1 works from the top down.
+		invalidateDCacheRange(&b->core1, sizeof(b->core1));
+		const u32 hi = (b->core1.gen == gen ? b->core1.hi : COLOR_LUT_SLICES);
+		const u32 lo = b->core0.lo;
+		if(lo >= hi) break;
+
+		// Slice data must be in memory before the progress.
+		buildSlice(&b->tables, b->core0.lut, lo);
+		cleanDCacheRange(b->core0.lut + lo * COLOR_LUT_SLICE_ENTRIES, COLOR_LUT_SLICE_ENTRIES * 4);
+		b->core0.lo = lo + 1;
+		cleanDCacheRange(&b->core0, sizeof(b->core0));
+
+		// Only use idle time.
+		yieldTask();
+	}
+
+	g_buildTaskRunning = false;
+	taskExit();
+}
+
+void colorLutUpdate(void)
+{
+	ColorLutBuild *const b = &g_build;
+	if(g_buildTaskRunning) return;
+
+	// All slices are done. Core 1 picks up the new table at the start of the next frame.
+	if(g_building)
+	{
+		g_building = false;
+		b->core0.active = b->core0.lut;
+		cleanDCacheRange(&b->core0, sizeof(b->core0));
+	}
+
+	if(!g_rebuildPending) return;
+
+	// The other table is only free once core 1 is completely done
+	// with the last build and converts frames with the active table.
+	invalidateDCacheRange(&b->core1, sizeof(b->core1));
+	if(b->core1.doneGen != b->core0.gen || b->core1.inUse != b->core0.active) return;
+	g_rebuildPending = false;
+
+	// Publish the tables before the new generation.
+	prepareTables(&b->tables, getColorProfile());
+	cleanDCacheRange(&b->tables, sizeof(b->tables));
+	b->core0.lut = (b->core0.active == (u32*)COLOR_LUT_ADDR ? (u32*)(COLOR_LUT_ADDR + COLOR_LUT_SIZE) : (u32*)COLOR_LUT_ADDR);
+	b->core0.lo  = 0;
+	cleanDCacheRange(&b->core0, sizeof(b->core0));
+	b->core0.gen++;
+	cleanDCacheRange(&b->core0, sizeof(b->core0));
+
+	g_building = true;
+	g_buildTaskRunning = true;
+	createTask(0x800, 2, colorLutBuildTask, NULL); // Below the display tasks.
+}
+
+const u32* colorLutCore1Work(void)
+{
+	// Core 1 only reads the parts written by core 0.
+	ColorLutBuild *const b = &g_build;
+	invalidateDCacheRange(&b->core0, sizeof(b->core0));
+	const u32 gen = b->core0.gen;
+	if(b->core1.doneGen != gen)
+	{
+		if(b->core1.gen != gen)
+		{
+			invalidateDCacheRange(&b->tables, sizeof(b->tables));
+			b->core1.gen = gen;
+			b->core1.hi  = COLOR_LUT_SLICES;
+		}
+
+		// One slice per frame fits into VBlank.
+		const u32 hi = b->core1.hi;
+		if(hi > b->core0.lo)
+		{
+			buildSlice(&b->tables, b->core0.lut, hi - 1);
+			cleanDCacheRange(b->core0.lut + (hi - 1) * COLOR_LUT_SLICE_ENTRIES, COLOR_LUT_SLICE_ENTRIES * 4);
+			b->core1.hi = hi - 1;
+		}
+		else b->core1.doneGen = gen;
+	}
+
+	// Drop lines we may still have from the last time this table was active.
+	const u32 *const lut = b->core0.active;
+	if(lut != b->core1.inUse) invalidateDCacheRange(lut, COLOR_LUT_SIZE);
+	b->core1.inUse = lut;
+	cleanDCacheRange(&b->core1, sizeof(b->core1));
+
+	return lut;
+}
+
+static u32 packGpuColor(const float v[3])
+{
+	u32 color = 0xFFu<<24;
+	for(u32 c = 0; c < 3; c++)
+		color |= (u32)lroundf(clamp_float(v[c], 0.f, 1.f) * 255)<<(c * 8);
+
+	return color;
+}
+
+void colorLutGetGpu(ColorLutGpu *const gpu)
+{
+	const ColorProfile *const p = getColorProfile();
+	const float targetGamma    = p->targetGamma;
+	const float contrast       = g_oafConfig.contrast;
+	const float brightness     = g_oafConfig.brightness / contrast;
+	const float targetContrast = powf(contrast, targetGamma);
+	const float displayGamma   = p->displayGamma;
+
+	// The darkened profiles are closer to x³ than x².
+	// With x³ there is no stage left for negative green input coefficients.
+	const u32 exponent = (targetGamma >= 2.6f ? 3 : 2);
+	gpu->exponent = exponent;
+
+	// m[input][output].
+	ColorLutTerm cols[3];
+	getCorrectionMatrix(cols, p);
+	float m[3][3];
+	for(u32 i = 0; i < 3; i++)
+	{
+		m[i][0] = cols[i].r;
+		m[i][1] = cols[i].g;
+		m[i][2] = cols[i].b;
+	}
+
+	// The GPU only multiplies with positive constants. Negative blue/green input
+	// coefficients are added as (1 - input) * -coefficient and the offset
+	// this adds is removed by the gamma table. Red input coefficients are never negative.
+	float pos[3][3], neg[2][3];
+	float need = 0.f;
+	for(u32 c = 0; c < 3; c++)
+	{
+		float sum = 0.f;
+		for(u32 i = 0; i < 3; i++)
+		{
+			pos[i][c] = (m[i][c] > 0.f ? m[i][c] : 0.f);
+			sum += pos[i][c];
+		}
+		neg[0][c] = (m[2][c] < 0.f ? -m[2][c] : 0.f);
+		neg[1][c] = (exponent == 2 && m[1][c] < 0.f ? -m[1][c] : 0.f);
+		sum += neg[0][c] + neg[1][c];
+		need = (sum > need ? sum : need);
+	}
+
+	// Scale down so no stage saturates. Undone by the gamma table.
+	const float scale = (need > 1.f ? 1.f / need : 1.f);
+	for(u32 c = 0; c < 3; c++)
+	{
+		for(u32 i = 0; i < 3; i++) pos[i][c] *= scale;
+		neg[0][c] *= scale;
+		neg[1][c] *= scale;
+	}
+	gpu->matrix[0] = packGpuColor(pos[0]);
+	gpu->matrix[1] = packGpuColor(pos[1]);
+	gpu->matrix[2] = packGpuColor(pos[2]);
+	gpu->matrix[3] = packGpuColor(neg[0]);
+	gpu->matrix[4] = packGpuColor(neg[1]);
+
+	for(u32 c = 0; c < 3; c++)
+	{
+		// For gray the GPU outputs offset + slope * x^exponent. Use the rounded constants like the GPU.
+		const u32 shift = c * 8;
+		const s32 offset = (gpu->matrix[3]>>shift & 0xFF) + (gpu->matrix[4]>>shift & 0xFF);
+		s32 slope = -offset;
+		for(u32 i = 0; i < 3; i++) slope += gpu->matrix[i]>>shift & 0xFF;
+		const float rowSum = m[0][c] + m[1][c] + m[2][c];
+
+		// Invert the GPU side for gray and do the rest exactly like the lookup table.
+		// Apart from 8 bit rounding on the GPU this is exact for gray.
+		for(u32 y = 0; y < 256; y++)
+		{
+			u8 res = 0;
+			if(slope > 0 && rowSum > 0.f)
+			{
+				const float x = powf(clamp_float((float)((s32)y - offset) / slope, 0.f, 1.f), 1.f / exponent);
+				const float lin = clamp_float(powf(x + brightness, targetGamma) * p->lum, 0.f, 1.f);
+				res = clamp_s32(lroundf(powf(targetContrast * rowSum * lin, displayGamma) * 255), 0, 255);
+			}
+			gpu->gamma[c][y] = res;
+		}
+	}
+}
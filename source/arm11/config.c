@@ -26,27 +26,34 @@
 
 
 #define INI_BUF_SIZE    (1024u)
-#define DEFAULT_CONFIG  "[general]\n"             \
-                        "backlight=64\n"          \
-                        "backlightSteps=5\n"      \
-                        "directBoot=false\n"      \
-                        "useGbaDb=true\n"         \
-                        "useSavesFolder=true\n\n" \
-                                                  \
-                        "[video]\n"               \
-                        "scaler=matrix\n"         \
-                        "colorProfile=none\n"     \
-                        "contrast=1.0\n"          \
-                        "brightness=0.0\n"        \
-                        "saturation=1.0\n\n"      \
-                                                  \
-                        "[audio]\n"               \
-                        "audioOut=auto\n"         \
-                        "volume=127\n\n"          \
-                                                  \
-                        "[advanced]\n"            \
-                        "saveOverride=false\n"    \
-                        "defaultSave=sram_256k"
+#define DEFAULT_CONFIG  "[general]\n"                  \
+                        "backlight=64\n"               \
+                        "backlightSteps=5\n"           \
+                        "directBoot=false\n"           \
+                        "useGbaDb=true\n"              \
+                        "useSavesFolder=true\n\n"      \
+                                                       \
+                        "[video]\n"                    \
+                        "scaler=matrix\n"              \
+                        "colorProfile=none\n"          \
+                        "contrast=1.0\n"               \
+                        "brightness=0.0\n"             \
+                        "saturation=1.0\n"             \
+                        "gpuColorCorrection=false\n"   \
+                        "framePacing=false\n\n"        \
+                                                       \
+                        "[audio]\n"                    \
+                        "audioOut=auto\n"              \
+                        "volume=127\n\n"               \
+                                                       \
+                        "[advanced]\n"                 \
+                        "saveOverride=false\n"         \
+                        "defaultSave=sram_256k\n"      \
+                        "cachePatches=false\n"         \
+                        "frameStats=false\n"           \
+                        "bootTimeline=false\n"         \
+                        "screenshotBurst=8\n"          \
+                        "inputPolls=1"
 
 
 
@@ -66,6 +73,8 @@ OafConfig g_oafConfig =
 	1.f,   // contrast
 	0.f,   // brightness
 	1.f,   // saturation
+	false, // gpuColorCorrection
+	false, // framePacing
 
 	// [audio]
 	0,     // Automatic audio output.
@@ -91,7 +100,12 @@ OafConfig g_oafConfig =
 
 	// [advanced]
 	false, // saveOverride
-	14     // defaultSave
+	14,    // defaultSave
+	false, // cachePatches
+	false, // frameStats
+	false, // bootTimeline
+	8,     // screenshotBurst
+	1      // inputPolls
 };
 
 
@@ -189,6 +203,10 @@ static int cfgIniCallback(void *user, const char *section, const char *name, con
 			config->brightness = str2float(value);
 		else if(strcmp(name, "saturation") == 0)
 			config->saturation = str2float(value);
+		else if(strcmp(name, "gpuColorCorrection") == 0)
+			config->gpuColorCorrection = (strcmp(value, "true") == 0 ? true : false);
+		else if(strcmp(name, "framePacing") == 0)
+			config->framePacing = (strcmp(value, "true") == 0 ? true : false);
 	}
 	else if(strcmp(section, "audio") == 0)
 	{
@@ -296,6 +314,16 @@ static int cfgIniCallback(void *user, const char *section, const char *name, con
 			if(strcmp(value, "none") == 0)
 				config->defaultSave = 15;
 		}
+		if(strcmp(name, "cachePatches") == 0)
+			config->cachePatches = (strcmp(value, "true") == 0 ? true : false);
+		if(strcmp(name, "frameStats") == 0)
+			config->frameStats = (strcmp(value, "true") == 0 ? true : false);
+		if(strcmp(name, "bootTimeline") == 0)
+			config->bootTimeline = (strcmp(value, "true") == 0 ? true : false);
+		if(strcmp(name, "screenshotBurst") == 0)
+			config->screenshotBurst = (u8)strtoul(value, NULL, 10);
+		if(strcmp(name, "inputPolls") == 0)
+			config->inputPolls = (u8)strtoul(value, NULL, 10);
 	}
 	else return 0; // Error.
 
@@ -0,0 +1,176 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+#include "arm11/core1_jobs.h"
+#include "drivers/cache.h"
+#include "arm11/drivers/interrupt.h"
+#include "arm.h"
+#include "system.h"
+#include "kevent.h"
+
+
+#define CORE1_JOB_SLOTS  (8u) // Power of 2.
+
+
+typedef struct
+{
+	Core1JobFn fn;
+	void *arg;
+} Core1Job;
+
+// Single producer/single consumer ring. Core 0 only writes the slots and head,
+// core 1 only writes tail. Each part has its own cache lines.
+// tail doubles as completion counter so tickets are just job numbers.
+typedef struct
+{
+	alignas(32) Core1Job jobs[CORE1_JOB_SLOTS];
+
+	// Written by core 0.
+	alignas(32) struct
+	{
+		u32 head;               // Number of submitted jobs.
+		void (*handover)(void); // Core 1 jumps here once all jobs are done.
+	} core0;
+
+	// Written by core 1.
+	alignas(32) struct
+	{
+		u32 tail;               // Number of finished jobs.
+	} core1;
+} Core1JobQueue;
+
+alignas(32) static Core1JobQueue g_queue;
+static KHandle g_jobDoneEvent = 0;
+static bool g_core1TakesJobs = false;
+
+
+
+static void jobDoneHandler(UNUSED const u32 intSource)
+{
+	signalEvent(g_jobDoneEvent, false);
+}
+
+static void core1JobLoop(void)
+{
+	Core1JobQueue *const q = &g_queue;
+	u32 tail = 0;
+	while(1)
+	{
+		invalidateDCacheRange(&q->core0, sizeof(q->core0));
+		if(q->core0.head == tail)
+		{
+			// Only taken with an empty queue so the handover never skips jobs.
+			void (*const entry)(void) = q->core0.handover;
+			if(entry != NULL) entry(); // Never returns.
+
+			// Core 0 sends an event after each submit.
+			__wfe();
+			continue;
+		}
+
+		Core1Job *const slot = &q->jobs[tail % CORE1_JOB_SLOTS];
+		invalidateDCacheRange(slot, sizeof(Core1Job));
+		slot->fn(slot->arg);
+
+		q->core1.tail = ++tail;
+		cleanDCacheRange(&q->core1, sizeof(q->core1));
+		IRQ_softInterrupt(IRQ_IPI14, 1u); // Core 0 only.
+	}
+}
+
+void core1JobsInit(void)
+{
+	Core1JobQueue *const q = &g_queue;
+	q->core0.head     = 0;
+	q->core0.handover = NULL;
+	q->core1.tail     = 0;
+	flushDCacheRange(q, sizeof(Core1JobQueue));
+
+	g_jobDoneEvent = createEvent(false);
+	IRQ_registerIsr(IRQ_IPI14, 13, 0, jobDoneHandler);
+	__systemBootCore1(core1JobLoop);
+	g_core1TakesJobs = true;
+}
+
+u32 core1JobSubmit(Core1JobFn fn, void *arg)
+{
+	if(!g_core1TakesJobs)
+	{
+		fn(arg);
+		return 0;
+	}
+
+	// Wait for a free slot if the ring is full.
+	Core1JobQueue *const q = &g_queue;
+	const u32 head = q->core0.head;
+	core1JobWait(head - CORE1_JOB_SLOTS + 1);
+
+	Core1Job *const slot = &q->jobs[head % CORE1_JOB_SLOTS];
+	slot->fn  = fn;
+	slot->arg = arg;
+	cleanDCacheRange(slot, sizeof(Core1Job));
+
+	// The slot must be visible before the new head.
+	q->core0.head = head + 1;
+	cleanDCacheRange(&q->core0, sizeof(q->core0));
+	__dsb();
+	__sev();
+
+	return head + 1;
+}
+
+void core1JobWait(const u32 ticket)
+{
+	if(ticket == 0) return;
+
+	Core1JobQueue *const q = &g_queue;
+	while(1)
+	{
+		invalidateDCacheRange(&q->core1, sizeof(q->core1));
+		if((s32)(q->core1.tail - ticket) >= 0) break;
+
+		// tail is checked again after clearing so a late IPI can't be lost.
+		waitForEvent(g_jobDoneEvent);
+		clearEvent(g_jobDoneEvent);
+	}
+}
+
+void core1JobsHandover(void (*entry)(void))
+{
+	if(!g_core1TakesJobs)
+	{
+		// Core 1 is still parked. Boot it directly.
+		__systemBootCore1(entry);
+		return;
+	}
+
+	Core1JobQueue *const q = &g_queue;
+	core1JobWait(q->core0.head);
+	g_core1TakesJobs = false;
+
+	q->core0.handover = entry;
+	cleanDCacheRange(&q->core0, sizeof(q->core0));
+	__dsb();
+	__sev();
+
+	// Core 1 no longer sends IPI 14.
+	IRQ_unregisterIsr(IRQ_IPI14);
+	deleteEvent(g_jobDoneEvent);
+	g_jobDoneEvent = 0;
+}
@@ -0,0 +1,129 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+#include "arm11/crc32.h"
+
+
+#define CRC32_POLY  (0xEDB88320u) // Reversed.
+
+
+// Slicing-by-4 tables. Generated on first use.
+static u32 g_crcTable[4][256];
+static bool g_crcTableReady = false;
+
+
+
+static void makeCrcTable(void)
+{
+	for(u32 i = 0; i < 256; i++)
+	{
+		u32 c = i;
+		for(u32 j = 0; j < 8; j++) c = (c & 1u ? CRC32_POLY ^ (c>>1) : c>>1);
+		g_crcTable[0][i] = c;
+	}
+
+	for(u32 i = 0; i < 256; i++)
+	{
+		for(u32 t = 1; t < 4; t++)
+		{
+			const u32 prev = g_crcTable[t - 1][i];
+			g_crcTable[t][i] = (prev>>8) ^ g_crcTable[0][prev & 0xFFu];
+		}
+	}
+
+	g_crcTableReady = true;
+}
+
+static inline u32 crcByte(const u32 c, const u8 b)
+{
+	return (c>>8) ^ g_crcTable[0][(c ^ b) & 0xFFu];
+}
+
+static inline u32 crcWord(u32 c, const u32 w)
+{
+	c ^= w;
+	return g_crcTable[3][c & 0xFFu] ^ g_crcTable[2][(c>>8) & 0xFFu] ^
+	       g_crcTable[1][(c>>16) & 0xFFu] ^ g_crcTable[0][c>>24];
+}
+
+u32 crc32Update(u32 crc, const void *data, u32 size)
+{
+	if(!g_crcTableReady) makeCrcTable();
+
+	const u8 *p = (const u8*)data;
+	u32 c = ~crc;
+	while(size > 0 && ((uintptr_t)p & 3u) != 0)
+	{
+		c = crcByte(c, *p++);
+		size--;
+	}
+
+	const u32 *p32 = (const u32*)p;
+	while(size >= 4)
+	{
+		c = crcWord(c, *p32++);
+		size -= 4;
+	}
+
+	p = (const u8*)p32;
+	while(size > 0)
+	{
+		c = crcByte(c, *p++);
+		size--;
+	}
+
+	return ~c;
+}
+
+void crc32UpdateDual(u32 *const crcA, u32 *const crcB, const void *data, u32 size)
+{
+	if(!g_crcTableReady) makeCrcTable();
+
+	const u8 *p = (const u8*)data;
+	u32 a = ~*crcA;
+	u32 b = ~*crcB;
+	while(size > 0 && ((uintptr_t)p & 3u) != 0)
+	{
+		const u8 byte = *p++;
+		a = crcByte(a, byte);
+		b = crcByte(b, byte);
+		size--;
+	}
+
+	const u32 *p32 = (const u32*)p;
+	while(size >= 4)
+	{
+		const u32 w = *p32++;
+		a = crcWord(a, w);
+		b = crcWord(b, w);
+		size -= 4;
+	}
+
+	p = (const u8*)p32;
+	while(size > 0)
+	{
+		const u8 byte = *p++;
+		a = crcByte(a, byte);
+		b = crcByte(b, byte);
+		size--;
+	}
+
+	*crcA = ~a;
+	*crcB = ~b;
+}
@@ -107,11 +107,17 @@ BEGIN_ASM_FUNC convert160pFrameFast
 	@ We will be using IRQs without our IRQ handler to minimize latency.
 	cpsid i                                        @ __disableIrq();
 
-	@ Load lookup table address and color mask.
-	ldr   r2, =0x1FF00000                          @ r2 = 0x1FF00000;
-	ldrh r12, =0x7FFF                              @ r12 = 0x7FFF;
-
 	convert160pFrameFast_frame_lp:
+		@ Idle while core 0 paused rendering. Returns at the start of a frame.
+		blx OAF_videoCore1Pause                    @ OAF_videoCore1Pause();
+
+		@ Let core 0 swap tables between frames. This may build a slice of a new table.
+		blx colorLutCore1Work                      @ r0 = colorLutCore1Work();
+
+		@ Load lookup table address and color mask.
+		mov   r2,  r0                              @ r2 = r0;
+		ldrh r12, =0x7FFF                          @ r12 = 0x7FFF;
+
 		@ Load input and output addresses.
 		ldr  r0, =0x18200000                       @ r0 = 0x18200000;    // u32.
 		@ldr  r1, =0x18300000                       @ r1 = 0x18300000;    // u32.
@@ -137,6 +143,16 @@ BEGIN_ASM_FUNC convert160pFrameFast
 				beq convert160pFrameFast_wait_irq      @ if((r11>>16) == 0) goto convert160pFrameFast_wait_irq;
 
 			convert160pFrameFast_skip_irq_wait:
+			@ Invalidate the 8 input lines. LgyCap DMAd them behind our back.
+			@ Note: The input lines are never dirty.
+			add  r3,  r0, #0xF00                   @ r3 = r0 + 0xF00;
+			mov  r4,  r0                           @ r4 = r0;
+			convert160pFrameFast_inv_lp:
+				mcr p15, 0, r4, c7, c6, 1          @ Invalidate Data Cache Line (using MVA).
+				add  r4,  r4, #32                  @ r4 += 32;
+				cmp  r4,  r3                       @ r4 - r3; // Updates flags.
+				blo convert160pFrameFast_inv_lp    @ if(r4 < r3) goto convert160pFrameFast_inv_lp;
+
 			@ Load size of 8 lines in bytes.
 			mov  r3, #0xF00                        @ r3 = 0xF00;
 
@@ -183,6 +199,15 @@ BEGIN_ASM_FUNC convert160pFrameFast
 				stmia  r1!, {r4-r10, lr}           @ *((_32BytesBlock*)r1) = r4_to_r10_lr; r1 += 32;
 				bne convert160pFrameFast_8p_lp     @ if(r3 != 0) goto convert160pFrameFast_8p_lp;
 
+			@ Write the 8 output lines back so the GPU can use them right away.
+			@ Only the last 8 lines are left to do at the end of the frame.
+			sub  r4,  r1, #0x1E00                  @ r4 = r1 - 0x1E00;
+			convert160pFrameFast_clean_lp:
+				mcr p15, 0, r4, c7, c10, 1         @ Clean Data Cache Line (using MVA).
+				add  r4,  r4, #32                  @ r4 += 32;
+				cmp  r4,  r1                       @ r4 - r1; // Updates flags.
+				blo convert160pFrameFast_clean_lp  @ if(r4 < r1) goto convert160pFrameFast_clean_lp;
+
 			@ Test if 8 line counter is 152, skip texture padding and jump back if we are not done yet.
 			cmp r11, #152                          @ r11 - 152; // Updates flags.
 			add  r0,  r0, #0x1100                  @ r0 += 0x1100;
@@ -191,9 +216,8 @@ BEGIN_ASM_FUNC convert160pFrameFast
 			beq convert160pFrameFast_skip_irq_wait @ if(r11 == 152) goto convert160pFrameFast_skip_irq_wait;
 			bls convert160pFrameFast_8l_lp         @ if(r11 <= 152) goto convert160pFrameFast_8l_lp;
 
-		@ Flush the D-Cache, wait for flush completion, notify core 0 and jump back.
+		@ All output lines have been written back already. Wait for completion, notify core 0 and jump back.
 		@ Note: r3 has been decremented down to 0 previously and so it's safe to use.
-		mcr p15, 0, r3, c7, c14, 0                 @ Clean and Invalidate Entire Data Cache.
 		ldr  r4, =MPCORE_PRIV_BASE                 @ r4 = MPCORE_PRIV_BASE;  // u32.
 		mov  r5, #0x10000                          @ r5 = 0x10000;
 		orr  r5,  r5, #0xF                         @ r5 |= 0xF;
@@ -215,11 +239,17 @@ BEGIN_ASM_FUNC convert240pFrameFast
 	@ We will be using IRQs without our IRQ handler to minimize latency.
 	cpsid i                                        @ __disableIrq();
 
-	@ Load lookup table address and color mask.
-	ldr   r2, =0x1FF00000                          @ r2 = 0x1FF00000;
-	ldrh r12, =0x7FFF                              @ r12 = 0x7FFF;
-
 	convert240pFrameFast_frame_lp:
+		@ Idle while core 0 paused rendering. Returns at the start of a frame.
+		blx OAF_videoCore1Pause                    @ OAF_videoCore1Pause();
+
+		@ Let core 0 swap tables between frames. This may build a slice of a new table.
+		blx colorLutCore1Work                      @ r0 = colorLutCore1Work();
+
+		@ Load lookup table address and color mask.
+		mov   r2,  r0                              @ r2 = r0;
+		ldrh r12, =0x7FFF                          @ r12 = 0x7FFF;
+
 		@ Load input and output addresses.
 		ldr  r0, =0x18200000                       @ r0 = 0x18200000;    // u32.
 		@ldr  r1, =0x18300000                       @ r1 = 0x18300000;    // u32.
@@ -245,6 +275,16 @@ BEGIN_ASM_FUNC convert240pFrameFast
 				beq convert240pFrameFast_wait_irq      @ if((r11>>16) == 0) goto convert240pFrameFast_wait_irq;
 
 			convert240pFrameFast_skip_irq_wait:
+			@ Invalidate the 8 input lines. LgyCap DMAd them behind our back.
+			@ Note: The input lines are never dirty.
+			add  r3,  r0, #0x1680                  @ r3 = r0 + 0x1680;
+			mov  r4,  r0                           @ r4 = r0;
+			convert240pFrameFast_inv_lp:
+				mcr p15, 0, r4, c7, c6, 1          @ Invalidate Data Cache Line (using MVA).
+				add  r4,  r4, #32                  @ r4 += 32;
+				cmp  r4,  r3                       @ r4 - r3; // Updates flags.
+				blo convert240pFrameFast_inv_lp    @ if(r4 < r3) goto convert240pFrameFast_inv_lp;
+
 			@ Load size of 8 lines in bytes.
 			mov  r3, #0x1680                       @ r3 = 0x1680;
 
@@ -291,6 +331,15 @@ BEGIN_ASM_FUNC convert240pFrameFast
 				stmia  r1!, {r4-r10, lr}           @ *((_32BytesBlock*)r1) = r4_to_r10_lr; r1 += 32;
 				bne convert240pFrameFast_8p_lp     @ if(r3 != 0) goto convert240pFrameFast_8p_lp;
 
+			@ Write the 8 output lines back so the GPU can use them right away.
+			@ Only the last 8 lines are left to do at the end of the frame.
+			sub  r4,  r1, #0x2D00                  @ r4 = r1 - 0x2D00;
+			convert240pFrameFast_clean_lp:
+				mcr p15, 0, r4, c7, c10, 1         @ Clean Data Cache Line (using MVA).
+				add  r4,  r4, #32                  @ r4 += 32;
+				cmp  r4,  r1                       @ r4 - r1; // Updates flags.
+				blo convert240pFrameFast_clean_lp  @ if(r4 < r1) goto convert240pFrameFast_clean_lp;
+
 			@ Test if 8 line counter is 232, skip texture padding and jump back if we are not done yet.
 			cmp r11, #232                          @ r11 - 232; // Updates flags.
 			add  r0,  r0, #0x980                   @ r0 += 0x980;
@@ -299,9 +348,8 @@ BEGIN_ASM_FUNC convert240pFrameFast
 			beq convert240pFrameFast_skip_irq_wait @ if(r11 == 232) goto convert240pFrameFast_skip_irq_wait;
 			bls convert240pFrameFast_8l_lp         @ if(r11 <= 232) goto convert240pFrameFast_8l_lp;
 
-		@ Flush the D-Cache, wait for flush completion, notify core 0 and jump back.
+		@ All output lines have been written back already. Wait for completion, notify core 0 and jump back.
 		@ Note: r3 has been decremented down to 0 previously and so it's safe to use.
-		mcr p15, 0, r3, c7, c14, 0                 @ Clean and Invalidate Entire Data Cache.
 		ldr  r4, =MPCORE_PRIV_BASE                 @ r4 = MPCORE_PRIV_BASE;  // u32.
 		mov  r5, #0x10000                          @ r5 = 0x10000;
 		orr  r5,  r5, #0xF                         @ r5 |= 0xF;
@@ -0,0 +1,98 @@
+@ This file is part of open_agb_firm
+@ Copyright (C) 2024 profi200
+@
+@ This program is free software: you can redistribute it and/or modify
+@ it under the terms of the GNU General Public License as published by
+@ the Free Software Foundation, either version 3 of the License, or
+@ (at your option) any later version.
+@
+@ This program is distributed in the hope that it will be useful,
+@ but WITHOUT ANY WARRANTY; without even the implied warranty of
+@ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+@ GNU General Public License for more details.
+@
+@ You should have received a copy of the GNU General Public License
+@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "asm_macros.h"
+
+.syntax unified
+.cpu mpcore
+.fpu vfpv2
+
+
+
+@ const u32* findSaveStringFast(const u32 *start, const u32 *end);
+BEGIN_ASM_FUNC findSaveStringFast
+	@ Save registers and load the 3 save string prefixes.
+	stmfd sp!, {r4-r7, lr}                  @ Save registers.
+	ldr  r2, =0x52504545                    @ r2 = 0x52504545;  // "EEPR".
+	ldr  r3, =0x53414C46                    @ r3 = 0x53414C46;  // "FLAS".
+	ldr r12, =0x4D415253                    @ r12 = 0x4D415253; // "SRAM".
+
+	@ Calculate the end of the part we can scan in 16 bytes blocks.
+	@ Stop 80 bytes early so the prefetch never touches memory past the end.
+	@ The memory there may still be written by DMA/GX engines.
+	sub   lr,  r1, r0                       @ lr = r1 - r0;
+	subs  lr,  lr, #80                      @ lr -= 80; // Updates flags.
+	movlo lr,  #0                           @ if(lr < 0) lr = 0;
+	bic   lr,  lr, #15                      @ lr &= ~15;
+	add  lr,  r0, lr                        @ lr += r0;
+	cmp  r0,  lr                            @ r0 - lr; // Updates flags.
+	bhs findSaveStringFast_word_test        @ if(r0 >= lr) goto findSaveStringFast_word_test;
+
+	findSaveStringFast_blk_lp:
+		@ Load 4 words and prefetch ahead.
+		ldmia r0!, {r4-r7}                  @ r4_to_r7 = *((_16BytesBlock*)r0); r0 += 16;
+		pld [r0, #64]                       @ Prefetch from r0 + 64.
+
+		@ Compare each word against all 3 prefixes.
+		cmp    r4,  r2                      @ r4 - r2;  // Updates flags.
+		cmpne  r4,  r3                      @ if(r4 != r2) r4 - r3;  // Updates flags.
+		cmpne  r4, r12                      @ if(r4 != r2 && r4 != r3) r4 - r12; // Updates flags.
+		beq findSaveStringFast_hit0         @ if(r4 is a prefix) goto findSaveStringFast_hit0;
+		cmp    r5,  r2                      @ r5 - r2;  // Updates flags.
+		cmpne  r5,  r3                      @ if(r5 != r2) r5 - r3;  // Updates flags.
+		cmpne  r5, r12                      @ if(r5 != r2 && r5 != r3) r5 - r12; // Updates flags.
+		beq findSaveStringFast_hit1         @ if(r5 is a prefix) goto findSaveStringFast_hit1;
+		cmp    r6,  r2                      @ r6 - r2;  // Updates flags.
+		cmpne  r6,  r3                      @ if(r6 != r2) r6 - r3;  // Updates flags.
+		cmpne  r6, r12                      @ if(r6 != r2 && r6 != r3) r6 - r12; // Updates flags.
+		beq findSaveStringFast_hit2         @ if(r6 is a prefix) goto findSaveStringFast_hit2;
+		cmp    r7,  r2                      @ r7 - r2;  // Updates flags.
+		cmpne  r7,  r3                      @ if(r7 != r2) r7 - r3;  // Updates flags.
+		cmpne  r7, r12                      @ if(r7 != r2 && r7 != r3) r7 - r12; // Updates flags.
+		beq findSaveStringFast_hit3         @ if(r7 is a prefix) goto findSaveStringFast_hit3;
+
+		@ Jump back if we are not done yet.
+		cmp  r0,  lr                        @ r0 - lr; // Updates flags.
+		blo findSaveStringFast_blk_lp       @ if(r0 < lr) goto findSaveStringFast_blk_lp;
+
+	findSaveStringFast_word_test:
+	@ Scan the remaining 0-23 words one by one.
+	cmp  r0,  r1                            @ r0 - r1; // Updates flags.
+	bhs findSaveStringFast_not_found        @ if(r0 >= r1) goto findSaveStringFast_not_found;
+	findSaveStringFast_word_lp:
+		ldr  r4, [r0], #4                   @ r4 = *r0; r0 += 4; // u32.
+		cmp    r4,  r2                      @ r4 - r2;  // Updates flags.
+		cmpne  r4,  r3                      @ if(r4 != r2) r4 - r3;  // Updates flags.
+		cmpne  r4, r12                      @ if(r4 != r2 && r4 != r3) r4 - r12; // Updates flags.
+		beq findSaveStringFast_hit3         @ if(r4 is a prefix) goto findSaveStringFast_hit3;
+		cmp  r0,  r1                        @ r0 - r1; // Updates flags.
+		blo findSaveStringFast_word_lp      @ if(r0 < r1) goto findSaveStringFast_word_lp;
+
+	findSaveStringFast_not_found:
+	mov  r0,  r1                            @ r0 = r1;
+	ldmfd sp!, {r4-r7, pc}                  @ Restore registers and return.
+
+	@ r0 points 16 bytes after the block. Return the address of the matching word.
+	findSaveStringFast_hit0:
+	sub  r0,  r0, #4                        @ r0 -= 4;
+	findSaveStringFast_hit1:
+	sub  r0,  r0, #4                        @ r0 -= 4;
+	findSaveStringFast_hit2:
+	sub  r0,  r0, #4                        @ r0 -= 4;
+	findSaveStringFast_hit3:
+	sub  r0,  r0, #4                        @ r0 -= 4;
+	ldmfd sp!, {r4-r7, pc}                  @ Restore registers and return.
+END_ASM_FUNC
@@ -25,27 +25,70 @@
 #include "arm11/drivers/hid.h"
 #include "arm11/fmt.h"
 #include "drivers/gfx.h"
+#include "arm11/config.h"
 
 
 // Notes on these settings:
-// MAX_ENT_BUF_SIZE should be big enough to hold the average file/dir name length * MAX_DIR_ENTRIES.
-#define MAX_ENT_BUF_SIZE  (1024u * 196) // 196 KiB.
-#define MAX_DIR_ENTRIES   (1000u)
+// Entries are stored in ENT_CHUNK_SIZE chunks and the pointer array grows by PTR_GROW.
+// Neither has an upper limit other than memory.
+#define ENT_CHUNK_SIZE    (1024u * 16) // 16 KiB.
+#define PTR_GROW          (1024u)
 #define DIR_READ_BLOCKS   (10u)
+#define SCAN_STEP_BLOCKS  (4u)          // Background scan blocks per VBlank.
+#define STORE_IDLE_FRAMES (60u)         // VBlanks without key presses before a pending index is written.
 #define SCREEN_COLS       (53u - 1) // - 1 because the console inserts a newline after the last line otherwise.
 #define SCREEN_ROWS       (24u)
 
 #define ENT_TYPE_FILE  (0)
 #define ENT_TYPE_DIR   (1)
+#define ENT_META_SIZE  (8u) // u32 size; u32 time; // Unaligned.
 
+#define LIBRARY_MAGIC    (0x4C46414Fu) // "OAFL"
+#define LIBRARY_VERSION  (1u)
+
+
+typedef struct EntChunk EntChunk;
+struct EntChunk
+{
+	EntChunk *next;
+	u32 used;
+	char buf[ENT_CHUNK_SIZE]; // Format: u8 meta[ENT_META_SIZE]; char entryType; char name[X]; // null terminated.
+};
 
 typedef struct
 {
-	u32 num;                       // Total number of entries.
-	char entBuf[MAX_ENT_BUF_SIZE]; // Format: char entryType; char name[X]; // null terminated.
-	char *ptrs[MAX_DIR_ENTRIES];   // For fast sorting.
+	u32 num;              // Total number of entries.
+	u32 sorted;           // Entries below this are sorted. The rest is the current run.
+	u32 cap;              // Number of pointers allocated.
+	u32 bytes;            // Total size of all entries.
+	char **ptrs;          // For fast sorting. Points to the entry type.
+	EntChunk *chunks;     // Newest first.
+	s32 first[2][256];    // Index of the first entry per type and first character. -1 if none.
 } DirList;
 
+typedef struct
+{
+	DHandle dh;
+	bool active;
+	FILINFO *fis;
+	DirList *dList;
+	const char *filter;
+} DirScan;
+
+// Library index file per directory. The entries follow in sorted order.
+typedef struct
+{
+	u32 magic;
+	u16 version;
+	u16 pathLen;    // The path follows the header. Without null terminator.
+	u32 num;
+	u32 entBufSize;
+} LibraryHeader;
+
+static EntChunk *g_chunkPool = NULL; // Chunks of cleared lists for reuse.
+static char **g_mergeBuf = NULL;
+static u32 g_mergeCap = 0;
+
 
 
 int dlistCompare(const void *a, const void *b)
@@ -66,61 +109,417 @@ int dlistCompare(const void *a, const void *b)
 	return res;
 }
 
-static Result scanDir(const char *const path, DirList *const dList, const char *const filter)
+// Size of an entry including meta data. ent points to the entry type.
+static u32 entrySize(const char *const ent)
 {
-	FILINFO *const fis = (FILINFO*)malloc(sizeof(FILINFO) * DIR_READ_BLOCKS);
-	if(fis == NULL) return RES_OUT_OF_MEM;
+	return ENT_META_SIZE + strlen(&ent[1]) + 2;
+}
 
-	dList->num = 0;
+static void dirListClear(DirList *const dList)
+{
+	// Give all chunks back to the pool.
+	EntChunk *chunk = dList->chunks;
+	while(chunk != NULL)
+	{
+		EntChunk *const next = chunk->next;
+		chunk->next = g_chunkPool;
+		g_chunkPool = chunk;
+		chunk = next;
+	}
+	dList->chunks = NULL;
+	dList->num    = 0;
+	dList->sorted = 0;
+	dList->bytes  = 0;
+}
 
-	Result res;
-	DHandle dh;
-	if((res = fOpenDir(&dh, path)) == RES_OK)
+static void dirListFree(DirList *const dList)
+{
+	if(dList == NULL) return;
+
+	dirListClear(dList);
+	free(dList->ptrs);
+	free(dList);
+}
+
+static DirList* dirListAlloc(void)
+{
+	DirList *const dList = (DirList*)calloc(1, sizeof(DirList));
+	return dList;
+}
+
+static void freeChunkPool(void)
+{
+	while(g_chunkPool != NULL)
 	{
-		u32 read;           // Number of entries read by fReadDir().
-		u32 numEntries = 0; // Total number of processed entries.
-		u32 entBufPos = 0;  // Entry buffer position/number of bytes used.
-		const u32 filterLen = strlen(filter);
-		do
+		EntChunk *const next = g_chunkPool->next;
+		free(g_chunkPool);
+		g_chunkPool = next;
+	}
+
+	free(g_mergeBuf);
+	g_mergeBuf = NULL;
+	g_mergeCap = 0;
+}
+
+// Copies an entry into the list. Returns false if out of memory.
+static bool dirListAdd(DirList *const dList, const void *const meta, const char entType, const char *const name)
+{
+	const u32 size = ENT_META_SIZE + strlen(name) + 2;
+	EntChunk *chunk = dList->chunks;
+	if(chunk == NULL || chunk->used + size > ENT_CHUNK_SIZE)
+	{
+		if(g_chunkPool != NULL)
 		{
-			if((res = fReadDir(dh, fis, DIR_READ_BLOCKS, &read)) != RES_OK) break;
-			read = (read <= MAX_DIR_ENTRIES - numEntries ? read : MAX_DIR_ENTRIES - numEntries);
+			chunk = g_chunkPool;
+			g_chunkPool = chunk->next;
+		}
+		else if((chunk = (EntChunk*)malloc(sizeof(EntChunk))) == NULL) return false;
+
+		chunk->used  = 0;
+		chunk->next  = dList->chunks;
+		dList->chunks = chunk;
+	}
 
-			for(u32 i = 0; i < read; i++)
+	if(dList->num == dList->cap)
+	{
+		char **const ptrs = (char**)realloc(dList->ptrs, sizeof(char*) * (dList->cap + PTR_GROW));
+		if(ptrs == NULL) return false;
+		dList->ptrs = ptrs;
+		dList->cap += PTR_GROW;
+	}
+
+	char *const entry = &chunk->buf[chunk->used];
+	memcpy(entry, meta, ENT_META_SIZE);
+	entry[ENT_META_SIZE] = entType;
+	strcpy(&entry[ENT_META_SIZE + 1], name);
+	dList->ptrs[dList->num++] = &entry[ENT_META_SIZE];
+	chunk->used  += size;
+	dList->bytes += size;
+
+	return true;
+}
+
+static void buildFirstCharIndex(DirList *const dList)
+{
+	memset(dList->first, 0xFF, sizeof(dList->first));
+	for(u32 i = dList->num; i-- > 0; )
+	{
+		const char *const ent = dList->ptrs[i];
+		dList->first[(u8)ent[0] & 1u][(u8)ent[1]] = i;
+	}
+}
+
+// Sorts the entries added since the last call and merges them with the sorted ones.
+static void dirListMergeRun(DirList *const dList)
+{
+	const u32 sorted = dList->sorted;
+	const u32 num    = dList->num;
+	if(sorted == num) return;
+
+	char **const ptrs = dList->ptrs;
+	qsort(&ptrs[sorted], num - sorted, sizeof(char*), dlistCompare);
+	if(sorted > 0 && dlistCompare(&ptrs[sorted - 1], &ptrs[sorted]) > 0)
+	{
+		if(g_mergeCap < num)
+		{
+			char **const buf = (char**)realloc(g_mergeBuf, sizeof(char*) * dList->cap);
+			if(buf == NULL)
 			{
-				const char entType = (fis[i].fattrib & AM_DIR ? ENT_TYPE_DIR : ENT_TYPE_FILE);
-				const u32 nameLen = strlen(fis[i].fname);
-				if(entType == ENT_TYPE_FILE)
-				{
-					if(nameLen <= filterLen || strcmp(filter, fis[i].fname + nameLen - filterLen) != 0
-					   || fis[i].fname[0] == '.')
-						continue;
-				}
+				// Slow but always works.
+				qsort(ptrs, num, sizeof(char*), dlistCompare);
+				goto merged;
+			}
+			g_mergeBuf = buf;
+			g_mergeCap = dList->cap;
+		}
+
+		char **out = g_mergeBuf;
+		u32 a = 0, b = sorted;
+		while(a < sorted && b < num)
+			*out++ = (dlistCompare(&ptrs[a], &ptrs[b]) <= 0 ? ptrs[a++] : ptrs[b++]);
+		while(a < sorted) *out++ = ptrs[a++];
+		while(b < num)    *out++ = ptrs[b++];
+		memcpy(ptrs, g_mergeBuf, sizeof(char*) * num);
+	}
 
-				// nameLen does not include the entry type and NULL termination.
-				if(entBufPos + nameLen + 2 > MAX_ENT_BUF_SIZE) goto scanEnd;
+merged:
+	dList->sorted = num;
+	buildFirstCharIndex(dList);
+}
+
+static bool dirListEqual(const DirList *const a, const DirList *const b)
+{
+	if(a->num != b->num) return false;
+
+	for(u32 i = 0; i < a->num; i++)
+	{
+		const char *const entA = a->ptrs[i];
+		const u32 size = entrySize(entA);
+		if(size != entrySize(b->ptrs[i]) || memcmp(entA - ENT_META_SIZE, b->ptrs[i] - ENT_META_SIZE, size) != 0)
+			return false;
+	}
+
+	return true;
+}
+
+// Returns the first entry with the next first character. Dirs are followed by files.
+static u32 jumpNext(const DirList *const dList, const u32 cur)
+{
+	const char *const ent = dList->ptrs[cur];
+	u32 type = (u8)ent[0] & 1u;
+	u32 c    = (u8)ent[1] + 1;
+	while(1)
+	{
+		for(; c < 256; c++)
+			if(dList->first[type][c] >= 0) return dList->first[type][c];
+
+		if(type == ENT_TYPE_FILE) return cur;
+		type = ENT_TYPE_FILE;
+		c    = 0;
+	}
+}
+
+// Returns the start of the current first character or the one before.
+static u32 jumpPrev(const DirList *const dList, const u32 cur)
+{
+	const char *const ent = dList->ptrs[cur];
+	u32 type = (u8)ent[0] & 1u;
+	s32 c    = (u8)ent[1];
+	if((u32)dList->first[type][c] < cur) return dList->first[type][c];
+
+	c--;
+	while(1)
+	{
+		for(; c >= 0; c--)
+			if(dList->first[type][c] >= 0) return dList->first[type][c];
+
+		if(type == ENT_TYPE_DIR) return cur;
+		type = ENT_TYPE_DIR;
+		c    = 255;
+	}
+}
+
+static void dirScanEnd(DirScan *const scan)
+{
+	if(!scan->active) return;
+
+	fCloseDir(scan->dh);
+	free(scan->fis);
+	scan->active = false;
+	dirListMergeRun(scan->dList);
+}
+
+static Result dirScanStart(DirScan *const scan, const char *const path, DirList *const dList, const char *const filter)
+{
+	scan->active = false;
+	scan->fis = (FILINFO*)malloc(sizeof(FILINFO) * DIR_READ_BLOCKS);
+	if(scan->fis == NULL) return RES_OUT_OF_MEM;
 
-				char *const entry = &dList->entBuf[entBufPos];
-				*entry = entType;
-				safeStrcpy(&entry[1], fis[i].fname, 256);
-				dList->ptrs[numEntries++] = entry;
-				entBufPos += nameLen + 2;
+	dirListClear(dList);
+	buildFirstCharIndex(dList);
+	scan->dList  = dList;
+	scan->filter = filter;
+
+	const Result res = fOpenDir(&scan->dh, path);
+	if(res != RES_OK)
+	{
+		free(scan->fis);
+		return res;
+	}
+	scan->active = true;
+
+	return RES_OK;
+}
+
+// Reads up to blocks * DIR_READ_BLOCKS entries and merges them into the sorted list.
+// Stops early once minEntries are in the list.
+static Result dirScanStep(DirScan *const scan, u32 blocks, const u32 minEntries)
+{
+	DirList *const dList = scan->dList;
+	FILINFO *const fis = scan->fis;
+	const u32 filterLen = strlen(scan->filter);
+	Result res = RES_OK;
+	bool done = false;
+	while(blocks-- > 0 && !done && dList->num < minEntries)
+	{
+		u32 read; // Number of entries read by fReadDir().
+		if((res = fReadDir(scan->dh, fis, DIR_READ_BLOCKS, &read)) != RES_OK) break;
+		done = read < DIR_READ_BLOCKS;
+
+		for(u32 i = 0; i < read; i++)
+		{
+			const char entType = (fis[i].fattrib & AM_DIR ? ENT_TYPE_DIR : ENT_TYPE_FILE);
+			const u32 nameLen = strlen(fis[i].fname);
+			if(entType == ENT_TYPE_FILE)
+			{
+				if(nameLen <= filterLen || strcmp(scan->filter, fis[i].fname + nameLen - filterLen) != 0
+				   || fis[i].fname[0] == '.')
+					continue;
+			}
+
+			// Size and modification time detect changed entries.
+			const u32 meta[2] = {(u32)fis[i].fsize, (u32)fis[i].fdate<<16 | fis[i].ftime};
+			if(!dirListAdd(dList, meta, entType, fis[i].fname))
+			{
+				res  = RES_OUT_OF_MEM;
+				done = true;
+				break;
+			}
+		}
+	}
+
+	if(res != RES_OK || done) dirScanEnd(scan);
+	else                      dirListMergeRun(dList);
+
+	return res;
+}
+
+static u32 hashPath(const char *path)
+{
+	// 32 bit FNV-1a.
+	u32 hash = 2166136261u;
+	while(*path != '\0')
+	{
+		hash ^= (u8)*path++;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+static void makeLibraryPath(const char *const dirPath, char libPath[32])
+{
+	ee_sprintf(libPath, OAF_LIBRARY_DIR "/%08lX.bin", hashPath(dirPath));
+}
+
+static Result libraryLoad(const char *const path, DirList *const dList)
+{
+	char libPath[32];
+	makeLibraryPath(path, libPath);
+
+	FHandle f;
+	Result res = fOpen(&f, libPath, FA_OPEN_EXISTING | FA_READ);
+	if(res != RES_OK) return res;
+
+	char *buf = NULL;
+	do
+	{
+		LibraryHeader hdr;
+		u32 read;
+		res = fRead(f, &hdr, sizeof(hdr), &read);
+		if(res != RES_OK) break;
+
+		// Hash collisions are caught by comparing the path.
+		char storedPath[512];
+		const u32 pathLen = strlen(path);
+		if(read != sizeof(hdr) || hdr.magic != LIBRARY_MAGIC || hdr.version != LIBRARY_VERSION
+		   || hdr.pathLen != pathLen || hdr.entBufSize != fSize(f) - sizeof(hdr) - pathLen
+		   || fRead(f, storedPath, pathLen, &read) != RES_OK || read != pathLen
+		   || memcmp(storedPath, path, pathLen) != 0)
+		{
+			res = RES_INVALID_ARG;
+			break;
+		}
+
+		buf = (char*)malloc(hdr.entBufSize);
+		if(buf == NULL)
+		{
+			res = RES_OUT_OF_MEM;
+			break;
+		}
+		if((res = fRead(f, buf, hdr.entBufSize, &read)) != RES_OK) break;
+
+		// Entries must be null terminated within the buffer.
+		dirListClear(dList);
+		u32 pos = 0;
+		while(pos + ENT_META_SIZE + 2 <= read)
+		{
+			const char *const ent = &buf[pos + ENT_META_SIZE];
+			if(memchr(&ent[1], '\0', read - (pos + ENT_META_SIZE + 1)) == NULL) break;
+			if(!dirListAdd(dList, &buf[pos], ent[0], &ent[1]))
+			{
+				res = RES_OUT_OF_MEM;
+				break;
 			}
-		} while(read == DIR_READ_BLOCKS);
+			pos += entrySize(ent);
+		}
+		if(res == RES_OK && (dList->num != hdr.num || pos != hdr.entBufSize)) res = RES_INVALID_ARG;
+
+		// Stored sorted.
+		dList->sorted = dList->num;
+		buildFirstCharIndex(dList);
+	} while(0);
 
-scanEnd:
-		dList->num = numEntries;
+	free(buf);
+	fClose(f);
+
+	return res;
+}
+
+// Not fatal if it fails. The directory is scanned again next time.
+static void libraryStore(const char *const path, const DirList *const dList)
+{
+	// Entries are stored in sorted order so loading doesn't need to sort.
+	char *const buf = (char*)malloc(dList->bytes);
+	if(buf == NULL) return;
+
+	u32 pos = 0;
+	for(u32 i = 0; i < dList->num; i++)
+	{
+		const u32 size = entrySize(dList->ptrs[i]);
+		memcpy(&buf[pos], dList->ptrs[i] - ENT_META_SIZE, size);
+		pos += size;
+	}
 
-		fCloseDir(dh);
+	const LibraryHeader hdr = {LIBRARY_MAGIC, LIBRARY_VERSION, strlen(path), dList->num, pos};
+	char libPath[32];
+	makeLibraryPath(path, libPath);
+	FHandle f;
+	if(fOpen(&f, libPath, FA_CREATE_ALWAYS | FA_WRITE) == RES_OK)
+	{
+		u32 written;
+		Result res = fWrite(f, &hdr, sizeof(hdr), &written);
+		if(res == RES_OK) res = fWrite(f, path, hdr.pathLen, &written);
+		if(res == RES_OK) res = fWrite(f, buf, pos, &written);
+		fClose(f);
+
+		// Don't leave a broken index behind.
+		if(res != RES_OK) fUnlink(libPath);
 	}
 
-	free(fis);
+	free(buf);
+}
+
+// Shows the index right away if there is one and starts checking it in the background.
+// Otherwise the list is scanned into dList until the first screen is full.
+// The rest is scanned in the background.
+static Result openDir(const char *const path, DirList *const dList, DirScan *const scan, DirList *const scanList)
+{
+	if(libraryLoad(path, dList) == RES_OK)
+	{
+		// If the rescan can't be started the index is still good enough.
+		dirScanStart(scan, path, scanList, ".gba");
+		return RES_OK;
+	}
 
-	qsort(dList->ptrs, dList->num, sizeof(char*), dlistCompare);
+	Result res = dirScanStart(scan, path, dList, ".gba");
+	if(res == RES_OK) res = dirScanStep(scan, 0xFFFFFFFFu, SCREEN_ROWS);
+	if(res == RES_OK && !scan->active) libraryStore(path, dList);
 
 	return res;
 }
 
+// Copies the entry pointers in the window starting at start. Returns how many there are.
+static u32 dirListWindow(const DirList *const dList, const u32 start, char *out[SCREEN_ROWS])
+{
+	if(start >= dList->num) return 0;
+
+	const u32 num = (dList->num - start > SCREEN_ROWS ? SCREEN_ROWS : dList->num - start);
+	memcpy(out, &dList->ptrs[start], sizeof(char*) * num);
+
+	return num;
+}
+
 static void showDirList(const DirList *const dList, u32 start)
 {
 	// Clear screen.
@@ -145,16 +544,27 @@ Result browseFiles(const char *const basePath, char selected[512])
 	if(curDir == NULL) return RES_OUT_OF_MEM;
 	safeStrcpy(curDir, basePath, 512);
 
-	DirList *const dList = (DirList*)malloc(sizeof(DirList));
-	if(dList == NULL) return RES_OUT_OF_MEM;
+	// The second list is filled by the background rescan.
+	DirList *dList = dirListAlloc();
+	DirList *scanList = dirListAlloc();
+	if(dList == NULL || scanList == NULL)
+	{
+		dirListFree(scanList);
+		dirListFree(dList);
+		free(curDir);
+		return RES_OUT_OF_MEM;
+	}
 
 	Result res;
-	if((res = scanDir(curDir, dList, ".gba")) != RES_OK) goto end;
+	DirScan scan = {0};
+	if((res = openDir(curDir, dList, &scan, scanList)) != RES_OK) goto end;
 	showDirList(dList, 0);
 
 	s32 cursorPos = 0; // Within the entire list.
 	u32 windowPos = 0; // Window start position within the list.
 	s32 oldCursorPos = 0;
+	bool storePending = false; // Index writes wait until the user is idle or leaves the directory.
+	u32 idleFrames = 0;
 	while(1)
 	{
 		ee_printf("\x1b[%lu;H ", oldCursorPos - windowPos + 1);      // Clear old cursor.
@@ -169,6 +579,49 @@ Result browseFiles(const char *const basePath, char selected[512])
 			hidScanInput();
 			if(hidGetExtraKeys(0) & (KEY_POWER_HELD | KEY_POWER)) goto end;
 			kDown = hidKeysDown();
+
+			idleFrames = (kDown != 0 ? 0 : idleFrames + 1);
+			if(storePending && idleFrames >= STORE_IDLE_FRAMES)
+			{
+				libraryStore(curDir, dList);
+				storePending = false;
+			}
+
+			// Keys are handled against the list on screen. Scanning only
+			// continues on VBlanks without new key presses.
+			if(kDown != 0 || !scan.active) continue;
+
+			char *shown[SCREEN_ROWS];
+			const u32 numShown = dirListWindow(dList, windowPos, shown);
+			if(dirScanStep(&scan, SCAN_STEP_BLOCKS, 0xFFFFFFFFu) == RES_OK)
+			{
+				if(scan.dList == dList)
+				{
+					// Show new entries as they are merged in. Only redraw if the window changed.
+					if(!scan.active) storePending = true;
+					char *merged[SCREEN_ROWS];
+					if(dirListWindow(dList, windowPos, merged) == numShown
+					   && memcmp(merged, shown, sizeof(char*) * numShown) == 0) continue;
+					showDirList(dList, windowPos);
+					break;
+				}
+
+				// Replace the list if the directory changed since the index was written.
+				if(!scan.active && !dirListEqual(dList, scanList))
+				{
+					DirList *const tmp = dList;
+					dList    = scanList;
+					scanList = tmp;
+					storePending = true;
+
+					// The new list may be shorter.
+					if((u32)cursorPos >= dList->num) cursorPos = (dList->num > 0 ? dList->num - 1 : 0);
+					if(windowPos > (u32)cursorPos)   windowPos = cursorPos;
+					oldCursorPos = cursorPos;
+					showDirList(dList, windowPos);
+					break;
+				}
+			}
 		} while(kDown == 0);
 
 		const u32 num = dList->num;
@@ -187,6 +640,8 @@ Result browseFiles(const char *const basePath, char selected[512])
 			}
 			if(kDown & KEY_DUP)    cursorPos -= 1;
 			if(kDown & KEY_DDOWN)  cursorPos += 1;
+			if(kDown & KEY_R)      cursorPos = jumpNext(dList, cursorPos);
+			if(kDown & KEY_L)      cursorPos = jumpPrev(dList, cursorPos);
 		}
 
 		if(cursorPos < 0)              cursorPos = num - 1; // Wrap to end of list.
@@ -205,6 +660,13 @@ Result browseFiles(const char *const basePath, char selected[512])
 
 		if(kDown & (KEY_A | KEY_B))
 		{
+			// Leaving the directory.
+			if(storePending)
+			{
+				libraryStore(curDir, dList);
+				storePending = false;
+			}
+
 			u32 pathLen = strlen(curDir);
 
 			if(kDown & KEY_A && num != 0)
@@ -227,7 +689,8 @@ Result browseFiles(const char *const basePath, char selected[512])
 				*tmpPathPtr = '\0';
 			}
 
-			if((res = scanDir(curDir, dList, ".gba")) != RES_OK) break;
+			dirScanEnd(&scan);
+			if((res = openDir(curDir, dList, &scan, scanList)) != RES_OK) break;
 			cursorPos = 0;
 			windowPos = 0;
 			showDirList(dList, 0);
@@ -235,11 +698,14 @@ Result browseFiles(const char *const basePath, char selected[512])
 	}
 
 end:
-	free(dList);
+	dirScanEnd(&scan);
+	dirListFree(scanList);
+	dirListFree(dList);
+	freeChunkPool();
 	free(curDir);
 
 	// Clear screen.
 	ee_printf("\x1b[2J");
 
 	return res;
-}
\ No newline at end of file
+}
@@ -0,0 +1,90 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+#include "arm11/frame_pacing.h"
+#include "arm11/config.h"
+#include "arm11/drivers/gx.h"
+
+
+// PDC timing registers (in words). Not part of the regs struct.
+#define PDC_V_TOTAL       (0x24u / 4) // Lines per frame - 1.
+#define PDC_V_COUNT       (0x54u / 4) // Current line (read only).
+
+#define LCD_ACTIVE_LINES  (400u)
+// Capture should be done this many lines before VBlank (about 2 ms).
+// Leaves time to render and transfer the frame before the buffer swap.
+#define PACING_MARGIN     (48u)
+#define PACING_TARGET     (LCD_ACTIVE_LINES - PACING_MARGIN)
+#define PACING_FAST_ERR   (8)         // Use bigger steps above this error in lines.
+
+
+static u32 g_baseVTotal = 0;
+static bool g_pacingEnabled = false;
+
+
+
+static vu32* getPdc0Regs(void)
+{
+	return (vu32*)&getGxRegs()->pdc0;
+}
+
+void framePacingInit(void)
+{
+	g_baseVTotal    = getPdc0Regs()[PDC_V_TOTAL];
+	g_pacingEnabled = g_oafConfig.framePacing;
+}
+
+u32 framePacingUpdate(void)
+{
+	vu32 *const pdc = getPdc0Regs();
+	const u32 vTotal = pdc[PDC_V_TOTAL];
+	const u32 lines  = vTotal + 1;
+	const u32 vCount = pdc[PDC_V_COUNT];
+
+	// Phase error in lines wrapped to +-half a frame.
+	// Positive means the LCD is ahead and must run slower.
+	s32 err = (s32)vCount - (s32)PACING_TARGET;
+	if(err > (s32)lines / 2)  err -= lines;
+	if(err < -(s32)lines / 2) err += lines;
+
+	if(g_pacingEnabled)
+	{
+		// The GBA refresh rate (59.73 Hz) is between the 3DS default
+		// (about 59.83 Hz) and 1 line more per frame. Dither between them.
+		s32 adjust;
+		if(err > PACING_FAST_ERR)       adjust = 2;
+		else if(err > 0)                adjust = 1;
+		else if(err < -PACING_FAST_ERR) adjust = -1;
+		else                            adjust = 0;
+
+		// Never move the end of the frame below the current line.
+		const u32 newTotal = g_baseVTotal + adjust;
+		if(newTotal != vTotal && vCount + 4 < newTotal) pdc[PDC_V_TOTAL] = newTotal;
+	}
+
+	// In lock the LCD frame is as long as a GBA frame.
+	const u32 absErr = (err < 0 ? -err : err);
+	return absErr * GBA_FRAME_US / lines;
+}
+
+void framePacingExit(void)
+{
+	if(g_pacingEnabled) getPdc0Regs()[PDC_V_TOTAL] = g_baseVTotal;
+	g_pacingEnabled = false;
+}
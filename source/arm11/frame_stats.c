@@ -0,0 +1,185 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include "types.h"
+#include "arm11/frame_stats.h"
+#include "arm11/frame_pacing.h"
+#include "arm11/config.h"
+#include "arm11/recorder.h"
+#include "arm11/fmt.h"
+#include "fsutil.h"
+#include "oaf_error_codes.h"
+
+
+#define FRAME_STATS_PATH     "frame_stats.txt" // Relative to work dir.
+#define FRAME_STATS_BUCKETS  (256u)
+
+
+typedef enum
+{
+	STAT_PERIOD       = 0u, // Frame start to frame start.
+	STAT_WAKE         = 1u, // Conversion finished to frame handler wakeup.
+	STAT_RENDER       = 2u, // Wakeup to P3D done.
+	STAT_PRESENT_WAIT = 3u, // P3D done to transfer start. Waiting for the last frame.
+	STAT_TRANSFER     = 4u, // Display transfer.
+	STAT_SWAP         = 5u, // PPF done to buffers swapped.
+	STAT_TOTAL        = 6u, // Frame start to buffers swapped.
+	STAT_CAPTURE      = 7u, // Buffers swapped to screenshot and recording copies done.
+	STAT_INPUT_AGE    = 8u, // Input state pushed to frame start. How old the buttons are the game saw last.
+	STAT_PHASE_ERR    = 9u, // Distance of capture done from the frame pacing target.
+	STAT_NUM          = 10u
+} Stat;
+
+typedef struct
+{
+	u32 min;
+	u32 max;
+	u64 sum;
+	u32 buckets[FRAME_STATS_BUCKETS]; // The last bucket also counts everything above.
+} StatHist;
+
+typedef struct
+{
+	bool enabled;
+	u8 scaler;
+	bool skipPeriod; // Set by frameStatsResume().
+	u32 frames;
+	u32 periods;
+	u32 missed;
+	u32 lastStart;
+	StatHist hist[STAT_NUM];
+} FrameStats;
+
+static FrameStats g_frameStats = {0};
+
+// Bucket width in µs as shift. Periods need a bigger range.
+static const u8 g_bucketShift[STAT_NUM] = {7, 3, 3, 3, 3, 3, 4, 3, 6, 6};
+static const char *const g_statNames[STAT_NUM] =
+{
+	"period", "wake", "render", "present wait", "transfer", "swap", "total", "capture", "input age", "phase error"
+};
+
+
+
+static void addSample(StatHist *const h, const u32 shift, const u32 us)
+{
+	if(us < h->min) h->min = us;
+	if(us > h->max) h->max = us;
+	h->sum += us;
+
+	u32 idx = us>>shift;
+	if(idx >= FRAME_STATS_BUCKETS) idx = FRAME_STATS_BUCKETS - 1;
+	h->buckets[idx]++;
+}
+
+// Returns the upper bucket bound the given permille of samples are below (at most the max).
+static u32 getPercentile(const StatHist *const h, const u32 shift, const u32 count, const u32 permille)
+{
+	const u32 target = (u32)(((u64)count * permille + 999) / 1000);
+	u32 seen = 0;
+	for(u32 i = 0; i < FRAME_STATS_BUCKETS - 1; i++)
+	{
+		seen += h->buckets[i];
+		if(seen >= target) return ((i + 1)<<shift < h->max ? (i + 1)<<shift : h->max);
+	}
+
+	return h->max;
+}
+
+void frameStatsInit(const u8 scaler)
+{
+	FrameStats *const s = &g_frameStats;
+	memset(s, 0, sizeof(FrameStats));
+	if(!g_oafConfig.frameStats) return;
+
+	s->enabled = true;
+	s->scaler  = scaler;
+	for(u32 i = 0; i < STAT_NUM; i++) s->hist[i].min = 0xFFFFFFFFu;
+}
+
+void frameStatsAdd(const FrameTimes *const times)
+{
+	FrameStats *const s = &g_frameStats;
+	if(!s->enabled) return;
+
+	const u32 *const t = times->t;
+	const u32 start = t[FRAME_MARK_START];
+	u32 us[STAT_NUM];
+	us[STAT_WAKE]         = cycleCounterToUs(t[FRAME_MARK_WAKE] - start);
+	us[STAT_RENDER]       = cycleCounterToUs(t[FRAME_MARK_P3D] - t[FRAME_MARK_WAKE]);
+	us[STAT_PRESENT_WAIT] = cycleCounterToUs(t[FRAME_MARK_TRANSFER] - t[FRAME_MARK_P3D]);
+	us[STAT_TRANSFER]     = cycleCounterToUs(t[FRAME_MARK_PPF] - t[FRAME_MARK_TRANSFER]);
+	us[STAT_SWAP]         = cycleCounterToUs(t[FRAME_MARK_SWAP] - t[FRAME_MARK_PPF]);
+	us[STAT_TOTAL]        = cycleCounterToUs(t[FRAME_MARK_SWAP] - start);
+	us[STAT_CAPTURE]      = cycleCounterToUs(t[FRAME_MARK_CAPTURE] - t[FRAME_MARK_SWAP]);
+	// The poll task may push new input between frame start and wakeup.
+	us[STAT_INPUT_AGE]    = ((s32)(start - t[FRAME_MARK_INPUT]) > 0 ? cycleCounterToUs(start - t[FRAME_MARK_INPUT]) : 0);
+	us[STAT_PHASE_ERR]    = times->phaseErrUs;
+	for(u32 i = STAT_WAKE; i < STAT_NUM; i++) addSample(&s->hist[i], g_bucketShift[i], us[i]);
+
+	// No period for the first frame and the first one after a pause.
+	if(s->frames > 0 && !s->skipPeriod)
+	{
+		const u32 period = cycleCounterToUs(start - s->lastStart);
+		addSample(&s->hist[STAT_PERIOD], g_bucketShift[STAT_PERIOD], period);
+
+		// Count every frame we didn't present in time.
+		if(period > GBA_FRAME_US + GBA_FRAME_US / 2)
+			s->missed += (period + GBA_FRAME_US / 2) / GBA_FRAME_US - 1;
+		s->periods++;
+	}
+	s->skipPeriod = false;
+	s->lastStart  = start;
+	s->frames++;
+}
+
+void frameStatsResume(void)
+{
+	g_frameStats.skipPeriod = true;
+}
+
+Result frameStatsDump(void)
+{
+	const FrameStats *const s = &g_frameStats;
+	if(!s->enabled) return RES_OK;
+
+	static const char *const scalerNames[3] = {"none", "bilinear", "matrix"};
+	static char buf[1024];
+	u32 len = ee_sprintf(buf, "scaler: %s\nframes: %lu\nmissed: %lu\n\n", scalerNames[s->scaler], s->frames, s->missed);
+	for(u32 i = 0; i < STAT_NUM && s->frames > 1; i++)
+	{
+		const StatHist *const h = &s->hist[i];
+		const u32 count = (i == STAT_PERIOD ? s->periods : s->frames);
+		if(count == 0) continue;
+		len += ee_sprintf(&buf[len], "%s: min %lu avg %lu p99 %lu max %lu us\n", g_statNames[i], h->min,
+		                  (u32)(h->sum / count), getPercentile(h, g_bucketShift[i], count, 990), h->max);
+	}
+
+	// Recording runs outside the display path. Only the frame copies show up in "capture".
+	RecorderStats rec;
+	recorderGetStats(&rec);
+	if(rec.frames > 0)
+	{
+		len += ee_sprintf(&buf[len], "\nrecorded: %lu\ndropped: %lu\nwritten: %lu bytes\nring max: %lu bytes\n",
+		                  rec.frames, rec.dropped, rec.bytes, rec.maxRing);
+	}
+	debug_printf("%s", buf);
+
+	return fsQuickWrite(FRAME_STATS_PATH, buf, len);
+}
@@ -22,209 +22,416 @@
 #include "drivers/cache.h"
 
 
-// 360x240 without scaling, no filter.
-alignas(16) u8 gbaGpuInitList[GBA_INIT_LIST_SIZE] =
-{
-	0x01, 0x00, 0x00, 0x00, 0x10, 0x01, 0x0F, 0x00, 0x00, 0x00, 0x06, 0x03,
-	0x1C, 0x01, 0x2F, 0x80, 0x00, 0x00, 0x03, 0x03, 0xF0, 0xF0, 0x18, 0x01,
-	0xF0, 0xF0, 0x18, 0x01, 0x6E, 0x00, 0x0F, 0x00, 0x03, 0x00, 0x00, 0x00,
-	0x16, 0x01, 0x0F, 0x00, 0x01, 0x00, 0x01, 0x00, 0x17, 0x01, 0x0F, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x1B, 0x01, 0x0F, 0x00, 0x0F, 0x00, 0x00, 0x00,
-	0x12, 0x01, 0x3F, 0x80, 0x0F, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00,
-	0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xE0, 0x45, 0x00,
-	0x41, 0x00, 0x3F, 0x80, 0x12, 0x11, 0x11, 0x38, 0x00, 0x90, 0x46, 0x00,
-	0x14, 0xAE, 0x47, 0x37, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x68, 0x00, 0x0F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x65, 0x00, 0x2F, 0x80,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x29, 0x02, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x53, 0x02, 0x03, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x44, 0x02, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0xCB, 0x02, 0x0F, 0x00, 0x00, 0x00, 0x00, 0x4E, 0xCC, 0x02, 0x7F, 0x00,
-	0x01, 0xF0, 0x07, 0x4E, 0x02, 0x08, 0x02, 0x08, 0x03, 0x18, 0x02, 0x08,
-	0x04, 0x28, 0x02, 0x08, 0x05, 0x38, 0x02, 0x08, 0x06, 0x10, 0x20, 0x4C,
-	0x00, 0x00, 0x00, 0x88, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
-	0xBF, 0x02, 0x0F, 0x00, 0x00, 0x00, 0x00, 0x00, 0xD5, 0x02, 0x0F, 0x00,
-	0x6E, 0x03, 0x00, 0x00, 0xD6, 0x02, 0x6F, 0x00, 0xA1, 0x0A, 0x00, 0x00,
-	0x68, 0xC3, 0x06, 0x00, 0x64, 0xC3, 0x06, 0x00, 0x62, 0xC3, 0x06, 0x00,
-	0x61, 0xC3, 0x06, 0x00, 0x6F, 0x03, 0x00, 0x00, 0x00, 0x00, 0xFF, 0x7F,
-	0xBA, 0x02, 0x0F, 0x00, 0x03, 0x00, 0x00, 0x00, 0xBD, 0x02, 0x0F, 0x00,
-	0x01, 0x00, 0x00, 0x00, 0x4A, 0x02, 0x0F, 0x00, 0x01, 0x00, 0x00, 0x00,
-	0x51, 0x02, 0x0F, 0x00, 0x01, 0x00, 0x00, 0x00, 0x5E, 0x02, 0x01, 0x00,
-	0x02, 0x00, 0x00, 0x00, 0x4F, 0x00, 0x7F, 0x80, 0x00, 0x01, 0x02, 0x03,
-	0x0C, 0x0D, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F,
-	0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F,
-	0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x64, 0x00, 0x0F, 0x00,
-	0x01, 0x01, 0x00, 0x00, 0x6F, 0x00, 0x0F, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x29, 0x02, 0x0A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x52, 0x02, 0x0F, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x54, 0x02, 0x0F, 0x00, 0x00, 0x00, 0x00, 0xA0,
-	0x89, 0x02, 0x0F, 0x00, 0x7B, 0x00, 0x00, 0x00, 0x01, 0x02, 0x1F, 0x80,
-	0x00, 0x00, 0xFC, 0x1F, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0xA0,
-	0xB9, 0x02, 0x0B, 0x00, 0x01, 0x00, 0x00, 0x00, 0x42, 0x02, 0x0F, 0x00,
-	0x10, 0x00, 0x00, 0x00, 0xBB, 0x02, 0x1F, 0x80, 0x00, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x6D, 0x00, 0x0F, 0x00,
-	0x02, 0x00, 0x00, 0x00, 0x40, 0x00, 0x0F, 0x00, 0x00, 0x00, 0xBF, 0x00,
-	0x4D, 0x00, 0x1F, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x10, 0x00, 0x00, 0x00, 0x04, 0x01, 0x3F, 0x80, 0x10, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x10, 0x0F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x26, 0x01, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x03, 0x01, 0x0F, 0x00, 0x00, 0x00, 0x76, 0x76, 0x01, 0x01, 0x0F, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x02, 0x01, 0x0F, 0x00, 0x00, 0x01, 0xE4, 0x00,
-	0x00, 0x01, 0x07, 0x00, 0x00, 0x3C, 0x00, 0x80, 0x30, 0x01, 0x0F, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x62, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x18, 0x01, 0x0F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x61, 0x00, 0x01, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x6A, 0x00, 0x07, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x81, 0x00, 0x4F, 0x80, 0x00, 0x02, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00, // Last 4 bytes: GPUREG_TEXUNIT0_PARAM.
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x03, 0x02, 0x00, 0x00, 0x00, // Last 4 bytes: GPUREG_TEXUNIT0_TYPE.
-	0x8E, 0x00, 0x0F, 0x00, 0x01, 0x10, 0x01, 0x00, 0x80, 0x00, 0x0B, 0x00,
-	0x00, 0x00, 0x01, 0x00, 0x80, 0x00, 0x04, 0x00, 0x01, 0x00, 0x00, 0x00,
-	0x8B, 0x00, 0x0F, 0x00, 0x00, 0x00, 0x00, 0x00, 0xE0, 0x00, 0x07, 0x00,
-	0xFF, 0xFF, 0xFF, 0xFF, 0xFD, 0x00, 0x0F, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0xE1, 0x00, 0x0F, 0x00, 0x03, 0x00, 0x03, 0x00, 0xC0, 0x00, 0x4F, 0x80,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF,
-	0x00, 0x00, 0x00, 0x00, 0x0F, 0x00, 0x0F, 0x00, 0xC8, 0x00, 0x4F, 0x80,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF,
-	0x00, 0x00, 0x00, 0x00, 0x0F, 0x00, 0x0F, 0x00, 0xD0, 0x00, 0x4F, 0x80,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF,
-	0x00, 0x00, 0x00, 0x00, 0x0F, 0x00, 0x0F, 0x00, 0xD8, 0x00, 0x4F, 0x80,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF,
-	0x00, 0x00, 0x00, 0x00, 0x0F, 0x00, 0x0F, 0x00, 0xF0, 0x00, 0x4F, 0x80,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF,
-	0x00, 0x00, 0x00, 0x00, 0x0F, 0x00, 0x0F, 0x00, 0xF8, 0x00, 0x4F, 0x80,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF,
-	0x00, 0x00, 0x00, 0x00, 0x5F, 0x00, 0x00, 0x00, 0xC0, 0x02, 0x3F, 0x80,
-	0xBF, 0x00, 0x00, 0x3E, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0xC0, 0x02, 0x0F, 0x00,
-	0x00, 0x00, 0x80, 0xBF, 0xC1, 0x02, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x89, 0x88, 0x08, 0x3C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0x3F,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0A, 0xD7, 0xA3, 0xBB,
-	0x00, 0x00, 0x80, 0xBF, 0x00, 0x00, 0x80, 0x3F, 0x00, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0x3F, 0x00, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0xFF, 0x7F, 0xB0, 0x02, 0x0F, 0x00, 0x00, 0x01, 0x00, 0x00,
-	0x5E, 0x02, 0x02, 0x00, 0x01, 0x00, 0x00, 0x00, 0x5F, 0x02, 0x0F, 0x00,
-	0x00, 0x00, 0x00, 0x80, 0x27, 0x02, 0x0F, 0x00, 0x01, 0x00, 0x00, 0x00,
-	0x53, 0x02, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x45, 0x02, 0x01, 0x00,
-	0x0F, 0x00, 0x00, 0x00, 0x32, 0x02, 0x0F, 0x00, 0x3E, 0x00, 0x00, 0x3F,
-	0x33, 0x02, 0x2F, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x40, 0x43, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x33, 0x02, 0x2F, 0x80, 0x10, 0x3E, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x3E, 0x00, 0x00, 0x3F, 0x33, 0x02, 0x2F, 0x80,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x7C, 0x47, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x33, 0x02, 0x2F, 0x80, 0x10, 0x3E, 0x00, 0x00, 0x00, 0x68, 0x3E, 0x00,
-	0x3E, 0x00, 0x00, 0x3F, 0x33, 0x02, 0x2F, 0x80, 0xE0, 0x46, 0x00, 0x00,
-	0x00, 0x40, 0x43, 0x00, 0x00, 0x00, 0x00, 0x00, 0x33, 0x02, 0x2F, 0x80,
-	0x00, 0x3F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3E, 0x00, 0x00, 0x3F,
-	0x33, 0x02, 0x2F, 0x80, 0xE0, 0x46, 0x00, 0x00, 0x00, 0x7C, 0x47, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x33, 0x02, 0x2F, 0x80, 0x00, 0x3F, 0x00, 0x00,
-	0x00, 0x68, 0x3E, 0x00, 0x01, 0x00, 0x00, 0x00, 0x45, 0x02, 0x01, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x53, 0x02, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00,
-	0x31, 0x02, 0x0F, 0x00, 0x01, 0x00, 0x00, 0x00, 0x11, 0x01, 0x0F, 0x00,
-	0x01, 0x00, 0x00, 0x00, 0x10, 0x01, 0x0F, 0x00, 0x01, 0x00, 0x00, 0x00,
-	0x63, 0x00, 0x0F, 0x00, 0x78, 0x56, 0x34, 0x12, 0x10, 0x00, 0x0F, 0x00,
-	0x78, 0x56, 0x34, 0x12, 0x10, 0x00, 0x0F, 0x00
-};
+// PICA200 registers used by the lists.
+#define GPUREG_FINALIZE                 (0x010u)
+#define GPUREG_FACECULLING_CONFIG       (0x040u)
+#define GPUREG_VIEWPORT_WIDTH           (0x041u)
+#define GPUREG_DEPTHMAP_SCALE           (0x04Du)
+#define GPUREG_SH_OUTMAP_TOTAL          (0x04Fu)
+#define GPUREG_EARLYDEPTH_FUNC          (0x061u)
+#define GPUREG_EARLYDEPTH_TEST1         (0x062u)
+#define GPUREG_EARLYDEPTH_CLEAR         (0x063u)
+#define GPUREG_SH_OUTATTR_MODE          (0x064u)
+#define GPUREG_SCISSORTEST_MODE         (0x065u)
+#define GPUREG_VIEWPORT_XY              (0x068u)
+#define GPUREG_EARLYDEPTH_DATA          (0x06Au)
+#define GPUREG_DEPTHMAP_ENABLE          (0x06Du)
+#define GPUREG_RENDERBUF_DIM            (0x06Eu)
+#define GPUREG_SH_OUTATTR_CLOCK         (0x06Fu)
+#define GPUREG_TEXUNIT_CONFIG           (0x080u)
+#define GPUREG_TEXUNIT0_BORDER_COLOR    (0x081u)
+#define GPUREG_TEXUNIT0_SHADOW          (0x08Bu)
+#define GPUREG_TEXUNIT0_TYPE            (0x08Eu)
+#define GPUREG_TEXENV0_SOURCE           (0x0C0u)
+#define GPUREG_TEXENV1_SOURCE           (0x0C8u)
+#define GPUREG_TEXENV2_SOURCE           (0x0D0u)
+#define GPUREG_TEXENV3_SOURCE           (0x0D8u)
+#define GPUREG_TEXENV_UPDATE_BUFFER     (0x0E0u)
+#define GPUREG_FOG_COLOR                (0x0E1u)
+#define GPUREG_TEXENV4_SOURCE           (0x0F0u)
+#define GPUREG_TEXENV5_SOURCE           (0x0F8u)
+#define GPUREG_TEXENV_BUFFER_COLOR      (0x0FDu)
+#define GPUREG_COLOR_OPERATION          (0x100u)
+#define GPUREG_BLEND_FUNC               (0x101u)
+#define GPUREG_LOGIC_OP                 (0x102u)
+#define GPUREG_BLEND_COLOR              (0x103u)
+#define GPUREG_FRAGOP_ALPHA_TEST        (0x104u)
+#define GPUREG_FRAMEBUFFER_INVALIDATE   (0x110u)
+#define GPUREG_FRAMEBUFFER_FLUSH        (0x111u)
+#define GPUREG_COLORBUFFER_READ         (0x112u)
+#define GPUREG_DEPTHBUFFER_FORMAT       (0x116u)
+#define GPUREG_COLORBUFFER_FORMAT       (0x117u)
+#define GPUREG_EARLYDEPTH_TEST2         (0x118u)
+#define GPUREG_FRAMEBUFFER_BLOCK32      (0x11Bu)
+#define GPUREG_DEPTHBUFFER_LOC          (0x11Cu)
+#define GPUREG_GAS_DELTAZ_DEPTH         (0x126u)
+#define GPUREG_FRAGOP_SHADOW            (0x130u)
+#define GPUREG_ATTRIBBUFFERS_FORMAT_LOW (0x201u)
+#define GPUREG_INDEXBUFFER_CONFIG       (0x227u)
+#define GPUREG_GEOSTAGE_CONFIG          (0x229u)
+#define GPUREG_VTX_FUNC                 (0x231u)
+#define GPUREG_FIXEDATTRIB_INDEX        (0x232u)
+#define GPUREG_FIXEDATTRIB_DATA0        (0x233u)
+#define GPUREG_VSH_NUM_ATTR             (0x242u)
+#define GPUREG_VSH_COM_MODE             (0x244u)
+#define GPUREG_START_DRAW_FUNC0         (0x245u)
+#define GPUREG_VSH_OUTMAP_TOTAL1        (0x24Au)
+#define GPUREG_VSH_OUTMAP_TOTAL2        (0x251u)
+#define GPUREG_GSH_MISC0                (0x252u)
+#define GPUREG_GEOSTAGE_CONFIG2         (0x253u)
+#define GPUREG_GSH_MISC1                (0x254u)
+#define GPUREG_PRIMITIVE_CONFIG         (0x25Eu)
+#define GPUREG_RESTART_PRIMITIVE        (0x25Fu)
+#define GPUREG_GSH_INPUTBUFFER_CONFIG   (0x289u)
+#define GPUREG_VSH_BOOLUNIFORM          (0x2B0u)
+#define GPUREG_VSH_INPUTBUFFER_CONFIG   (0x2B9u)
+#define GPUREG_VSH_ENTRYPOINT           (0x2BAu)
+#define GPUREG_VSH_ATTR_PERMUTATION_LOW (0x2BBu)
+#define GPUREG_VSH_OUTMAP_MASK          (0x2BDu)
+#define GPUREG_VSH_CODETRANSFER_END     (0x2BFu)
+#define GPUREG_VSH_FLOATUNIFORM_CONFIG  (0x2C0u)
+#define GPUREG_VSH_FLOATUNIFORM_DATA    (0x2C1u)
+#define GPUREG_VSH_CODETRANSFER_CONFIG  (0x2CBu)
+#define GPUREG_VSH_CODETRANSFER_DATA    (0x2CCu)
+#define GPUREG_VSH_OPDESCS_CONFIG       (0x2D5u)
+#define GPUREG_VSH_OPDESCS_DATA         (0x2D6u)
+
+#define TEX_SIZE       (512u)   // Width and height of both textures.
+#define SCREEN_W       (400u)   // The lists draw in top screen coordinates (rotated by the projection).
+#define SCREEN_H       (240u)
+#define QUAD_Z         (0.5f)
+
+
+typedef struct
+{
+	u32 *ptr;
+	u32 *start;
+} GpuCmdBuf;
 
-// 360x240 without scaling, no filter.
-alignas(16) u8 gbaGpuList2[GBA_LIST2_SIZE] =
-{
-	0x01, 0x00, 0x00, 0x00, 0x10, 0x01, 0x0F, 0x00, 0x00, 0x00, 0x06, 0x03,
-	0x1C, 0x01, 0x2F, 0x80, 0x00, 0x00, 0x03, 0x03, 0xF0, 0xF0, 0x18, 0x01,
-	0xF0, 0xF0, 0x18, 0x01, 0x6E, 0x00, 0x0F, 0x00, 0x03, 0x00, 0x00, 0x00,
-	0x16, 0x01, 0x0F, 0x00, 0x01, 0x00, 0x01, 0x00, 0x17, 0x01, 0x0F, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x1B, 0x01, 0x0F, 0x00, 0x0F, 0x00, 0x00, 0x00,
-	0x12, 0x01, 0x3F, 0x80, 0x0F, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00,
-	0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xE0, 0x45, 0x00,
-	0x41, 0x00, 0x3F, 0x80, 0x12, 0x11, 0x11, 0x38, 0x00, 0x90, 0x46, 0x00,
-	0x14, 0xAE, 0x47, 0x37, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x68, 0x00, 0x0F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x65, 0x00, 0x2F, 0x80,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80,
-	0xC0, 0x02, 0x0F, 0x00, 0x00, 0x00, 0x80, 0xBF, 0xC1, 0x02, 0xFF, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x89, 0x88, 0x08, 0x3C, 0x00, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x80, 0x3F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x0A, 0xD7, 0xA3, 0xBB, 0x00, 0x00, 0x80, 0xBF, 0x00, 0x00, 0x80, 0x3F,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0x3F,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x5E, 0x02, 0x02, 0x00,
-	0x01, 0x00, 0x00, 0x00, 0x5F, 0x02, 0x0F, 0x00, 0x00, 0x00, 0x00, 0x80,
-	0x27, 0x02, 0x0F, 0x00, 0x01, 0x00, 0x00, 0x00, 0x53, 0x02, 0x01, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x45, 0x02, 0x01, 0x00, 0x0F, 0x00, 0x00, 0x00,
-	0x32, 0x02, 0x0F, 0x00, 0x3E, 0x00, 0x00, 0x3F, 0x33, 0x02, 0x2F, 0x80,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x40, 0x43, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x33, 0x02, 0x2F, 0x80, 0x10, 0x3E, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x3E, 0x00, 0x00, 0x3F, 0x33, 0x02, 0x2F, 0x80, 0x00, 0x00, 0x00, 0x00,
-	0x00, 0x7C, 0x47, 0x00, 0x00, 0x00, 0x00, 0x00, 0x33, 0x02, 0x2F, 0x80,
-	0x10, 0x3E, 0x00, 0x00, 0x00, 0x68, 0x3E, 0x00, 0x3E, 0x00, 0x00, 0x3F,
-	0x33, 0x02, 0x2F, 0x80, 0xE0, 0x46, 0x00, 0x00, 0x00, 0x40, 0x43, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x33, 0x02, 0x2F, 0x80, 0x00, 0x3F, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x3E, 0x00, 0x00, 0x3F, 0x33, 0x02, 0x2F, 0x80,
-	0xE0, 0x46, 0x00, 0x00, 0x00, 0x7C, 0x47, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x33, 0x02, 0x2F, 0x80, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x68, 0x3E, 0x00,
-	0x01, 0x00, 0x00, 0x00, 0x45, 0x02, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x53, 0x02, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x31, 0x02, 0x0F, 0x00,
-	0x01, 0x00, 0x00, 0x00, 0x11, 0x01, 0x0F, 0x00, 0x01, 0x00, 0x00, 0x00,
-	0x10, 0x01, 0x0F, 0x00, 0x01, 0x00, 0x00, 0x00, 0x63, 0x00, 0x0F, 0x00,
-	0x78, 0x56, 0x34, 0x12, 0x10, 0x00, 0x0F, 0x00, 0x78, 0x56, 0x34, 0x12,
-	0x10, 0x00, 0x0F, 0x00
+alignas(16) u32 gbaGpuInitList[GBA_INIT_LIST_WORDS];
+alignas(16) u32 gbaGpuList2[GBA_LIST2_WORDS];
+u32 gbaGpuInitListSize = 0;
+u32 gbaGpuList2Size = 0;
+static u32 *g_colorBufLoc[2]; // Param words in both lists.
+static u32 *g_texEnv[6];      // Commands of the TEV stages in the init list.
+static u32 *g_texEnvBufUpdate;
+
+// Vertex shader: o0 = c0-c3 * v0 (position), o1 = v1 (texcoord).
+static const u32 g_vshCode[8] =
+{
+	0x4E000000, 0x4E07F001, 0x08020802, 0x08021803, 0x08022804, 0x08023805, 0x4C201006, 0x88000000
+};
+static const u32 g_vshOpdescs[7] =
+{
+	0x0000036E, 0x00000AA1, 0x0006C368, 0x0006C364, 0x0006C362, 0x0006C361, 0x0000036F
 };
 
 
 
-void patchGbaGpuCmdList(const u8 scaleType, const bool useSecondTexture)
+// Command header: register, byte enable mask, number of extra params and incremental (consecutive registers) bit.
+static u32* addCmd(GpuCmdBuf *const b, const u32 reg, const u32 mask, const u32 *const params, const u32 num, const bool incremental)
+{
+	u32 *const cmd = b->ptr;
+	u32 *p = cmd;
+	*p++ = params[0];
+	*p++ = (incremental ? 1u<<31 : 0) | (num - 1)<<20 | mask<<16 | reg;
+	for(u32 i = 1; i < num; i++) *p++ = params[i];
+	if((p - b->start) & 1) *p++ = 0; // Commands are 8 bytes aligned.
+	b->ptr = p;
+
+	return cmd;
+}
+
+static inline u32* addWrite(GpuCmdBuf *const b, const u32 reg, const u32 val)
+{
+	return addCmd(b, reg, 0xF, &val, 1, false);
+}
+
+static inline u32* addMaskedWrite(GpuCmdBuf *const b, const u32 reg, const u32 mask, const u32 val)
+{
+	return addCmd(b, reg, mask, &val, 1, false);
+}
+
+// Writes to reg, reg + 1, reg + 2 ...
+static inline u32* addIncrementalWrites(GpuCmdBuf *const b, const u32 reg, const u32 *const vals, const u32 num)
+{
+	return addCmd(b, reg, 0xF, vals, num, true);
+}
+
+// All values go to the same register (upload ports).
+static inline u32* addWrites(GpuCmdBuf *const b, const u32 reg, const u32 *const vals, const u32 num)
+{
+	return addCmd(b, reg, 0xF, vals, num, false);
+}
+
+// Ends the list. The size must be a multiple of 16 bytes.
+static u32 finishList(GpuCmdBuf *const b)
 {
-	if(useSecondTexture)
+	addWrite(b, GPUREG_FINALIZE, 0x12345678);
+	if((b->ptr - b->start) & 3) addWrite(b, GPUREG_FINALIZE, 0x12345678);
+
+	return (b->ptr - b->start) * 4;
+}
+
+static u32 f32Bits(const float f)
+{
+	u32 bits;
+	memcpy(&bits, &f, 4);
+	return bits;
+}
+
+// 1.7.16 float. Truncates the mantissa.
+static u32 f32ToF24(const float f)
+{
+	const u32 bits = f32Bits(f);
+	const u32 exp = bits>>23 & 0xFFu;
+	if(exp <= 64) return 0; // Zero or too small.
+
+	return (bits>>31)<<23 | (exp - 64)<<16 | (bits & 0x7FFFFFu)>>7;
+}
+
+// 1.7.23 float.
+static u32 f32ToF31(const float f)
+{
+	const u32 bits = f32Bits(f);
+	const u32 exp = bits>>23 & 0xFFu;
+	if(exp <= 64) return 0;
+
+	return (bits>>31)<<30 | (exp - 64)<<23 | (bits & 0x7FFFFFu);
+}
+
+// 4 f24 components in 3 words.
+static void addFixedAttrib(u32 out[3], const float x, const float y, const float z, const float w)
+{
+	const u32 x24 = f32ToF24(x), y24 = f32ToF24(y), z24 = f32ToF24(z), w24 = f32ToF24(w);
+	out[0] = w24<<8 | z24>>16;
+	out[1] = z24<<16 | y24>>8;
+	out[2] = y24<<24 | x24;
+}
+
+static void addColorBuffer(GpuCmdBuf *const b, const u32 listIdx)
+{
+	// Depth is never used but has a location assigned. 240x400 render buffers.
+	const u32 bufs[3] = {GPU_TEXTURE2_ADDR>>3, GPU_RENDER_BUF_ADDR>>3, 0x01000000u | (SCREEN_W - 1)<<12 | SCREEN_H};
+	g_colorBufLoc[listIdx] = addIncrementalWrites(b, GPUREG_DEPTHBUFFER_LOC, bufs, 3) + 2;
+}
+
+// Draws the frame as a triangle strip in immediate mode.
+static void addDraw(GpuCmdBuf *const b, const GbaGpuLayout *const l)
+{
+	addMaskedWrite(b, GPUREG_GEOSTAGE_CONFIG2, 1, 1);
+	addMaskedWrite(b, GPUREG_START_DRAW_FUNC0, 1, 0);
+	addWrite(b, GPUREG_FIXEDATTRIB_INDEX, 0xF);
+
+	const float x0 = l->dstX, x1 = l->dstX + l->dstW;
+	const float y0 = l->dstY, y1 = l->dstY + l->dstH;
+	const float u1 = (float)l->srcW / TEX_SIZE;
+	const float v0 = 1.f - (float)l->srcH / TEX_SIZE;
+	const float verts[4][4] =
+	{
+		{x0, y0, 0.f, v0},
+		{x1, y0, u1,  v0},
+		{x0, y1, 0.f, 1.f},
+		{x1, y1, u1,  1.f}
+	};
+	for(u32 i = 0; i < 4; i++)
 	{
-		u32 tmp = GPU_TEXTURE2_ADDR>>3;
-		memcpy(&gbaGpuInitList[580], &tmp, 4);
-		tmp = 0;
-		memcpy(&gbaGpuInitList[584], &tmp, 4);
+		u32 attrib[3];
+		addFixedAttrib(attrib, verts[i][0], verts[i][1], QUAD_Z, 1.f);
+		addIncrementalWrites(b, GPUREG_FIXEDATTRIB_DATA0, attrib, 3);
+		addFixedAttrib(attrib, verts[i][2], verts[i][3], 0.f, 0.f);
+		addIncrementalWrites(b, GPUREG_FIXEDATTRIB_DATA0, attrib, 3);
 	}
 
-	if(scaleType == 0)
+	addMaskedWrite(b, GPUREG_START_DRAW_FUNC0, 1, 1);
+	addMaskedWrite(b, GPUREG_GEOSTAGE_CONFIG2, 1, 0);
+	addWrite(b, GPUREG_VTX_FUNC, 1);
+	addWrite(b, GPUREG_FRAMEBUFFER_FLUSH, 1);
+	addWrite(b, GPUREG_FRAMEBUFFER_INVALIDATE, 1);
+	addWrite(b, GPUREG_EARLYDEPTH_CLEAR, 1);
+}
+
+static void buildInitList(const GbaGpuLayout *const l)
+{
+	GpuCmdBuf b = {gbaGpuInitList, gbaGpuInitList};
+
+	// Framebuffer.
+	addWrite(&b, GPUREG_FRAMEBUFFER_INVALIDATE, 1);
+	addColorBuffer(&b, 0);
+	addWrite(&b, GPUREG_RENDERBUF_DIM, 0x01000000u | (SCREEN_W - 1)<<12 | SCREEN_H);
+	addWrite(&b, GPUREG_DEPTHBUFFER_FORMAT, 3);         // D24S8.
+	addWrite(&b, GPUREG_COLORBUFFER_FORMAT, 0x00010001); // RGB8.
+	addWrite(&b, GPUREG_FRAMEBUFFER_BLOCK32, 0);
+	const u32 access[4] = {0xF, 0xF, 3, 3};               // Color and depth read/write.
+	addIncrementalWrites(&b, GPUREG_COLORBUFFER_READ, access, 4);
+
+	// Viewport and scissor for the whole 240x400 buffer.
+	const u32 viewport[4] = {f32ToF24(SCREEN_H / 2.f), f32ToF31(2.f / SCREEN_H)<<1, f32ToF24(SCREEN_W / 2.f), f32ToF31(2.f / SCREEN_W)<<1};
+	addIncrementalWrites(&b, GPUREG_VIEWPORT_WIDTH, viewport, 4);
+	addWrite(&b, GPUREG_VIEWPORT_XY, 0);
+	const u32 scissor[3] = {0, 0, 0};
+	addIncrementalWrites(&b, GPUREG_SCISSORTEST_MODE, scissor, 3);
+
+	// Vertex shader without geometry shader.
+	addMaskedWrite(&b, GPUREG_GEOSTAGE_CONFIG, 3, 0);
+	addMaskedWrite(&b, GPUREG_GEOSTAGE_CONFIG2, 3, 0);
+	addMaskedWrite(&b, GPUREG_VSH_COM_MODE, 1, 0);
+	addWrite(&b, GPUREG_VSH_CODETRANSFER_CONFIG, 0);
+	addWrites(&b, GPUREG_VSH_CODETRANSFER_DATA, g_vshCode, 8);
+	addWrite(&b, GPUREG_VSH_CODETRANSFER_END, 1);
+	addWrite(&b, GPUREG_VSH_OPDESCS_CONFIG, 0);
+	addWrites(&b, GPUREG_VSH_OPDESCS_DATA, g_vshOpdescs, 7);
+	addWrite(&b, GPUREG_VSH_ENTRYPOINT, 0x7FFF0000);
+	addWrite(&b, GPUREG_VSH_OUTMAP_MASK, 3);
+	addWrite(&b, GPUREG_VSH_OUTMAP_TOTAL1, 1);
+	addWrite(&b, GPUREG_VSH_OUTMAP_TOTAL2, 1);
+	addMaskedWrite(&b, GPUREG_PRIMITIVE_CONFIG, 1, 1);
+	const u32 outmap[8] = {2, 0x03020100, 0x1F1F0D0C, 0x1F1F1F1F, 0x1F1F1F1F, 0x1F1F1F1F, 0x1F1F1F1F, 0x1F1F1F1F}; // o0 position, o1 texcoord 0.
+	addIncrementalWrites(&b, GPUREG_SH_OUTMAP_TOTAL, outmap, 8);
+	addWrite(&b, GPUREG_SH_OUTATTR_MODE, 1);
+	addWrite(&b, GPUREG_SH_OUTATTR_CLOCK, 0x101);
+	addMaskedWrite(&b, GPUREG_GEOSTAGE_CONFIG, 0xA, 0);
+	addWrite(&b, GPUREG_GSH_MISC0, 0);
+	addWrite(&b, GPUREG_GSH_MISC1, 0);
+	addWrite(&b, GPUREG_GSH_INPUTBUFFER_CONFIG, 0xA0000000);
+	const u32 attribFormat[2] = {0x7B, 0x1FFC0000};      // 2 float vec4 attributes.
+	addIncrementalWrites(&b, GPUREG_ATTRIBBUFFERS_FORMAT_LOW, attribFormat, 2);
+	addMaskedWrite(&b, GPUREG_VSH_INPUTBUFFER_CONFIG, 0xB, 0xA0000001);
+	addWrite(&b, GPUREG_VSH_NUM_ATTR, 1);
+	const u32 permutation[2] = {0x10, 0};
+	addIncrementalWrites(&b, GPUREG_VSH_ATTR_PERMUTATION_LOW, permutation, 2);
+
+	// No depth test, culling, blending or alpha test.
+	addWrite(&b, GPUREG_DEPTHMAP_ENABLE, 1);
+	addWrite(&b, GPUREG_FACECULLING_CONFIG, 2);
+	const u32 depthMap[2] = {0x00BF0000, 0};
+	addIncrementalWrites(&b, GPUREG_DEPTHMAP_SCALE, depthMap, 2);
+	const u32 fragOp[4] = {0x10, 0x10, 0, 0xF10};
+	addIncrementalWrites(&b, GPUREG_FRAGOP_ALPHA_TEST, fragOp, 4);
+	addMaskedWrite(&b, GPUREG_GAS_DELTAZ_DEPTH, 8, 0);
+	addWrite(&b, GPUREG_BLEND_COLOR, 0);
+	addWrite(&b, GPUREG_BLEND_FUNC, 0x76760000);
+	addWrite(&b, GPUREG_LOGIC_OP, 0);
+	addMaskedWrite(&b, GPUREG_COLOR_OPERATION, 7, 0x00E40100);
+	addWrite(&b, GPUREG_FRAGOP_SHADOW, 0x80003C00);
+	addMaskedWrite(&b, GPUREG_EARLYDEPTH_TEST1, 1, 0);
+	addWrite(&b, GPUREG_EARLYDEPTH_TEST2, 0);
+	addMaskedWrite(&b, GPUREG_EARLYDEPTH_FUNC, 1, 0);
+	addMaskedWrite(&b, GPUREG_EARLYDEPTH_DATA, 7, 0);
+
+	// Texture unit 0. The texture is always 512x512.
+	const u32 texUnit[5] = {0, TEX_SIZE<<16 | TEX_SIZE, (l->linear ? 2u : 0u), 0, l->texAddr>>3}; // Border color, dim, param, LOD, address.
+	addIncrementalWrites(&b, GPUREG_TEXUNIT0_BORDER_COLOR, texUnit, 5);
+	addWrite(&b, GPUREG_TEXUNIT0_TYPE, l->texFormat);
+	addMaskedWrite(&b, GPUREG_TEXUNIT_CONFIG, 0xB, 0x00011001);
+	addMaskedWrite(&b, GPUREG_TEXUNIT_CONFIG, 4, 0x00010000);
+	addWrite(&b, GPUREG_TEXUNIT0_SHADOW, 1);
+
+	// Texture combiners. Only stage 0 is used (texture color) until color correction is set up.
+	g_texEnvBufUpdate = addMaskedWrite(&b, GPUREG_TEXENV_UPDATE_BUFFER, 7, 0);
+	addWrite(&b, GPUREG_TEXENV_BUFFER_COLOR, 0xFFFFFFFF);
+	addWrite(&b, GPUREG_FOG_COLOR, 0);
+	static const u16 texEnvRegs[6] =
 	{
-		u32 tmp = 0x4440;
-		memcpy(&gbaGpuInitList[952], &tmp, 2);
-		gbaGpuInitList[958] = 0x45;
-		gbaGpuInitList[968] = 0x60;
-		memcpy(&gbaGpuInitList[984], &tmp, 2);
-		gbaGpuInitList[989] = 0x40;
-		gbaGpuInitList[1000] = 0x60;
-		tmp = 0x3DE000;
-		memcpy(&gbaGpuInitList[1004], &tmp, 4);
-		gbaGpuInitList[1016] = 0x90;
-		gbaGpuInitList[1022] = 0x45;
-		gbaGpuInitList[1048] = 0x90;
-		gbaGpuInitList[1053] = 0x40;
-		memcpy(&gbaGpuInitList[1068], &tmp, 4);
-
-		tmp = 0x4440;
-		memcpy(&gbaGpuList2[264], &tmp, 2);
-		gbaGpuList2[270] = 0x45;
-		gbaGpuList2[280] = 0x60;
-		memcpy(&gbaGpuList2[296], &tmp, 2);
-		gbaGpuList2[301] = 0x40;
-		gbaGpuList2[312] = 0x60;
-		tmp = 0x3DE000;
-		memcpy(&gbaGpuList2[316], &tmp, 4);
-		gbaGpuList2[328] = 0x90;
-		gbaGpuList2[334] = 0x45;
-		gbaGpuList2[360] = 0x90;
-		gbaGpuList2[365] = 0x40;
-		memcpy(&gbaGpuList2[380], &tmp, 4);
-	}
-	else if(scaleType == 1)
+		GPUREG_TEXENV0_SOURCE, GPUREG_TEXENV1_SOURCE, GPUREG_TEXENV2_SOURCE,
+		GPUREG_TEXENV3_SOURCE, GPUREG_TEXENV4_SOURCE, GPUREG_TEXENV5_SOURCE
+	};
+	for(u32 i = 0; i < 6; i++)
 	{
-		gbaGpuInitList[572] = 2;
-		gbaGpuInitList[968] = 0x60;
-		gbaGpuInitList[1000] = 0x60;
-		u32 tmp = 0x3DE000;
-		memcpy(&gbaGpuInitList[1004], &tmp, 4);
-		memcpy(&gbaGpuInitList[1068], &tmp, 4);
-
-		gbaGpuList2[280] = 0x60;
-		gbaGpuList2[312] = 0x60;
-		memcpy(&gbaGpuList2[316], &tmp, 4);
-		memcpy(&gbaGpuList2[380], &tmp, 4);
+		const u32 stage[5] = {(i == 0 ? 0x00030003u : 0x000F000Fu), 0, 0, 0xFFFFFFFF, 0}; // Source, operand, combiner, color, scale.
+		g_texEnv[i] = addIncrementalWrites(&b, texEnvRegs[i], stage, 5);
 	}
-	// else nothing to do.
+
+	// Constant c95 and the projection in c0-c3. Maps top screen coordinates to the rotated buffer.
+	const u32 c95[4] = {0x5F, 0x3E0000BF, 0x00003F00, 0};
+	addIncrementalWrites(&b, GPUREG_VSH_FLOATUNIFORM_CONFIG, c95, 4);
+	addWrite(&b, GPUREG_VSH_FLOATUNIFORM_CONFIG, 0x80000000); // f32 mode, c0.
+	const float projection[16] =
+	{
+		// w, z, y, x of each row.
+		-1.f, 0.f, 2.f / SCREEN_H, 0.f,
+		 1.f, 0.f, 0.f, -2.f / SCREEN_W,
+		-1.f, 1.f, 0.f, 0.f,
+		 1.f, 0.f, 0.f, 0.f
+	};
+	u32 projectionBits[16];
+	for(u32 i = 0; i < 16; i++) projectionBits[i] = f32Bits(projection[i]);
+	addWrites(&b, GPUREG_VSH_FLOATUNIFORM_DATA, projectionBits, 16);
+	addWrite(&b, GPUREG_VSH_BOOLUNIFORM, 0x7FFF0000);
+
+	// Triangle strip without index buffer.
+	addMaskedWrite(&b, GPUREG_PRIMITIVE_CONFIG, 2, 0x100);
+	addWrite(&b, GPUREG_RESTART_PRIMITIVE, 1);
+	addWrite(&b, GPUREG_INDEXBUFFER_CONFIG, 0x80000000);
+	addDraw(&b, l);
+	gbaGpuInitListSize = finishList(&b);
+}
+
+// Everything else stays set from the init list.
+static void buildList2(const GbaGpuLayout *const l)
+{
+	GpuCmdBuf b = {gbaGpuList2, gbaGpuList2};
+	addColorBuffer(&b, 1);
+	addWrite(&b, GPUREG_RESTART_PRIMITIVE, 1);
+	addDraw(&b, l);
+	gbaGpuList2Size = finishList(&b);
+}
+
+void buildGbaGpuCmdLists(const GbaGpuLayout *const layout)
+{
+	buildInitList(layout);
+	buildList2(layout);
 
 	flushDCacheRange(gbaGpuInitList, sizeof(gbaGpuInitList));
 	flushDCacheRange(gbaGpuList2, sizeof(gbaGpuList2));
-}
\ No newline at end of file
+}
+
+void patchGbaGpuCmdListRenderBuf(const u32 addr)
+{
+	// Color buffer location in both lists.
+	*g_colorBufLoc[0] = addr>>3;
+	*g_colorBufLoc[1] = addr>>3;
+
+	cleanDCacheRange(g_colorBufLoc[0], 4);
+	cleanDCacheRange(g_colorBufLoc[1], 4);
+}
+
+// TEV stage i registers: source, operand, combiner, constant color, scale.
+static void setTexEnv(const u32 stage, const u32 source, const u32 operand, const u32 combiner, const u32 color)
+{
+	u32 *const stageData = g_texEnv[stage];
+	stageData[0] = source;
+	stageData[2] = operand; // Skip the cmd header.
+	stageData[3] = combiner;
+	stageData[4] = color;
+	stageData[5] = 0;
+}
+
+void patchGbaGpuCmdListColor(const u8 exponent, const u32 matrix[5])
+{
+	// The combiner buffer is written by the stages selected in GPUREG_TEXENV_UPDATE_BUFFER
+	// and can be read 2 stages later. Alpha is passed through from the texture.
+	// Stage 0: prev = tex * tex.
+	setTexEnv(0, 0x00030033, 0, 1, 0);
+
+	u32 stage = 1;
+	u32 bufferUpdate = 1u<<8; // Stage 0.
+	if(exponent == 3)
+	{
+		// Stage 1: prev = prev * tex.
+		setTexEnv(stage++, 0x000F003F, 0, 1, 0);
+		bufferUpdate = 1u<<9; // Stage 1.
+	}
+
+	// prev.rrr * red input is the first use so it can't come from the buffer yet.
+	setTexEnv(stage++, 0x000F00EF, 0x4, 1, matrix[0]); // prev = prev.rrr * const.
+	setTexEnv(stage++, 0x000F0FED, 0x8, 8, matrix[1]); // prev = buf.ggg * const + prev.
+	setTexEnv(stage++, 0x000F0FED, 0xC, 8, matrix[2]); // prev = buf.bbb * const + prev.
+	setTexEnv(stage++, 0x000F0FED, 0xD, 8, matrix[3]); // prev = (1 - buf.bbb) * const + prev.
+	if(stage < 6)
+		setTexEnv(stage, 0x000F0FED, 0x9, 8, matrix[4]); // prev = (1 - buf.ggg) * const + prev.
+
+	*g_texEnvBufUpdate = bufferUpdate;
+
+	flushDCacheRange(gbaGpuInitList, sizeof(gbaGpuInitList));
+}
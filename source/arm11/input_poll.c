@@ -0,0 +1,148 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+#include "arm11/input_poll.h"
+#include "arm11/config.h"
+#include "arm11/frame_pacing.h"
+#include "arm11/cycle_counter.h"
+#include "arm11/drivers/hid.h"
+#include "arm11/drivers/lgy11.h"
+#include "arm11/drivers/timer.h"
+#include "arm11/drivers/interrupt.h"
+#include "mem_map.h"
+#include "kernel.h"
+#include "kevent.h"
+
+
+#define REG_HID_PAD      (*((const vu16*)0x10146000)) // Active low.
+#define HID_PAD_MASK     (0xFFFu)                     // A-Y. The other keys come from hidScanInput().
+#define MAX_INPUT_POLLS  (8u)
+
+// The MPCore watchdog in timer mode. The private timer belongs to the libn3ds TIMER driver (TIMER_sleep*()).
+#define WDT_REGS_BASE    (MPCORE_PRIV_BASE + 0x620)
+#define REG_WDT_LOAD     (*((vu32*)(WDT_REGS_BASE + 0x00)))
+#define REG_WDT_CNT      (*((vu32*)(WDT_REGS_BASE + 0x08)))
+#define REG_WDT_INT_STAT (*((vu32*)(WDT_REGS_BASE + 0x0C)))
+#define WDT_EN           (1u)
+#define WDT_AUTO_RELOAD  (1u<<1)
+#define WDT_IRQ_EN       (1u<<2)                      // Bit 3 (watchdog mode) stays clear.
+
+
+static u16 g_mapTable[4][256]; // 3DS keys to GBA buttons, one table per byte of the key mask.
+static KHandle g_pollEvent = 0;
+static volatile u32 g_extraHeld = 0;   // Non-HID_PAD keys from the last hidScanInput().
+static volatile u32 g_lastPushTime = 0;
+
+
+
+static inline u16 remapButtons(const u32 kHeld)
+{
+	return g_mapTable[0][kHeld & 0xFFu] | g_mapTable[1][kHeld>>8 & 0xFFu] |
+	       g_mapTable[2][kHeld>>16 & 0xFFu] | g_mapTable[3][kHeld>>24];
+}
+
+static void pushInput(const u32 kHeld)
+{
+	LGY11_setInputState(remapButtons(kHeld));
+	g_lastPushTime = cycleCounterRead();
+}
+
+static void pollTimerHandler(UNUSED const u32 intSource)
+{
+	REG_WDT_INT_STAT = 1;
+	signalEvent(g_pollEvent, false);
+}
+
+static void inputPollTask(UNUSED void *args)
+{
+	const KHandle event = g_pollEvent;
+	while(1)
+	{
+		if(waitForEvent(event) != KRES_OK) break;
+		clearEvent(event);
+
+		// Read the buttons directly. hidScanInput() here would eat the
+		// newly pressed state the button combos in the main loop rely on.
+		pushInput((~REG_HID_PAD & HID_PAD_MASK) | g_extraHeld);
+	}
+
+	taskExit();
+}
+
+u16 inputPollInit(void)
+{
+	// Each GBA button is pressed if any of the keys mapped to it are held.
+	const u32 *const maps = g_oafConfig.buttonMaps;
+	u16 overrides = 0;
+	for(u32 i = 0; i < 10; i++)
+		if(maps[i] != 0) overrides |= 1u<<i;
+
+	for(u32 byte = 0; byte < 4; byte++)
+	{
+		for(u32 val = 0; val < 256; val++)
+		{
+			const u32 keys = val<<(byte * 8);
+			u16 pressed = 0;
+			for(u32 i = 0; i < 10; i++)
+				if((keys & maps[i]) != 0) pressed |= 1u<<i;
+			g_mapTable[byte][val] = pressed;
+		}
+	}
+
+	// Poll the buttons evenly spread over the frame.
+	u32 polls = g_oafConfig.inputPolls;
+	polls = (polls > MAX_INPUT_POLLS ? MAX_INPUT_POLLS : polls);
+	if(polls > 1)
+	{
+		g_pollEvent = createEvent(false);
+		createTask(0x800, 3, inputPollTask, NULL);
+		// Same clock as the private timer with prescaler 1.
+		REG_WDT_CNT      = 0;
+		REG_WDT_INT_STAT = 1;
+		IRQ_registerIsr(IRQ_WATCHDOG, 13, 0, pollTimerHandler);
+		REG_WDT_LOAD     = (u32)(TIMER_BASE_FREQ / (GBA_FPS * polls));
+		REG_WDT_CNT      = WDT_IRQ_EN | WDT_AUTO_RELOAD | WDT_EN;
+	}
+
+	return overrides;
+}
+
+void inputPollUpdate(const u32 kHeld)
+{
+	// The poll task keeps using the other keys until the next frame.
+	g_extraHeld = kHeld & ~HID_PAD_MASK;
+	pushInput(kHeld);
+}
+
+u32 inputPollLastTime(void)
+{
+	return g_lastPushTime;
+}
+
+void inputPollExit(void)
+{
+	if(g_pollEvent == 0) return;
+
+	// inputPollTask() terminates once its event is deleted.
+	REG_WDT_CNT      = 0;
+	REG_WDT_INT_STAT = 1;
+	IRQ_unregisterIsr(IRQ_WATCHDOG);
+	deleteEvent(g_pollEvent);
+	g_pollEvent = 0;
+}
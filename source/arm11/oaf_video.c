@@ -25,7 +25,6 @@
 #include "util.h"
 #include "oaf_error_codes.h"
 #include "arm11/drivers/lgycap.h"
-#include "arm11/bitmap.h"
 #include "drivers/gfx.h"
 #include "arm11/drivers/mcu.h"
 #include "arm11/fmt.h"
@@ -35,14 +34,34 @@
 #include "arm11/drivers/hid.h"
 #include "arm11/drivers/interrupt.h"
 #include "arm11/gpu_cmd_lists.h"
-#include "system.h"
 #include "arm11/fast_frame_convert.h"
-
-
-#define COLOR_LUT_ADDR (0x1FF00000u)
+#include "arm11/color_lut.h"
+#include "arm11/frame_stats.h"
+#include "arm11/boot_timeline.h"
+#include "arm11/screenshot.h"
+#include "arm11/recorder.h"
+#include "arm11/input_poll.h"
+#include "arm11/frame_pacing.h"
+#include "arm11/core1_jobs.h"
+#include "arm11/border.h"
+#include "mem_map.h"
+#include "arm.h"
 
 
 static KHandle g_convFinishedEvent = 0;
+static bool g_initListSent = false;
+static KHandle g_presentEvent = 0;
+static KHandle g_presentIdleEvent = 0;
+static FrameTimes g_presentTimes;     // Handed from gbaGfxHandler() to gbaPresentTask().
+static volatile u32 g_convFinishedTime = 0;
+static bool g_renderPaused = false;
+
+// Written by core 0 and read by core 1.
+typedef struct
+{
+	alignas(32) volatile bool paused;
+} RenderPause;
+static RenderPause g_core1Pause;
 static const u32 g_topLcdCurveCorrect[73] =
 {
 	// Curve correction from 3DS top LCD gamma to 2.2 gamma for all channels.
@@ -72,7 +91,7 @@ static const u32 g_topLcdCurveCorrect[73] =
 
 
 // TODO: Reimplement contrast and brightness in color lut below.
-static void adjustGammaTableForGba(void)
+static void adjustGammaTableForGba(const ColorLutGpu *const gpuColor)
 {
 	// Credits for this algo go to Extrems.
 	/*const float targetGamma = g_oafConfig.gbaGamma;
@@ -96,242 +115,53 @@ static void adjustGammaTableForGba(void)
 	// Very simple gamma table expansion code.
 	// Code + hardcoded tables are way smaller than hardcoding the uncompressed tables.
 	const u32 *encTable = g_topLcdCurveCorrect;
-	vu32 *const color_lut_data = &getGxRegs()->pdc0.color_lut_data;
+	u32 lcdCurve[256];
 	u32 decoded = 0;
 	do
 	{
 		// Get table entry and extract the number of linearly increasing entries.
 		u32 entry = *encTable++;
 		u32 steps = (entry>>24) + 1;
-
-		// Keep track of how many table entries we generated.
-		decoded += steps;
 		do
 		{
-			// Set gamma table entry and increment.
 			// Note: Bits 24-31 don't matter so we don't need to mask.
-			*color_lut_data = entry;
+			lcdCurve[decoded++] = entry;
 			entry += 0x010101;
 		} while(--steps != 0);
 	} while(decoded < 256);
-}
 
-typedef struct
-{
-	float targetGamma;
-	float lum;
-	float  r, gr, br;
-	float rg,  g, bg;
-	float rb, gb,  b;
-	float displayGamma;
-} ColorProfile;
-
-// libretro shader values. Credits: hunterk and Pokefan531.
-// Last updated 2024-12-03.
-static const ColorProfile g_colorProfiles[8] =
-{
-	{ // libretro GBA color (sRGB).
-		2.2f + (0.3f * 1.6f), // Darken screen. Default 0. Modified to 0.3.
-		0.91f,
-		0.905f,  0.195f,  -0.1f,
-		0.1f,    0.65f,    0.25f,
-		0.1575f, 0.1425f,  0.7f,
-		1.f / 2.2f
-	},
-	{ // libretro GB micro color (sRGB).
-		2.2f,
-		0.9f,
-		0.8025f, 0.31f,   -0.1125f,
-		0.1f,    0.6875f,  0.2125f,
-		0.1225f, 0.1125f,  0.765f,
-		1.f / 2.2f
-	},
-	{ // libretro GBA SP (AGS-101) color (sRGB).
-		2.2f,
-		0.935f,
-		0.96f,    0.11f, -0.07f,
-		0.0325f,  0.89f,  0.0775f,
-		0.001f,  -0.03f,  1.029f,
-		1.f / 2.2f
-	},
-	{ // libretro NDS color (sRGB).
-		2.2f,
-		0.905f,
-		0.835f, 0.27f,   -0.105f,
-		0.1f,   0.6375f,  0.2625f,
-		0.105f, 0.175f,   0.72f,
-		1.f / 2.2f
-	},
-	{ // libretro NDS lite color (sRGB).
-		2.2f,
-		0.935f,
-		0.93f,   0.14f, -0.07f,
-		0.025f,  0.9f,   0.075f,
-		0.008f, -0.03f,  1.022f,
-		1.f / 2.2f
-	},
-	{ // libretro Nintendo Switch Online color (sRGB).
-		2.2f + 0.8f, // Darken screen. Default 0.8.
-		1.f,
-		0.865f,  0.1225f, 0.0125f,
-		0.0575f, 0.925f,  0.0125f,
-		0.0575f, 0.1225f, 0.82f,
-		1.f / 2.2f
-	},
-	{ // libretro Visual Boy Advance/No$GBA full color.
-		1.45f + 1.f, // Darken screen. Default 1.
-		1.f,
-		0.73f,   0.27f,   0.f,
-		0.0825f, 0.6775f, 0.24f,
-		0.0825f, 0.24f,   0.6775f,
-		1.f / 1.45f
-	},
-	{ // Identity.
-		2.2f,
-		1.f,
-		1.f, 0.f, 0.f,
-		0.f, 1.f, 0.f,
-		0.f, 0.f, 1.f,
-		1.f / 2.2f
+	// Set gamma table entries. GPU color correction goes through its
+	// own table first. The index wraps around after 256 entries.
+	vu32 *const color_lut_data = &getGxRegs()->pdc0.color_lut_data;
+	for(u32 i = 0; i < 256; i++)
+	{
+		if(gpuColor != NULL)
+		{
+			*color_lut_data = (lcdCurve[gpuColor->gamma[0][i]] & 0xFFu) |
+			                  (lcdCurve[gpuColor->gamma[1][i]] & 0xFF00u) |
+			                  (lcdCurve[gpuColor->gamma[2][i]] & 0xFF0000u);
+		}
+		else *color_lut_data = lcdCurve[i];
 	}
-};
-
-ALWAYS_INLINE float clamp_float(const float x, const float min, const float max)
-{
-	return (x < min ? min : (x > max ? max : x));
 }
 
-void makeColorLut(const ColorProfile *const p)
+// Returns true if the texture no longer has the current frame.
+static bool dumpFrameTex(void)
 {
-	const float targetGamma    = p->targetGamma;
-	const float contrast       = g_oafConfig.contrast;
-	const float brightness     = g_oafConfig.brightness / contrast;
-	const float targetContrast = powf(contrast, targetGamma);
-
-	// Calculate saturation weights.
-	// Note: We are using the Rec. 709 luminance vector here.
-	const float sat   = g_oafConfig.saturation;
-	const float rwgt  = (1.f - sat) * 0.2126f;
-	const float gwgt  = (1.f - sat) * 0.7152f;
-	const float bwgt  = (1.f - sat) * 0.0722f;
-
-	u32 *const colorLut = (u32*)COLOR_LUT_ADDR;
-	for(u32 i = 0; i < 32768; i++)
+	// Without the matrix scaler the capture texture has the frame in native resolution.
+	// Copy it out right away. Keeping LgyCap running avoids dropped frames.
+	if(g_oafConfig.scaler < 2)
 	{
-		// Convert to 8-bit and normalize.
-		float b = (float)rgbFive2Eight(i & 31u) / 255;
-		float g = (float)rgbFive2Eight((i>>5) & 31u) / 255;
-		float r = (float)rgbFive2Eight(i>>10) / 255;
-
-		// Convert to linear gamma.
-		b = powf(b + brightness, targetGamma);
-		g = powf(g + brightness, targetGamma);
-		r = powf(r + brightness, targetGamma);
-
-		// Apply luminance.
-		const float lum = p->lum;
-		b = clamp_float(b * lum, 0.f, 1.f);
-		g = clamp_float(g * lum, 0.f, 1.f);
-		r = clamp_float(r * lum, 0.f, 1.f);
-
-		/*
-		 *               Input
-		 *                [r]
-		 *                [g]
-		 *                [b]
-		 *
-		 * Correction    Output
-		 * [ r][gr][br]   [r]
-		 * [rg][ g][bg]   [g]
-		 * [rb][gb][ b]   [b]
-		*/
-		// Assuming no alpha channel in original calculation.
-		float tmpB = p->rb * r + p->gb * g + p->b  * b;
-		float tmpG = p->rg * r + p->g  * g + p->bg * b;
-		float tmpR = p->r  * r + p->gr * g + p->br * b;
-
-		// Apply saturation.
-		// Note: Some duplicated muls here. gcc optimizes them out.
-		b = rwgt         * tmpR + gwgt         * tmpG + (bwgt + sat) * tmpB;
-		g = rwgt         * tmpR + (gwgt + sat) * tmpG + bwgt         * tmpB;
-		r = (rwgt + sat) * tmpR + gwgt         * tmpG + bwgt         * tmpB;
-
-		b = (b < 0.f ? 0.f : b);
-		g = (g < 0.f ? 0.f : g);
-		r = (r < 0.f ? 0.f : r);
-
-		// Convert to display gamma.
-		const float displayGamma = p->displayGamma;
-		b = powf(targetContrast * b, displayGamma);
-		g = powf(targetContrast * g, displayGamma);
-		r = powf(targetContrast * r, displayGamma);
-
-		// Denormalize, clamp, convert to ABGR8 and write lut.
-		u32 entry = 255; // Alpha.
-		entry |= clamp_s32(lroundf(b * 255), 0, 255)<<8;
-		entry |= clamp_s32(lroundf(g * 255), 0, 255)<<16;
-		entry |= clamp_s32(lroundf(r * 255), 0, 255)<<24;
-		colorLut[i] = entry;
+		screenshotQueue((u32*)GPU_TEXTURE_ADDR, 240, 160, 0);
+		return false;
 	}
 
-	flushDCacheRange(colorLut, 4 * 32768);
-}
-
-static Result dumpFrameTex(void)
-{
 	// Capture a single frame in native resolution.
 	// Note: This adds 1 frame of delay after pressing the screenshot buttons.
-	if(LGYCAP_captureFrameUnscaled(LGYCAP_DEV_TOP) != KRES_OK)
-		return RES_INVALID_ARG;
-
-	// A1BGR5 format (alpha ignored).
-	constexpr u32 alignment = 0x80; // Make PPF happy.
-	alignas(4) static const BmpV1WithMasks bmpHeaders =
-	{
-		{
-			.magic       = 0x4D42,
-			.fileSize    = alignment + 240 * 160 * 2,
-			.reserved    = 0,
-			.reserved2   = 0,
-			.pixelOffset = alignment
-		},
-		{
-			.headerSize      = sizeof(Bitmapinfoheader),
-			.width           = 240,
-			.height          = -160,
-			.colorPlanes     = 1,
-			.bitsPerPixel    = 16,
-			.compression     = BI_BITFIELDS,
-			.imageSize       = 240 * 160 * 2,
-			.xPixelsPerMeter = 0,
-			.yPixelsPerMeter = 0,
-			.colorsUsed      = 0,
-			.colorsImportant = 0
-		},
-		.rMask = 0xF800,
-		.gMask = 0x07C0,
-		.bMask = 0x003E
-	};
+	if(LGYCAP_captureFrameUnscaled(LGYCAP_DEV_TOP) != KRES_OK) return false;
 
-	// Transfer frame data out of the 512x512 texture.
-	// We will use the currently hidden frame buffer as temporary buffer.
-	// Note: This is a race with the currently displaying frame buffer
-	//       because we just swapped buffers in the gfx handler function.
-	u32 *const tmpBuf = GFX_getBuffer(GFX_LCD_TOP, GFX_SIDE_LEFT);
-	GX_displayTransfer((u32*)GPU_TEXTURE_ADDR, PPF_DIM(512, 160), tmpBuf + (alignment / 4), PPF_DIM(240, 160),
-	                   PPF_O_FMT(GX_A1BGR5) | PPF_I_FMT(GX_A1BGR5) | PPF_CROP_EN);
-	memcpy(tmpBuf, &bmpHeaders, sizeof(bmpHeaders));
-	GFX_waitForPPF();
-
-	// Get current date & time.
-	RtcTimeDate td;
-	MCU_getRtcTimeDate(&td);
-
-	// Construct file path from date & time. Then write the file.
-	char fn[36];
-	ee_sprintf(fn, OAF_SCREENSHOT_DIR "/%04X_%02X_%02X_%02X_%02X_%02X.bmp",
-	           td.year + 0x2000, td.mon, td.day, td.hour, td.min, td.sec);
-	const Result res = fsQuickWrite(fn, tmpBuf, bmpHeaders.header.fileSize);
+	// Encoding and writing the file is done by the screenshot task.
+	screenshotQueue((u32*)GPU_TEXTURE_ADDR, 240, 160, 0);
 
 	// Clear overwritten texture area in case we overwrote padding (different resolution).
 	// This is important because padding pixels must be fully transparent to get sharp edges when the GPU renders.
@@ -341,22 +171,95 @@ static Result dumpFrameTex(void)
 	// Restart LgyCap.
 	LGYCAP_start(LGYCAP_DEV_TOP);
 
-	return res;
+	return true;
 }
 
 static void convFinishedHandler(UNUSED const u32 intSource)
 {
+	g_convFinishedTime = frameStatsNow();
 	signalEvent(g_convFinishedEvent, false);
 }
 
+// Waits for transfers started by gbaGfxHandler() and swaps buffers.
+// Runs separately so the next frame can be rendered in the meantime.
+static void gbaPresentTask(UNUSED void *args)
+{
+	const KHandle presentEvent = g_presentEvent;
+	const KHandle idleEvent    = g_presentIdleEvent;
+	const bool is240x160 = g_oafConfig.scaler < 2;
+	const u16 frameW = (is240x160 ? 240 : 360);
+	const u16 frameH = (is240x160 ? 160 : 240);
+	u8 burstSeq = 0;
+	while(1)
+	{
+		if(waitForEvent(presentEvent) != KRES_OK) break;
+		clearEvent(presentEvent);
+		FrameTimes times = g_presentTimes;
+
+		GFX_waitForPPF();
+		times.t[FRAME_MARK_PPF] = frameStatsNow();
+		GFX_swapBuffers();
+		times.t[FRAME_MARK_SWAP] = frameStatsNow();
+
+		// Trigger only if both are held and at least one is detected as newly pressed down.
+		const u32 kHeld = hidKeysHeld();
+		bool texReplaced = false;
+		if(kHeld == (KEY_Y | KEY_SELECT) && hidKeysDown() != 0)
+			texReplaced = dumpFrameTex();
+		else if(kHeld == (KEY_X | KEY_SELECT) && hidKeysDown() != 0 && burstSeq == 0)
+			burstSeq = (g_oafConfig.screenshotBurst > 0 ? 1 : 0);
+		else if(kHeld == (KEY_X | KEY_START) && hidKeysDown() != 0)
+		{
+			if(!recorderIsActive()) recorderStart(frameW, frameH);
+			else                    recorderStop();
+		}
+		else if(kHeld == (KEY_Y | KEY_START) && hidKeysDown() != 0)
+			frameStatsDump();
+
+		// Burst and recorded frames are copied from the capture texture as is (scaled with the matrix scaler).
+		// Frames are dropped while all slots are waiting to be written.
+		if(!texReplaced)
+		{
+			if(burstSeq != 0)
+			{
+				screenshotQueue((u32*)GPU_TEXTURE_ADDR, frameW, frameH, burstSeq);
+				burstSeq = (burstSeq < g_oafConfig.screenshotBurst ? burstSeq + 1 : 0);
+			}
+			recorderAddFrame((u32*)GPU_TEXTURE_ADDR);
+		}
+		times.t[FRAME_MARK_CAPTURE] = frameStatsNow();
+		frameStatsAdd(&times);
+
+		signalEvent(idleEvent, false);
+	}
+
+	taskExit();
+}
+
 static void gbaGfxHandler(void *args)
 {
 	const KHandle event = (KHandle)args;
-
+	g_presentEvent     = createEvent(false);
+	g_presentIdleEvent = createEvent(false);
+	signalEvent(g_presentIdleEvent, false);
+	createTask(0x800, 3, gbaPresentTask, NULL);
+
+	// P3D renders into one buffer while PPF may still be reading the other.
+	static const u32 renderBufs[2] = {GPU_RENDER_BUF_ADDR, GPU_RENDER_BUF2_ADDR};
+	u32 renderBuf = 0;
+	const bool core1Conv = (event == g_convFinishedEvent); // Conversion IPI is the frame start.
 	while(1)
 	{
 		if(waitForEvent(event) != KRES_OK) break;
 		clearEvent(event);
+		FrameTimes times;
+		times.t[FRAME_MARK_WAKE]  = frameStatsNow();
+		times.t[FRAME_MARK_START] = (core1Conv ? g_convFinishedTime : times.t[FRAME_MARK_WAKE]);
+		times.t[FRAME_MARK_INPUT] = inputPollLastTime();
+		times.phaseErrUs = framePacingUpdate();
+
+		// Nothing is visible. The frame is just dropped.
+		if(g_renderPaused) continue;
 
 		// All measurements are the worst timings in ~30 seconds of runtime.
 		// Measured with timer prescaler 1.
@@ -369,33 +272,44 @@ static void gbaGfxHandler(void *args)
 		// 240x160 no scaling:    ~188 µs (25300 ticks)
 		// 240x160 bilinear x1.5: ~407 µs (54619 ticks)
 		// 360x240 no scaling:    ~400 µs (53725 ticks)
-		static bool inited = false;
 		u32 listSize;
 		const u32 *list;
-		if(inited == false)
+		patchGbaGpuCmdListRenderBuf(renderBufs[renderBuf]);
+		if(g_initListSent == false)
 		{
-			inited = true;
+			g_initListSent = true;
 
-			listSize = sizeof(gbaGpuInitList);
-			list = (u32*)gbaGpuInitList;
+			listSize = gbaGpuInitListSize;
+			list = gbaGpuInitList;
 		}
 		else
 		{
-			listSize = sizeof(gbaGpuList2);
-			list = (u32*)gbaGpuList2;
+			listSize = gbaGpuList2Size;
+			list = gbaGpuList2;
 		}
 		GX_processCommandList(listSize, list);
 		GFX_waitForP3D();
-		GX_displayTransfer((u32*)GPU_RENDER_BUF_ADDR, PPF_DIM(240, 400), GFX_getBuffer(GFX_LCD_TOP, GFX_SIDE_LEFT),
-		                   PPF_DIM(240, 400), PPF_O_FMT(GX_BGR8) | PPF_I_FMT(GX_BGR8));
-		GFX_waitForPPF();
-		GFX_swapBuffers();
+		times.t[FRAME_MARK_P3D] = frameStatsNow();
 
-		// Trigger only if both are held and at least one is detected as newly pressed down.
-		if(hidKeysHeld() == (KEY_Y | KEY_SELECT) && hidKeysDown() != 0)
-			dumpFrameTex();
+		// The last frame must be on screen before we transfer into the hidden buffer.
+		if(waitForEvent(g_presentIdleEvent) != KRES_OK) break;
+		clearEvent(g_presentIdleEvent);
+		times.t[FRAME_MARK_TRANSFER] = frameStatsNow();
+		GX_displayTransfer((u32*)renderBufs[renderBuf], PPF_DIM(240, 400), GFX_getBuffer(GFX_LCD_TOP, GFX_SIDE_LEFT),
+		                   PPF_DIM(240, 400), PPF_O_FMT(GX_BGR8) | PPF_I_FMT(GX_BGR8));
+		g_presentTimes = times;
+		signalEvent(g_presentEvent, false);
+		renderBuf ^= 1;
 	}
 
+	// gbaPresentTask() terminates once its event is deleted.
+	// Let it finish the last frame first.
+	waitForEvent(g_presentIdleEvent);
+	deleteEvent(g_presentEvent);
+	deleteEvent(g_presentIdleEvent);
+	g_presentEvent     = 0;
+	g_presentIdleEvent = 0;
+
 	taskExit();
 }
 
@@ -442,6 +356,37 @@ static KHandle setupFrameCapture(const u8 scaler, const bool colorCorrectionEnab
 	return LGYCAP_init(LGYCAP_DEV_TOP, &gbaCfg);
 }
 
+static void setupGpuCmdLists(const u8 scaler, const bool useSecondTexture)
+{
+	// Scaler 0 is centered 1:1, scaler 1 is bilinear x1.5 on the GPU
+	// and scaler 2 is already 360x240 from the capture hardware.
+	const bool is240x160 = scaler < 2;
+	const bool fullWidth = scaler > 0;
+	GbaGpuLayout layout;
+	layout.texAddr   = (useSecondTexture ? GPU_TEXTURE2_ADDR : GPU_TEXTURE_ADDR);
+	layout.texFormat = (useSecondTexture ? GPU_TEX_RGBA8 : GPU_TEX_RGB5A1);
+	layout.linear    = scaler == 1;
+	layout.srcW      = (is240x160 ? 240 : 360);
+	layout.srcH      = (is240x160 ? 160 : 240);
+	layout.dstX      = (fullWidth ? 20 : 80);
+	layout.dstY      = (fullWidth ? 0 : 40);
+	layout.dstW      = (fullWidth ? 360 : 240);
+	layout.dstH      = (fullWidth ? 240 : 160);
+
+	buildGbaGpuCmdLists(&layout);
+}
+
+void OAF_videoUpdateGpuColor(void)
+{
+	static ColorLutGpu gpuColor;
+	colorLutGetGpu(&gpuColor);
+	patchGbaGpuCmdListColor(gpuColor.exponent, gpuColor.matrix);
+
+	// The combiner setup is part of the init list.
+	g_initListSent = false;
+	adjustGammaTableForGba(&gpuColor);
+}
+
 KHandle OAF_videoInit(void)
 {
 #ifdef NDEBUG
@@ -455,62 +400,119 @@ KHandle OAF_videoInit(void)
 	// Initialize frame capture.
 	const u8 scaler = g_oafConfig.scaler;
 	const u8 colorProfile = g_oafConfig.colorProfile;
+	const bool gpuColor = colorProfile > 0 && g_oafConfig.gpuColorCorrection;
 	KHandle frameReadyEvent;
 	KHandle convFinishedEvent;
-	if(colorProfile > 0)
+	if(colorProfile > 0 && !gpuColor)
 	{
 		// Start capture hardware and create event handles.
 		frameReadyEvent = setupFrameCapture(scaler, true);
 		convFinishedEvent = createEvent(false);
 		g_convFinishedEvent = convFinishedEvent;
 
-		// Patch GPU cmd list with texture location 2.
-		patchGbaGpuCmdList(scaler, true);
+		// Build the GPU cmd lists with texture location 2.
+		setupGpuCmdLists(scaler, true);
 
-		// Compute the (linear) 3D lookup table.
-		makeColorLut(&g_colorProfiles[colorProfile - 1]);
+		// Load or compute the (linear) 3D lookup table.
+		colorLutInit();
+		bootTimelineMark("color lut");
 
-		// Register IPI handler and start core 1 for color conversion.
+		// Register IPI handler and hand core 1 over to color conversion.
 		IRQ_registerIsr(IRQ_IPI15, 13, 0, convFinishedHandler);
-		__systemBootCore1((scaler < 2 ? convert160pFrameFast : convert240pFrameFast));
+		core1JobsHandover((scaler < 2 ? convert160pFrameFast : convert240pFrameFast));
 	}
 	else
 	{
 		// Start capture hardware.
 		frameReadyEvent = setupFrameCapture(scaler, false);
 
-		// Patch GPU cmd list with texture location 1.
-		patchGbaGpuCmdList(scaler, false);
+		// Build the GPU cmd lists with texture location 1.
+		// With GPU color correction core 1 stays off.
+		setupGpuCmdLists(scaler, false);
 	}
 
 	// Start frame handler.
-	createTask(0x800, 3, gbaGfxHandler, (void*)(colorProfile > 0 ? convFinishedEvent : frameReadyEvent));
+	frameStatsInit(scaler);
+	framePacingInit();
+	screenshotInit();
+	createTask(0x800, 3, gbaGfxHandler, (void*)(colorProfile > 0 && !gpuColor ? convFinishedEvent : frameReadyEvent));
 
 	// Adjust hardware gamma table.
-	adjustGammaTableForGba();
+	if(gpuColor) OAF_videoUpdateGpuColor();
+	else         adjustGammaTableForGba(NULL);
+
+	// The GPU only draws the frame. Both render buffers need the same background.
+	GX_memoryFill((u32*)GPU_RENDER_BUF_ADDR, PSC_FILL_32_BITS, 240 * 400 * 3, 0,
+	              (u32*)GPU_RENDER_BUF2_ADDR, PSC_FILL_32_BITS, 240 * 400 * 3, 0);
+	GFX_waitForPSC0();
+	GFX_waitForPSC1();
 
 	// Load border if any exists.
 	if(scaler == 0) // No borders for scaled modes.
 	{
 		// Abuse currently invisible frame buffer as temporary buffer.
 		void *const borderBuf = GFX_getBuffer(GFX_LCD_TOP, GFX_SIDE_LEFT);
-		if(fsQuickRead("border.bgr", borderBuf, 400 * 240 * 3) == RES_OK)
+		const Result res = borderLoad(borderBuf);
+		if(res == RES_OK)
 		{
-			// Copy border in swizzled form to GPU render buffer.
+			// Copy border in swizzled form to both GPU render buffers.
 			GX_displayTransfer(borderBuf, PPF_DIM(240, 400), (u32*)GPU_RENDER_BUF_ADDR,
 			                   PPF_DIM(240, 400), PPF_O_FMT(GX_BGR8) | PPF_I_FMT(GX_BGR8) | PPF_OUT_TILED);
 			GFX_waitForPPF();
+			GX_displayTransfer(borderBuf, PPF_DIM(240, 400), (u32*)GPU_RENDER_BUF2_ADDR,
+			                   PPF_DIM(240, 400), PPF_O_FMT(GX_BGR8) | PPF_I_FMT(GX_BGR8) | PPF_OUT_TILED);
+			GFX_waitForPPF();
 		}
+		else if(res != RES_FR_NO_FILE) ee_printf("Failed to load border: %s\n", oafResult2String(res));
+		bootTimelineMark("border");
 	}
 
 	return frameReadyEvent;
 }
 
+void OAF_videoPauseRender(const bool pause)
+{
+	if(pause == g_renderPaused) return;
+	g_renderPaused = pause;
+	if(!pause) frameStatsResume();
+
+	// Core 1 finishes the current frame first.
+	g_core1Pause.paused = pause;
+	cleanDCacheRange(&g_core1Pause, sizeof(g_core1Pause));
+}
+
+void OAF_videoCore1Pause(void)
+{
+	invalidateDCacheRange(&g_core1Pause, sizeof(g_core1Pause));
+	if(!g_core1Pause.paused) return;
+
+	// Same IRQ handling as the converters. IRQs are disabled on core 1.
+	vu32 *const lgyCapStat = (vu32*)0x10111008;         // REG_LGYCAP1_STAT.
+	vu32 *const gicc = (vu32*)(MPCORE_PRIV_BASE + 0x100);
+	while(1)
+	{
+		__wfi();
+		const u32 stat = *lgyCapStat;
+		const u32 intId = gicc[0x0C / 4];                // REG_GICC_INTACK.
+		*lgyCapStat = stat;
+		gicc[0x10 / 4] = intId;                          // REG_GICC_EOI.
+
+		// The converters ignore the DREQ for line 0. Returning
+		// right after it leaves them waiting for the first lines of a frame.
+		if((stat>>16) != 0) continue;
+		invalidateDCacheRange(&g_core1Pause, sizeof(g_core1Pause));
+		if(!g_core1Pause.paused) break;
+	}
+}
+
 void OAF_videoExit(void)
 {
 	// frameReadyEvent deleted by this function.
 	// gbaGfxHandler() will automatically terminate.
 	LGYCAP_deinit(LGYCAP_DEV_TOP);
+	recorderExit();
+	screenshotExit();
+	framePacingExit();
 	if(g_convFinishedEvent != 0)
 	{
 		deleteEvent(g_convFinishedEvent);
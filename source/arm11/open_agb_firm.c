@@ -20,7 +20,6 @@
 #include <string.h>
 #include "types.h"
 #include "util.h"
-#include "arm11/fast_rom_padding.h"
 #include "oaf_error_codes.h"
 #include "fs.h"
 #include "arm11/fmt.h"
@@ -31,70 +30,179 @@
 #include "arm11/filebrowser.h"
 #include "arm11/config.h"
 #include "arm11/save_type.h"
+#include "arm11/rom_cache.h"
+#include "arm11/rom_padding.h"
 #include "arm11/patch.h"
 #include "arm11/drivers/codec.h"
 #include "drivers/lgy_common.h"
 #include "arm11/oaf_video.h"
+#include "arm11/boot_timeline.h"
+#include "arm11/input_poll.h"
+#include "arm11/color_lut.h"
 #include "arm11/drivers/lgy11.h"
 #include "kernel.h"
 #include "kevent.h"
+#include "drivers/sha.h"
+#include "arm11/core1_jobs.h"
+#include "arm11/recorder.h"
 
 
+#define ROM_READ_CHUNK_SIZE  (1024u * 1024) // Must be a multiple of the SHA block size (64 bytes).
+
+
+typedef struct
+{
+	FHandle f;
+	u32 fileSize;
+	volatile u32 bytesRead; // Updated by the reader task after each chunk.
+	volatile bool done;
+	Result res;
+} RomReader;
+
 static KHandle g_frameReadyEvent = 0;
+static KHandle g_romReadEvent = 0; // Signaled after each ROM chunk and on completion.
 
 
 
-static u32 fixRomPadding(const u32 romFileSize)
+// Hashes size bytes of 0xFF padding. Size must be a multiple of 64.
+static void hashFfPadding(u32 size)
 {
-	// Pad unused ROM area with 0xFFs (trimmed ROMs).
-	// Smallest retail ROM chip is 8 Mbit (1 MiB).
-	u32 romSize = nextPow2(romFileSize);
-	romSize = (romSize < 0x100000 ? 0x100000 : romSize);
-	const uintptr_t romLoc = LGY_ROM_LOC;
-	memset((void*)(romLoc + romFileSize), 0xFF, romSize - romFileSize);
-
-	u32 mirroredSize = romSize;
-	if(romSize == 0x100000) // 1 MiB.
+	u32 buf[256];
+	memset(buf, 0xFF, sizeof(buf));
+	while(size > 0)
 	{
-		// ROM mirroring for Classic NES Series/others with 8 Mbit ROM.
-		// The ROM is mirrored exactly 4 times.
-		// Thanks to endrift for discovering this.
-		mirroredSize = 0x400000; // 4 MiB.
-		uintptr_t mirrorLoc = romLoc + romSize;
-		do
-		{
-			memcpy((void*)mirrorLoc, (void*)romLoc, romSize);
-			mirrorLoc += romSize;
-		} while(mirrorLoc < romLoc + mirroredSize);
+		const u32 blockSize = (size < sizeof(buf) ? size : sizeof(buf));
+		SHA_update(buf, blockSize);
+		size -= blockSize;
+	}
+}
+
+static void romReaderTask(void *args)
+{
+	RomReader *const reader = (RomReader*)args;
+
+	Result res = RES_OK;
+	const u32 fileSize = reader->fileSize;
+	u32 pos = 0;
+	while(pos < fileSize)
+	{
+		const u32 chunkSize = (fileSize - pos < ROM_READ_CHUNK_SIZE ? fileSize - pos : ROM_READ_CHUNK_SIZE);
+		u32 read;
+		res = fRead(reader->f, (void*)(LGY_ROM_LOC + pos), chunkSize, &read);
+		if(res == RES_OK && read != chunkSize) res = RES_FR_DISK_ERR;
+		if(res != RES_OK) break;
+
+		pos += chunkSize;
+		reader->bytesRead = pos;
+		signalEvent(g_romReadEvent, false);
 	}
 
-	// Fake "open bus" padding.
-	if(romSize < LGY_MAX_ROM_SIZE)
-		makeOpenBusPaddingFast((u32*)(romLoc + mirroredSize));
+	// Note: reader is owned by loadGbaRom() again after setting done.
+	reader->res = res;
+	reader->done = true;
+	signalEvent(g_romReadEvent, false);
 
-	// We don't return the mirrored size because the db hashes are over unmirrored dumps.
-	return romSize;
+	taskExit();
 }
 
-static Result loadGbaRom(const char *const path, u32 *const romSizeOut)
+// Loads the ROM in chunks. While the reader task waits for the SD card
+// we hash and scan for save strings what has been loaded so far.
+// Both are skipped if the ROM cache has results for this ROM.
+static Result loadGbaRom(const char *const path, u32 *const romSizeOut, u64 *const sha1Out, SaveTypeScan *const scan)
 {
-	FHandle f;
-	Result res = fOpen(&f, path, FA_OPEN_EXISTING | FA_READ);
+	RomCacheEntry cacheEntry;
+	const bool cacheKeyValid = romCacheMakeKey(path, &cacheEntry.key) == RES_OK;
+	const bool cacheHit = cacheKeyValid && romCacheLookup(&cacheEntry.key, &cacheEntry);
+
+	RomReader reader;
+	Result res = fOpen(&reader.f, path, FA_OPEN_EXISTING | FA_READ);
 	if(res == RES_OK)
 	{
-		u32 fileSize = fSize(f);
+		u32 fileSize = fSize(reader.f);
 		if(fileSize > LGY_MAX_ROM_SIZE)
 		{
 			fileSize = LGY_MAX_ROM_SIZE;
 			ee_puts("Warning: ROM file is too big. Expect crashes.");
 		}
 
-		u32 read;
-		res = fRead(f, (void*)LGY_ROM_LOC, fileSize, &read);
-		fClose(f);
+		reader.fileSize  = fileSize;
+		reader.bytesRead = 0;
+		reader.done      = false;
+		reader.res       = RES_OK;
+		if(g_romReadEvent == 0) g_romReadEvent = createEvent(false);
+		createTask(0x800, 3, romReaderTask, &reader);
+
+		if(!cacheHit) SHA_start(SHA_IN_BIG | SHA_1_MODE);
+		saveTypeScanInit(scan);
+		u32 processed = 0; // Bytes passed to the save string scan.
+		u32 hashed    = 0; // Bytes passed to the SHA engine.
+		while(1)
+		{
+			const bool done = reader.done; // Must be read before bytesRead.
+			const u32 bytesRead = reader.bytesRead;
+			if(!cacheHit && bytesRead > processed)
+			{
+				// Only full SHA blocks. The rest is hashed together with the padding.
+				const u32 hashEnd = bytesRead & ~63u;
+				SHA_update((u32*)(LGY_ROM_LOC + hashed), hashEnd - hashed);
+				hashed = hashEnd;
+
+				saveTypeScanUpdate(scan, bytesRead);
+				processed = bytesRead;
+				continue;
+			}
+			if(done) break;
+
+			waitForEvent(g_romReadEvent);
+			clearEvent(g_romReadEvent);
+		}
+
+		fClose(reader.f);
+		res = reader.res;
+
+		u32 romSize = 0;
+		if(res == RES_OK)
+		{
+			romSize = romPaddingStart(fileSize);
+			*romSizeOut = romSize;
+		}
+
+		if(cacheHit)
+		{
+			*sha1Out = cacheEntry.sha1;
+			saveTypeScanSetResult(scan, cacheEntry.saveType);
+		}
+		else
+		{
+			// Hash the remaining bytes including padding.
+			// The db hashes are over the padded but unmirrored ROM.
+			// The CPU padded the last partial block. The rest is
+			// still being filled in the background and hashed from a buffer.
+			// Note: We always finish to not leave the SHA engine busy.
+			if(res == RES_OK)
+			{
+				u32 hashEnd = (fileSize + 63) & ~63u;
+				hashEnd = (hashEnd > romSize ? romSize : hashEnd);
+				SHA_update((u32*)(LGY_ROM_LOC + hashed), hashEnd - hashed);
+				hashFfPadding(romSize - hashEnd);
+			}
+			u64 sha1[3];
+			SHA_finish((u32*)sha1, SHA_OUT_BIG);
+			*sha1Out = sha1[0];
 
-		if(read == fileSize) *romSizeOut = fixRomPadding(fileSize);
+			// No need to scan the padding. It can't contain save strings.
+			saveTypeScanFinish(scan, (fileSize + 3) & ~3u);
 
+			cacheEntry.saveType = scan->saveType;
+			cacheEntry.reserved = 0;
+			cacheEntry.sha1     = sha1[0];
+			if(res == RES_OK && cacheKeyValid)
+			{
+				res = romCacheStore(&cacheEntry);
+				if(res != RES_OK) debug_printf("Failed to update ROM cache: %s\n", result2String(res));
+				res = RES_OK; // Not fatal.
+			}
+		}
 	}
 
 	return res;
@@ -159,6 +267,45 @@ static void updateBacklight(void)
 			}
 		}
 	}
+
+	// Skip all frame work while the screen is dark. Recordings still need the frames.
+	OAF_videoPauseRender(!backlightOn && !recorderIsActive());
+}
+
+static void updateColorCorrection(void)
+{
+	// Only possible if color correction was enabled at boot.
+	// Neither the converter on core 1 nor the GPU path is set up otherwise.
+	u8 profile = g_oafConfig.colorProfile;
+	if(profile == 0) return;
+
+	// Check for special button combos.
+	const u32 kHeld = hidKeysHeld();
+	if(hidKeysDown() && kHeld)
+	{
+		bool changed = true;
+		float brightness = g_oafConfig.brightness;
+		if(kHeld == (KEY_Y | KEY_DRIGHT))     // Next color profile.
+			profile = profile % COLOR_PROFILE_NUM + 1;
+		else if(kHeld == (KEY_Y | KEY_DLEFT)) // Previous color profile.
+			profile = (profile + COLOR_PROFILE_NUM - 2) % COLOR_PROFILE_NUM + 1;
+		else if(kHeld == (KEY_Y | KEY_DUP))   // Increase screen lift.
+			brightness = (brightness + 0.02f > 1.f ? 1.f : brightness + 0.02f);
+		else if(kHeld == (KEY_Y | KEY_DDOWN)) // Decrease screen lift.
+			brightness = (brightness - 0.02f < 0.f ? 0.f : brightness - 0.02f);
+		else changed = false;
+
+		if(changed)
+		{
+			g_oafConfig.colorProfile = profile;
+			g_oafConfig.brightness   = brightness;
+			if(g_oafConfig.gpuColorCorrection) OAF_videoUpdateGpuColor();
+			else                               colorLutRequestRebuild();
+			debug_printf("Color profile %u, brightness %lu%%\n", profile, (u32)(brightness * 100 + 0.5f));
+		}
+	}
+
+	if(!g_oafConfig.gpuColorCorrection) colorLutUpdate();
 }
 
 static Result showFileBrowser(char romAndSavePath[512])
@@ -248,6 +395,8 @@ static void gameCfg2SavePath(char cfgPath[512], const u8 saveSlot)
 
 Result oafParseConfigEarly(void)
 {
+	bootTimelineStart();
+
 	Result res;
 	do
 	{
@@ -266,8 +415,17 @@ Result oafParseConfigEarly(void)
 		res = fMkdir(OAF_SCREENSHOT_DIR);
 		if(res != RES_OK && res != RES_FR_EXIST) break;
 
+		// Create recordings folder.
+		res = fMkdir(OAF_RECORDING_DIR);
+		if(res != RES_OK && res != RES_FR_EXIST) break;
+
+		// Create the ROM library index folder.
+		res = fMkdir(OAF_LIBRARY_DIR);
+		if(res != RES_OK && res != RES_FR_EXIST) break;
+
 		// Parse the config.
 		res = parseOafConfig("config.ini", &g_oafConfig, true);
+		bootTimelineMark("config");
 	} while(0);
 
 	return res;
@@ -276,6 +434,9 @@ Result oafParseConfigEarly(void)
 Result oafInitAndRun(void)
 {
 	Result res;
+	// Core 1 takes boot jobs until the color converter needs it.
+	core1JobsInit();
+
 	char *const filePath = (char*)calloc(512, 1);
 	if(filePath != NULL)
 	{
@@ -291,6 +452,7 @@ Result oafInitAndRun(void)
 				ee_puts("Loading...");
 			}
 			else if(res != RES_OK) break;
+			bootTimelineMark("rom select");
 
 			//make copy of rom path
 			char *const romFilePath = (char*)calloc(strlen(filePath)+1, 1);
@@ -299,50 +461,64 @@ Result oafInitAndRun(void)
 
 			// Load the ROM file.
 			u32 romSize;
-			res = loadGbaRom(filePath, &romSize);
+			u64 romSha1;
+			SaveTypeScan saveScan;
+			res = loadGbaRom(filePath, &romSize, &romSha1, &saveScan);
 			if(res != RES_OK) break;
+			bootTimelineMark("rom load"); // Read, SHA-1 and save string scan.
 
 			// Load the per-game config.
 			rom2GameCfgPath(filePath);
 			res = parseOafConfig(filePath, &g_oafConfig, false);
 			if(res != RES_OK && res != RES_FR_NO_FILE) break;
+			bootTimelineMark("game config");
 
 			// Adjust the path for the save file and get save type.
 			gameCfg2SavePath(filePath, g_oafConfig.saveSlot);
 			u16 saveType;
 			if(g_oafConfig.saveType != 0xFF)
 				saveType = g_oafConfig.saveType;
-			else if(g_oafConfig.useGbaDb || g_oafConfig.saveOverride)
-				saveType = getSaveType(&g_oafConfig, romSize, filePath);
 			else
-				saveType = detectSaveType(romSize, g_oafConfig.defaultSave);
+			{
+				saveType = detectSaveType(&saveScan, romSize, g_oafConfig.defaultSave);
+				if(g_oafConfig.useGbaDb || g_oafConfig.saveOverride)
+					saveType = getSaveType(&g_oafConfig, romSize, romSha1, saveType, filePath);
+			}
+			bootTimelineMark("save type"); // Including gba_db.bin lookup.
 
-			patchRom(romFilePath, &romSize);
+			patchRom(romFilePath, &romSize, romSha1);
 			free(romFilePath);
+			bootTimelineMark("patch");
 
 			// Set audio output and volume.
 			CODEC_setAudioOutput(g_oafConfig.audioOut);
 			CODEC_setVolumeOverride(g_oafConfig.volume);
 
 			// Prepare ARM9 for GBA mode + save loading.
+			// The save memory is only mapped on ARM9, which also writes it back to filePath.
 			res = LGY_prepareGbaMode(g_oafConfig.directBoot, saveType, filePath);
+			bootTimelineMark("gba mode");
 			if(res == RES_OK)
 			{
+				// The video init needs the GX engines.
+				romPaddingWait();
+				bootTimelineMark("padding");
+
 				// Initialize video output (frame capture, post processing ect.).
 				g_frameReadyEvent = OAF_videoInit();
+				bootTimelineMark("video init");
 
 				// Setup button overrides.
-				const u32 *const maps = g_oafConfig.buttonMaps;
-				u16 overrides = 0;
-				for(unsigned i = 0; i < 10; i++)
-					if(maps[i] != 0) overrides |= 1u<<i;
-				LGY11_selectInput(overrides);
+				LGY11_selectInput(inputPollInit());
 
 				// Sync LgyCap start with LCD VBlank.
 				GFX_waitForVBlank0();
 				LGY11_switchMode();
 			}
 		} while(0);
+
+		// Error paths must not leave the padding running.
+		romPaddingWait();
 	}
 	else res = RES_OUT_OF_MEM;
 
@@ -353,20 +529,18 @@ Result oafInitAndRun(void)
 
 void oafUpdate(void)
 {
-	const u32 *const maps = g_oafConfig.buttonMaps;
-	const u32 kHeld = hidKeysHeld();
-	u16 pressed = 0;
-	for(unsigned i = 0; i < 10; i++)
-	{
-		if((kHeld & maps[i]) != 0)
-			pressed |= 1u<<i;
-	}
-	LGY11_setInputState(pressed);
+	// With inputPolls above 1 the poll task also pushes buttons in between.
+	inputPollUpdate(hidKeysHeld());
 
 	CODEC_runHeadphoneDetection();
 	updateBacklight();
+	updateColorCorrection();
 	waitForEvent(g_frameReadyEvent);
 	clearEvent(g_frameReadyEvent);
+
+	// Only does something the first time.
+	bootTimelineMark("first frame");
+	bootTimelineWrite();
 }
 
 void oafFinish(void)
@@ -374,5 +548,6 @@ void oafFinish(void)
 	// frameReadyEvent deleted by this function.
 	OAF_videoExit();
 	g_frameReadyEvent = 0;
+	inputPollExit();
 	LGY11_deinit();
 }
\ No newline at end of file
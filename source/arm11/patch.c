@@ -22,192 +22,313 @@
 #include "oaf_error_codes.h"
 #include "util.h"
 #include "arm11/drivers/hid.h"
-#ifndef NDEBUG
-#include "arm11/drivers/mcu.h"
-#endif
 #include "drivers/lgy_common.h"
 #include "arm11/fmt.h"
 #include "fs.h"
 #include "arm11/patch.h"
+#include "arm11/rom_padding.h"
+#include "arm11/patch_cache.h"
+#include "arm11/config.h"
+#include "arm11/patch_stream.h"
+#include "arm11/crc32.h"
+#ifndef NDEBUG
+#include "arm11/cycle_counter.h"
+#endif
 #include "arm11/power.h"
 #include "drivers/sha.h"
+#include "arm11/drivers/gx.h"
+#include "drivers/gfx.h"
+#include "drivers/cache.h"
 
 
 #define min(a, b)  ((size_t) (a) <= (size_t) (b) ? (size_t) (a) : (size_t) (b))
 
-#define BUFFER_CAPACITY  4096
 #define UPS_MAGIC_SIZE   4
 #define UPS_CRC_SIZE     4 * 3
 
-typedef struct
-{
-	u8 *buffer;
-	u16 size;
-	u16 offset;
-	u16 capacity;
-	u32 totalRead;
-} Cache;
+#define BPS_MAGIC_SIZE   4
+#define BPS_CRC_SIZE     4 * 3
+// BPS copies from anywhere in the source so the target is decoded
+// into the unused FCRAM after the ROM and copied back at the end.
+#define BPS_TARGET_LOC   (LGY_ROM_LOC + LGY_MAX_ROM_SIZE)
+#define PPF_LINEAR_DIM   (PPF_DIM(0x10000 / 16, 0)) // 64 KiB lines without gaps.
 
 typedef struct
 {
-	FHandle handle;
-	u32 size;
 	u32 baseRomSize;
 	u32 patchedRomSize;
+	u32 crcPos;         // ROM bytes below this are in both CRCs.
+	u32 srcCrc;
+	u32 dstCrc;
 } UPSPatch;
 
-
-
-#ifndef NDEBUG
-static u8 elapsedSecs(const RtcTimeDate *before, const RtcTimeDate *after)
+enum
 {
-	// RtcTimeDate seconds are represented as hex, i.e. the 59th second is 0x59.
-	// Convert those to decimal so we can do decent math on them.
-	u8 beforeSecs = (before->sec / 16 * 10) + (before->sec % 16);
-	u8 afterSecs = (after->sec / 16 * 10) + (after->sec % 16);
-
-	// NOTE: only accounts for the first minute boundary.
-	if(afterSecs < beforeSecs) afterSecs += 60;
-
-	return afterSecs - beforeSecs;
-}
-#endif
+	BPS_SOURCE_READ = 0u,
+	BPS_TARGET_READ = 1u,
+	BPS_SOURCE_COPY = 2u,
+	BPS_TARGET_COPY = 3u
+};
 
-static u16 loadCache(const UPSPatch *patch, Cache *cache, Result *res)
+typedef struct
 {
-	cache->size = min(cache->capacity, patch->size - cache->totalRead);
-	*res = fRead(patch->handle, cache->buffer, cache->size, NULL);
-	cache->totalRead += cache->size;  // We already computed how much will be read.
-	cache->offset = 0;
+	u32 sourceSize;
+	u32 targetSize;
+	u32 srcCrcPos;      // Source bytes below this are in the source CRC.
+	u32 srcCrc;
+	u32 dstCrc;
+} BPSPatch;
 
-	return cache->size;
-}
 
-static u8 readCache(const UPSPatch *patch, Cache *cache, Result *res)
+// Returns a pointer to the next size bytes of the stream.
+// They are copied to tmp if they cross a chunk boundary.
+static Result getBytes(PatchStream *const stream, u8 *const tmp, const u32 size, const u8 **const out)
 {
-	u8 byte = cache->buffer[cache->offset++];
-
-	// Load new block of data from patch if needed.
-	if(cache->offset >= cache->capacity) loadCache(patch, cache, res);
+	if(patchStreamAvail(stream) >= size)
+	{
+		*out = stream->ptr;
+		stream->ptr += size;
+		return RES_OK;
+	}
 
-	return byte;
+	*out = tmp;
+	return patchStreamRead(stream, tmp, size);
 }
 
-static bool hasDataLeft(const Cache *cache)
+static u32 readBigEndian(const u8 *const bytes, const u32 size)
 {
-	return cache->offset < cache->size;
+	u32 val = 0;
+	for(u32 i = 0; i < size; i++) val = val<<8 | bytes[i];
+
+	return val;
 }
 
-static Result patchIPS(const FHandle patchHandle) {
+static Result patchIPS(const FHandle patchHandle, u32 *romSize, PatchDelta *const delta) {
 	ee_puts("IPS patch found! Patching...");
 
-	const u16 bufferSize = BUFFER_CAPACITY;
-	char *buffer = (char*)calloc(bufferSize, 1);
-	if(buffer == NULL) return RES_OUT_OF_MEM;
+#ifndef NDEBUG
+	const u32 startTicks = cycleCounterRead();
+#endif
 
-	// Verify patch is IPS (magic number "PATCH").
-	Result res = fRead(patchHandle, buffer, 5, NULL);
-	if(res != RES_OK || memcmp("PATCH", buffer, 5) != 0)
-	{
-		free(buffer);
-		return RES_INVALID_PATCH;
-	}
+	PatchStream stream;
+	Result res = patchStreamStart(&stream, patchHandle, 0);
+	if(res != RES_OK) return res;
 
-	u32 offset = 0;
-	u16 length = 0;
-	while(res == RES_OK)
+	do
 	{
-		// Read offset.
-		res = fRead(patchHandle, buffer, 3, NULL);
-		if(res != RES_OK || memcmp("EOF", buffer, 3) == 0) break;
-		offset = (buffer[0] << 16) + (buffer[1] << 8) + buffer[2];
-
-		// Read length.
-		res = fRead(patchHandle, buffer, 2, NULL);
-		if(res != RES_OK) break;
-		length = (buffer[0] << 8) + buffer[1];
-
-		// RLE hunk.
-		if(length == 0)
+		// Verify patch is IPS (magic number "PATCH") or IPS32 ("IPS32").
+		u8 magic[5];
+		if(patchStreamRead(&stream, magic, 5) != RES_OK) { res = RES_INVALID_PATCH; break; }
+		const bool ips32 = memcmp("IPS32", magic, 5) == 0;
+		if(!ips32 && memcmp("PATCH", magic, 5) != 0) { res = RES_INVALID_PATCH; break; }
+
+		// IPS32 uses 4 byte offsets and "EEOF".
+		const u32 offsetSize = (ips32 ? 4 : 3);
+		const u32 eofMarker  = (ips32 ? 0x45454F46u : 0x454F46u);
+		while(1)
 		{
-			res = fRead(patchHandle, buffer, 3, NULL);
-			if(res != RES_OK) break;
-
-			length = (buffer[0] << 8) + buffer[1];
-			memset((void*)(LGY_ROM_LOC + offset), buffer[2], length * sizeof(char));
+			u8 tmp[4];
+			const u8 *bytes;
 
-			continue;
-		}
+			// Read offset.
+			if((res = getBytes(&stream, tmp, offsetSize, &bytes)) != RES_OK) break;
+			const u32 offset = readBigEndian(bytes, offsetSize);
+			if(offset == eofMarker)
+			{
+				// Optional truncation to the size following the EOF marker.
+				if(stream.size - patchStreamTell(&stream) >= offsetSize)
+				{
+					if((res = getBytes(&stream, tmp, offsetSize, &bytes)) != RES_OK) break;
+					const u32 truncSize = readBigEndian(bytes, offsetSize);
+					if(truncSize < *romSize)
+					{
+						memset((void*)(LGY_ROM_LOC + truncSize), 0xFF, *romSize - truncSize);
+						if(delta != NULL)
+						{
+							delta->fillStart = truncSize;
+							delta->fillEnd   = *romSize;
+						}
+
+						u32 newRomSize = nextPow2(truncSize);
+						newRomSize = (newRomSize < 0x100000 ? 0x100000 : newRomSize);
+						*romSize = (newRomSize < *romSize ? newRomSize : *romSize);
+					}
+				}
+				break;
+			}
 
-		// Regular hunks.
-		u16 fullCount = length / bufferSize;
-		for(u16 i = 0; i < fullCount; ++i)
-		{
-			res = fRead(patchHandle, buffer, bufferSize, NULL);
-			if(res != RES_OK) break;
+			// Read length.
+			if((res = getBytes(&stream, tmp, 2, &bytes)) != RES_OK) break;
+			u32 length = readBigEndian(bytes, 2);
 
-			for(u16 j = 0; j < bufferSize; ++j)
+			// RLE hunk.
+			u8 rleVal = 0;
+			const bool isRle = length == 0;
+			if(isRle)
 			{
-				*(char*)(LGY_ROM_LOC + offset + (bufferSize * i) + j) = buffer[j];
+				if((res = getBytes(&stream, tmp, 3, &bytes)) != RES_OK) break;
+				length = readBigEndian(bytes, 2);
+				rleVal = bytes[2];
 			}
-		}
-
-		u16 remaining = length % bufferSize;
-		if(remaining == 0) continue;
 
-		res = fRead(patchHandle, buffer, remaining, NULL);
-		if(res != RES_OK) break;
+			if(offset > LGY_MAX_ROM_SIZE || length > LGY_MAX_ROM_SIZE - offset)
+			{
+				res = RES_INVALID_PATCH;
+				break;
+			}
 
-		for(u16 j = 0; j < remaining; ++j)
-		{
-			*(char*)(LGY_ROM_LOC + offset + (bufferSize * fullCount) + j) = buffer[j];
+			// Hunk data goes straight from the stream buffer to the ROM.
+			void *const dst = (void*)(LGY_ROM_LOC + offset);
+			if(isRle) memset(dst, rleVal, length);
+			else if((res = patchStreamRead(&stream, dst, length)) != RES_OK) break;
+			patchDeltaAdd(delta, offset, length);
 		}
-	}
+	} while(0);
+
+	patchStreamEnd(&stream);
 
-	free(buffer);
+#ifndef NDEBUG
+	const u32 ms = cycleCounterToMs(cycleCounterRead() - startTicks);
+	debug_printf("Patched %lu KiB in %lu ms (%lu KiB/s).\n", stream.size / 1024, ms,
+	             (u32)((u64)stream.size * 1000 / 1024 / (ms > 0 ? ms : 1)));
+#endif
 
 	return res;
 }
 
 //based on code from http://fileformats.archiveteam.org/wiki/UPS_(binary_patch_format) (CC0, No copyright)
-static u32 read_vuint(const UPSPatch *patch, Result *res, Cache *cache)
+static Result readVuint(PatchStream *const stream, u32 *const out)
 {
 	u32 result = 0, shift = 0;
-
-	u8 octet = 0;
 	for (;;) {
-		octet = readCache(patch, cache, res);
-		if(*res != RES_OK) break;
+		u8 octet;
+		const Result res = patchStreamReadByte(stream, &octet);
+		if(res != RES_OK) return res;
 		if(octet & 0x80) {
 			result += (octet & 0x7f) << shift;
 			break;
 		}
 		result += (octet | 0x80) << shift;
 		shift += 7;
+		if(shift > 28) return RES_INVALID_PATCH; // Doesn't fit in 32 bits.
+	}
+
+	*out = result;
+
+	return RES_OK;
+}
+
+// Returns the index of the first zero byte or size if there is none.
+static u32 findZeroByte(const u8 *const data, const u32 size)
+{
+	u32 i = 0;
+	while(i < size && ((uintptr_t)(data + i) & 3u) != 0)
+	{
+		if(data[i] == 0) return i;
+		i++;
+	}
+
+	// Check 4 bytes at a time. Only the word with the zero byte is rechecked below.
+	while(size - i >= 4)
+	{
+		const u32 word = *(const u32*)(data + i);
+		if(((word - 0x01010101u) & ~word & 0x80808080u) != 0) break;
+		i += 4;
+	}
+
+	while(i < size && data[i] != 0) i++;
+
+	return i;
+}
+
+static void xorBytes(u8 *dst, const u8 *src, u32 size)
+{
+	while(size > 0 && ((uintptr_t)dst & 3u) != 0)
+	{
+		*dst++ ^= *src++;
+		size--;
+	}
+
+	// ARMv6 handles the unaligned loads from src.
+	while(size >= 4)
+	{
+		u32 mask;
+		memcpy(&mask, src, 4);
+		*(u32*)dst ^= mask;
+		dst  += 4;
+		src  += 4;
+		size -= 4;
+	}
+
+	while(size > 0)
+	{
+		*dst++ ^= *src++;
+		size--;
+	}
+}
+
+// Adds unchanged ROM bytes up to end to the source and target CRCs.
+static void upsCrcAdvance(UPSPatch *const patch, const u32 end)
+{
+	const u8 *const romBytes = (u8*)LGY_ROM_LOC;
+	u32 pos = patch->crcPos;
+	if(end <= pos) return;
+
+	const u32 srcEnd = min(end, patch->baseRomSize);
+	const u32 dstEnd = min(end, patch->patchedRomSize);
+	const u32 bothEnd = min(srcEnd, dstEnd);
+	if(pos < bothEnd)
+	{
+		crc32UpdateDual(&patch->srcCrc, &patch->dstCrc, romBytes + pos, bothEnd - pos);
+		pos = bothEnd;
 	}
 
-	return result;
+	// Only one of these is left if the ROM size changes.
+	if(pos < dstEnd) patch->dstCrc = crc32Update(patch->dstCrc, romBytes + pos, dstEnd - pos);
+	if(pos < srcEnd) patch->srcCrc = crc32Update(patch->srcCrc, romBytes + pos, srcEnd - pos);
+
+	patch->crcPos = end;
+}
+
+// Applies up to size mask bytes at offset and stops after the terminating zero byte.
+// Returns the number of mask bytes used.
+static u32 upsApplyMask(UPSPatch *const patch, const u8 *const mask, const u32 size, const u32 offset, bool *const runEnd)
+{
+	const u32 zeroIdx = findZeroByte(mask, size);
+	*runEnd = zeroIdx < size;
+	const u32 length = (*runEnd ? zeroIdx + 1 : size);
+
+	// Source CRC before and target CRC after applying the mask.
+	u8 *const romBytes = (u8*)LGY_ROM_LOC;
+	upsCrcAdvance(patch, offset);
+	if(offset < patch->baseRomSize)
+		patch->srcCrc = crc32Update(patch->srcCrc, romBytes + offset, min(length, patch->baseRomSize - offset));
+	xorBytes(romBytes + offset, mask, length);
+	patch->dstCrc = crc32Update(patch->dstCrc, romBytes + offset, length);
+	patch->crcPos = offset + length;
+
+	return length;
 }
 
-// This function expects that the first chunk of the UPS patch is cached.
-static Result loadUPSMetadata(UPSPatch *patch, Cache *cache)
+static Result loadUPSMetadata(UPSPatch *patch, PatchStream *stream)
 {
 	// Check magic.
-	if(memcmp("UPS1", cache->buffer, UPS_MAGIC_SIZE) != 0) return RES_INVALID_PATCH;
-	cache->offset += UPS_MAGIC_SIZE;
+	char magic[UPS_MAGIC_SIZE];
+	Result res = patchStreamRead(stream, magic, UPS_MAGIC_SIZE);
+	if(res != RES_OK) return res;
+	if(memcmp("UPS1", magic, UPS_MAGIC_SIZE) != 0) return RES_INVALID_PATCH;
 
 	// Decode base and patched ROM sizes.
-	Result res = RES_OK;
-	patch->baseRomSize = read_vuint(patch, &res, cache);
+	res = readVuint(stream, &patch->baseRomSize);
 	if(res != RES_OK) return res;
 
-	patch->patchedRomSize = read_vuint(patch, &res, cache);
+	res = readVuint(stream, &patch->patchedRomSize);
 	if(res != RES_OK) return res;
 
 	debug_printf("Base size:    0x%lx\nPatched size: 0x%lx\n", patch->baseRomSize, patch->patchedRomSize);
 
 	// Patches that would result in a ROM bigger than 32MiB are invalid.
-	if(patch->patchedRomSize > LGY_MAX_ROM_SIZE)
+	if(patch->baseRomSize > LGY_MAX_ROM_SIZE || patch->patchedRomSize > LGY_MAX_ROM_SIZE)
 	{
 		ee_puts("Patched ROM exceeds 32MiB! Skipping patching...");
 		return RES_INVALID_PATCH;
@@ -216,84 +337,335 @@ static Result loadUPSMetadata(UPSPatch *patch, Cache *cache)
 	return res;
 }
 
-static Result patchUPS(const FHandle patchHandle, u32 *romSize) {
+static Result patchUPS(const FHandle patchHandle, u32 *romSize, PatchDelta *const delta) {
 	ee_puts("UPS patch found! Patching...");
 
 	// Reject patches shorter than header + CRC hashes.
-	// Compute length minus hashes when done.
-	u32 patchSize = fSize(patchHandle);
+	const u32 patchSize = fSize(patchHandle);
 	if(patchSize < UPS_MAGIC_SIZE + UPS_CRC_SIZE) return RES_INVALID_PATCH;
-	patchSize -= UPS_CRC_SIZE;
-
-	UPSPatch patch = {
-		patchHandle,
-		patchSize,   // Patch file size minus CRC-32 hashes.
-		0,           // Base ROM size.
-		0            // Patched ROM size.
-	};
-
-	// Try to perform initial caching.
-	Cache cache = {
-		(u8*)calloc(BUFFER_CAPACITY, 1),  // Buffer.
-		min(BUFFER_CAPACITY, patch.size), // Size.
-		0,                                // Offset.
-		BUFFER_CAPACITY,                  // Capacity.
-		0,                                // Total bytes read.
-	};
-	if(cache.buffer == NULL) return RES_OUT_OF_MEM;
-
-	Result res;
-	loadCache(&patch, &cache, &res);
-	if(res != RES_OK)
+	const u32 dataEnd = patchSize - UPS_CRC_SIZE;
+
+	// The patch CRC covers everything except itself.
+	PatchStream stream;
+	Result res = patchStreamStart(&stream, patchHandle, patchSize - 4);
+	if(res != RES_OK) return res;
+
+	UPSPatch patch = {0};
+	do
 	{
-		free(cache.buffer);
-		return res;
+		// Validate the patch and load the metadata.
+		if((res = loadUPSMetadata(&patch, &stream)) != RES_OK) break;
+
+		// Scale up ROM if needed.
+		if(patch.patchedRomSize > patch.baseRomSize)
+		{
+			*romSize = nextPow2(patch.patchedRomSize);
+			// Zero extra ROM space to be patched.
+			memset((char*)(LGY_ROM_LOC + patch.baseRomSize), 0x00, patch.patchedRomSize - patch.baseRomSize);
+			// Pad up to the end of the virtual cart.
+			memset((char*)(LGY_ROM_LOC + patch.patchedRomSize), 0xFF, *romSize - patch.patchedRomSize);
+
+			patchDeltaAdd(delta, patch.baseRomSize, patch.patchedRomSize - patch.baseRomSize);
+			if(delta != NULL)
+			{
+				delta->fillStart = patch.patchedRomSize;
+				delta->fillEnd   = *romSize;
+			}
+		}
+
+		// Patch the ROM. Each block is a skip followed by XOR
+		// mask bytes up to and including a zero byte.
+		u32 offset = 0;
+		while(patchStreamTell(&stream) < dataEnd)
+		{
+			u32 skip;
+			if((res = readVuint(&stream, &skip)) != RES_OK) break;
+			offset += skip;
+
+			const u32 blockStart = offset;
+			bool runEnd = false;
+			while(!runEnd)
+			{
+				if(patchStreamAvail(&stream) == 0 && (res = patchStreamNextChunk(&stream)) != RES_OK) break;
+
+				// Don't use the CRCs as mask bytes.
+				const u32 size = min(patchStreamAvail(&stream), dataEnd - patchStreamTell(&stream));
+				if(size == 0) break;
+
+				// Use the expected exact ROM size. Encoders usually
+				// put the last terminating zero byte past the end.
+				u32 used;
+				if(offset < patch.patchedRomSize)
+					used = upsApplyMask(&patch, stream.ptr, min(size, patch.patchedRomSize - offset), offset, &runEnd);
+				else
+				{
+					const u32 zeroIdx = findZeroByte(stream.ptr, size);
+					runEnd = zeroIdx < size;
+					used = (runEnd ? zeroIdx + 1 : size);
+				}
+				stream.ptr += used;
+				offset     += used;
+			}
+			if(blockStart < patch.patchedRomSize)
+				patchDeltaAdd(delta, blockStart, min(offset, patch.patchedRomSize) - blockStart);
+			if(res != RES_OK) break;
+		}
+		if(res != RES_OK) break;
+		if(patchStreamTell(&stream) != dataEnd)
+		{
+			res = RES_INVALID_PATCH;
+			break;
+		}
+
+		// Verify source, target and patch CRC.
+		u32 crcs[3];
+		if((res = patchStreamRead(&stream, crcs, sizeof(crcs))) != RES_OK) break;
+		upsCrcAdvance(&patch, (patch.baseRomSize > patch.patchedRomSize ? patch.baseRomSize : patch.patchedRomSize));
+		debug_printf("Source CRC: %08lX/%08lX\nTarget CRC: %08lX/%08lX\nPatch CRC:  %08lX/%08lX\n",
+		             patch.srcCrc, crcs[0], patch.dstCrc, crcs[1], stream.crc, crcs[2]);
+		if(patch.srcCrc != crcs[0] || patch.dstCrc != crcs[1] || stream.crc != crcs[2])
+			res = RES_PATCH_CRC_MISMATCH;
+	} while(0);
+
+	patchStreamEnd(&stream);
+
+	return res;
+}
+
+// Adds source bytes up to end to the source CRC.
+static void bpsSrcCrcAdvance(BPSPatch *const patch, const u32 end)
+{
+	if(end <= patch->srcCrcPos) return;
+
+	patch->srcCrc = crc32Update(patch->srcCrc, (u8*)LGY_ROM_LOC + patch->srcCrcPos, end - patch->srcCrcPos);
+	patch->srcCrcPos = end;
+}
+
+// Applies a signed relative offset (sign in bit 0) to offset.
+static Result readBpsOffset(PatchStream *const stream, u32 *const offset)
+{
+	u32 data;
+	const Result res = readVuint(stream, &data);
+	if(res != RES_OK) return res;
+
+	const u32 rel = data>>1;
+	if(data & 1u)
+	{
+		if(rel > *offset) return RES_INVALID_PATCH;
+		*offset -= rel;
+	}
+	else
+	{
+		if(rel > LGY_MAX_ROM_SIZE) return RES_INVALID_PATCH;
+		*offset += rel;
 	}
 
-	// Validate the patch and load the metadata.
-	if((res = loadUPSMetadata(&patch, &cache)) != RES_OK)
+	return RES_OK;
+}
+
+static Result loadBPSMetadata(BPSPatch *patch, PatchStream *stream)
+{
+	// Check magic.
+	char magic[BPS_MAGIC_SIZE];
+	Result res = patchStreamRead(stream, magic, BPS_MAGIC_SIZE);
+	if(res != RES_OK) return res;
+	if(memcmp("BPS1", magic, BPS_MAGIC_SIZE) != 0) return RES_INVALID_PATCH;
+
+	// Decode source and target ROM sizes.
+	res = readVuint(stream, &patch->sourceSize);
+	if(res != RES_OK) return res;
+
+	res = readVuint(stream, &patch->targetSize);
+	if(res != RES_OK) return res;
+
+	debug_printf("Source size: 0x%lx\nTarget size: 0x%lx\n", patch->sourceSize, patch->targetSize);
+
+	// Patches that would result in a ROM bigger than 32MiB are invalid.
+	if(patch->sourceSize > LGY_MAX_ROM_SIZE || patch->targetSize > LGY_MAX_ROM_SIZE)
 	{
-		free(cache.buffer);
-		return res;
+		ee_puts("Patched ROM exceeds 32MiB! Skipping patching...");
+		return RES_INVALID_PATCH;
 	}
+	if(patch->targetSize == 0) return RES_INVALID_PATCH;
+
+	// We don't need the metadata.
+	u32 metadataSize;
+	res = readVuint(stream, &metadataSize);
+	if(res != RES_OK) return res;
 
-	// Scale up ROM if needed.
-	if(patch.patchedRomSize > patch.baseRomSize)
+	return patchStreamSkip(stream, metadataSize);
+}
+
+// Copies the decoded target to the ROM and pads it to the new ROM size.
+static void bpsCommitTarget(const u32 targetSize, u32 *romSize, PatchDelta *const delta)
+{
+	u32 newRomSize = nextPow2(targetSize);
+	newRomSize = (newRomSize < 0x100000 ? 0x100000 : newRomSize);
+	*romSize = (newRomSize > *romSize ? newRomSize : *romSize);
+
+	// Write back the target and evict the ROM lines the PPF overwrites.
+	const u32 copySize = (targetSize + 15) & ~15u;
+	flushDCacheRange((void*)BPS_TARGET_LOC, copySize);
+	flushDCacheRange((void*)LGY_ROM_LOC, copySize);
+	GX_textureCopy((u32*)BPS_TARGET_LOC, PPF_LINEAR_DIM, (u32*)LGY_ROM_LOC, PPF_LINEAR_DIM, copySize);
+	GFX_waitForPPF();
+
+	// Pad up to the end of the virtual cart.
+	if(targetSize < *romSize)
 	{
-		*romSize = nextPow2(patch.patchedRomSize);
-		// Zero extra ROM space to be patched.
-		memset((char*)(LGY_ROM_LOC + patch.baseRomSize), 0x00, patch.patchedRomSize - patch.baseRomSize);
-		// Pad up to the end of the virtual cart.
-		memset((char*)(LGY_ROM_LOC + patch.patchedRomSize), 0xFF, *romSize - patch.patchedRomSize);
+		memset((void*)(LGY_ROM_LOC + targetSize), 0xFF, *romSize - targetSize);
+		if(delta != NULL)
+		{
+			delta->fillStart = targetSize;
+			delta->fillEnd   = *romSize;
+		}
 	}
+}
 
-	// Patch the ROM.
-	u32 offset = 0;
-	u8 *romBytes = ((u8*)LGY_ROM_LOC);
-	while(hasDataLeft(&cache) && res == RES_OK)
+// Based on the BPS specification by byuu/Near.
+static Result patchBPS(const FHandle patchHandle, u32 *romSize, PatchDelta *const delta) {
+	ee_puts("BPS patch found! Patching...");
+
+#ifndef NDEBUG
+	const u32 startTicks = cycleCounterRead();
+#endif
+
+	// Reject patches shorter than header + CRC hashes.
+	const u32 patchSize = fSize(patchHandle);
+	if(patchSize < BPS_MAGIC_SIZE + BPS_CRC_SIZE) return RES_INVALID_PATCH;
+	const u32 dataEnd = patchSize - BPS_CRC_SIZE;
+
+	// The patch CRC covers everything except itself.
+	PatchStream stream;
+	Result res = patchStreamStart(&stream, patchHandle, patchSize - 4);
+	if(res != RES_OK) return res;
+
+	const u8 *const source = (u8*)LGY_ROM_LOC;
+	u8 *const target = (u8*)BPS_TARGET_LOC;
+	BPSPatch patch = {0};
+	do
 	{
-		offset += read_vuint(&patch, &res, &cache);
-		if(res != RES_OK) break;
+		// Validate the patch and load the metadata.
+		if((res = loadBPSMetadata(&patch, &stream)) != RES_OK) break;
 
-		// Use the expected exact ROM size.
-		while(offset < patch.patchedRomSize)
+		// Decode all actions. The target is written sequentially so
+		// its CRC is updated right after each action.
+		u32 outOffset = 0, srcRelOffset = 0, dstRelOffset = 0;
+		while(patchStreamTell(&stream) < dataEnd)
 		{
-			u8 mask = readCache(&patch, &cache, &res);
+			u32 data;
+			if((res = readVuint(&stream, &data)) != RES_OK) break;
+			const u32 action = data & 3u;
+			const u32 length = (data>>2) + 1;
+			if(length > patch.targetSize - outOffset)
+			{
+				res = RES_INVALID_PATCH;
+				break;
+			}
+
+			u8 *const out = target + outOffset;
+			switch(action)
+			{
+				case BPS_SOURCE_READ:
+					if(outOffset > patch.sourceSize || length > patch.sourceSize - outOffset)
+					{
+						res = RES_INVALID_PATCH;
+						break;
+					}
+
+					// Same bytes at the same offset. Update both CRCs in one go.
+					// Unchanged ROM bytes are not part of the delta.
+					bpsSrcCrcAdvance(&patch, outOffset);
+					crc32UpdateDual(&patch.srcCrc, &patch.dstCrc, source + outOffset, length);
+					patch.srcCrcPos = outOffset + length;
+					memcpy(out, source + outOffset, length);
+					break;
+				case BPS_TARGET_READ:
+					res = patchStreamRead(&stream, out, length);
+					break;
+				case BPS_SOURCE_COPY:
+					if((res = readBpsOffset(&stream, &srcRelOffset)) != RES_OK) break;
+					if(srcRelOffset > patch.sourceSize || length > patch.sourceSize - srcRelOffset)
+					{
+						res = RES_INVALID_PATCH;
+						break;
+					}
+
+					memcpy(out, source + srcRelOffset, length);
+					srcRelOffset += length;
+					break;
+				case BPS_TARGET_COPY:
+					if((res = readBpsOffset(&stream, &dstRelOffset)) != RES_OK) break;
+					if(dstRelOffset >= outOffset)
+					{
+						res = RES_INVALID_PATCH;
+						break;
+					}
+
+					// Overlapping copies repeat the previous output.
+					if(outOffset - dstRelOffset >= length) memcpy(out, target + dstRelOffset, length);
+					else
+					{
+						const u8 *in = target + dstRelOffset;
+						for(u32 i = 0; i < length; i++) out[i] = in[i];
+					}
+					dstRelOffset += length;
+					break;
+			}
 			if(res != RES_OK) break;
 
-			romBytes[offset] ^= mask;
-			offset++;
+			if(action != BPS_SOURCE_READ)
+			{
+				patch.dstCrc = crc32Update(patch.dstCrc, out, length);
+				patchDeltaAdd(delta, outOffset, length);
+			}
+			outOffset += length;
+		}
+		if(res != RES_OK) break;
+		if(patchStreamTell(&stream) != dataEnd || outOffset != patch.targetSize)
+		{
+			res = RES_INVALID_PATCH;
+			break;
+		}
 
-			// Skip to the next block of changes if this one is over.
-			if(mask == 0x00) break;
+		// Verify source, target and patch CRC.
+		u32 crcs[3];
+		if((res = patchStreamRead(&stream, crcs, sizeof(crcs))) != RES_OK) break;
+		bpsSrcCrcAdvance(&patch, patch.sourceSize);
+		debug_printf("Source CRC: %08lX/%08lX\nTarget CRC: %08lX/%08lX\nPatch CRC:  %08lX/%08lX\n",
+		             patch.srcCrc, crcs[0], patch.dstCrc, crcs[1], stream.crc, crcs[2]);
+		if(patch.srcCrc != crcs[0] || patch.dstCrc != crcs[1] || stream.crc != crcs[2])
+		{
+			res = RES_PATCH_CRC_MISMATCH;
+			break;
 		}
-	}
 
-	free(cache.buffer);
+		// The ROM is untouched until here.
+		bpsCommitTarget(patch.targetSize, romSize, delta);
+	} while(0);
+
+	patchStreamEnd(&stream);
+
+#ifndef NDEBUG
+	const u32 ms = cycleCounterToMs(cycleCounterRead() - startTicks);
+	debug_printf("Patched %lu KiB in %lu ms (%lu KiB/s).\n", stream.size / 1024, ms,
+	             (u32)((u64)stream.size * 1000 / 1024 / (ms > 0 ? ms : 1)));
+#endif
+
 	return res;
 }
 
-Result patchRom(const char *const gamePath, u32 *romSize) {
+static void showPatchErrorPrompt(const Result res) {
+	printError(res);
+	ee_puts("An error has occurred while patching.\nContinuing is NOT recommended!\n\nPress Y+UP to proceed");
+	while(1){
+		hidScanInput();
+		if(hidKeysHeld() == (KEY_Y | KEY_DUP) && hidKeysDown() != 0) break;
+		if(hidGetExtraKeys(0) & (KEY_POWER_HELD | KEY_POWER)) power_off();
+	}
+}
+
+Result patchRom(const char *const gamePath, u32 *romSize, const u64 baseSha1) {
 	Result res = RES_OK;
 
 	//if X is held during launch, skip patching
@@ -301,6 +673,24 @@ Result patchRom(const char *const gamePath, u32 *romSize) {
 	if(hidKeysHeld() == KEY_X)
 		return res;
 
+	// Try the patched ROM cache first. The key changes with the ROM and patch file.
+	RomCacheKey cacheKey;
+	const bool useCache = g_oafConfig.cachePatches && romCacheMakeKey(gamePath, &cacheKey) == RES_OK
+	                      && cacheKey.patchSize != 0;
+	if(useCache) {
+		romPaddingWait();
+		res = patchCacheLoad(&cacheKey, baseSha1, romSize);
+		if(res == RES_OK) return res;
+		if(res != RES_NOT_FOUND) {
+			// The ROM is only partially patched at this point.
+			showPatchErrorPrompt(res);
+			return res;
+		}
+	}
+	PatchDelta delta;
+	patchDeltaInit(&delta);
+	PatchDelta *const deltaPtr = (useCache ? &delta : NULL);
+
 	//get base path for game with 'gba' extension removed
 	int gamePathLength = strlen(gamePath) + 1; //add 1 for '\0' character
 	const int extensionOffset = gamePathLength-4;
@@ -316,16 +706,11 @@ Result patchRom(const char *const gamePath, u32 *romSize) {
 		//check if patch file is present. If so, call appropriate patching function
 		if((res = fOpen(&f, strcat(patchPathBase, "ips"), FA_OPEN_EXISTING | FA_READ)) == RES_OK)
 		{
-			res = patchIPS(f);
-
-			if(res != RES_OK && res != RES_INVALID_PATCH) {
-				ee_puts("An error has occurred while patching.\nContinuing is NOT recommended!\n\nPress Y+UP to proceed");
-				while(1){
-					hidScanInput();
-					if(hidKeysHeld() == (KEY_Y | KEY_DUP) && hidKeysDown() != 0) break;
-					if(hidGetExtraKeys(0) & (KEY_POWER_HELD | KEY_POWER)) power_off();
-				}
-			}
+			// Patches write into the padding.
+			romPaddingWait();
+			res = patchIPS(f, romSize, deltaPtr);
+
+			if(res != RES_OK && res != RES_INVALID_PATCH) showPatchErrorPrompt(res);
 
 			fClose(f);
 			goto cleanup;
@@ -335,24 +720,28 @@ Result patchRom(const char *const gamePath, u32 *romSize) {
 
 		if ((res = fOpen(&f, strcat(patchPathBase, "ups"), FA_OPEN_EXISTING | FA_READ)) == RES_OK) 
 		{
+			romPaddingWait();
 #ifndef NDEBUG
-			RtcTimeDate before, after;
-			MCU_getRtcTimeDate(&before);
+			const u32 startTicks = cycleCounterRead();
 #endif
-			res = patchUPS(f, romSize);
+			res = patchUPS(f, romSize, deltaPtr);
 #ifndef NDEBUG
-			MCU_getRtcTimeDate(&after);
-			debug_printf("Patching took: %us\n", elapsedSecs(&before, &after));
+			debug_printf("Patching took: %lu ms\n", cycleCounterToMs(cycleCounterRead() - startTicks));
 #endif
 
-			if(res != RES_OK && res != RES_INVALID_PATCH) {
-				ee_puts("An error has occurred while patching.\nContinuing is NOT recommended!\n\nPress Y+UP to proceed");
-				while(1){
-					hidScanInput();
-					if(hidKeysHeld() == (KEY_Y | KEY_DUP) && hidKeysDown() != 0) break;
-					if(hidGetExtraKeys(0) & (KEY_POWER_HELD | KEY_POWER)) power_off();
-				}
-			}
+			if(res != RES_OK && res != RES_INVALID_PATCH) showPatchErrorPrompt(res);
+
+			fClose(f);
+			goto cleanup;
+		}
+		memset(patchPathBase+extensionOffset, '\0', 3);
+
+		if ((res = fOpen(&f, strcat(patchPathBase, "bps"), FA_OPEN_EXISTING | FA_READ)) == RES_OK)
+		{
+			romPaddingWait();
+			res = patchBPS(f, romSize, deltaPtr);
+
+			if(res != RES_OK && res != RES_INVALID_PATCH) showPatchErrorPrompt(res);
 
 			fClose(f);
 			goto cleanup;
@@ -367,12 +756,20 @@ cleanup:
 	free(patchPath);
 	free(patchPathBase);
 
+	// Only cache successfully applied patches.
+	if(useCache && res == RES_OK) {
+		const Result cacheRes = patchCacheStore(&cacheKey, baseSha1, *romSize, &delta);
+		if(cacheRes != RES_OK) debug_printf("Failed to update patch cache: %s\n", result2String(cacheRes));
+	}
+	patchDeltaFree(&delta);
+
 	if(res == RES_INVALID_PATCH) {
 		ee_puts("Patch is not valid! Skipping...\n");
 	} 
 #ifndef NDEBUG	
 	else {
 		u64 sha1[3];
+		romPaddingWait();
 		sha((u32*)LGY_ROM_LOC, *romSize, (u32*)sha1, SHA_IN_BIG | SHA_1_MODE, SHA_OUT_BIG);
 		debug_printf("New hash: '%016" PRIX64 "'\n", __builtin_bswap64(sha1[0]));
 	}
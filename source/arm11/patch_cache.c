@@ -0,0 +1,289 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "types.h"
+#include "arm11/patch_cache.h"
+#include "fs.h"
+#include "drivers/lgy_common.h"
+#include "arm11/fmt.h"
+
+
+#define PATCH_CACHE_MAGIC     (0x4446414Fu) // "OAFD"
+#define PATCH_CACHE_VERSION   (1u)
+#define PATCH_CACHE_BUF_SIZE  (0x8000u)
+#define PATCH_RUN_MERGE_GAP   (256u) // Unchanged bytes we store to save a run.
+
+
+typedef struct
+{
+	u32 magic;
+	u16 version;
+	u16 reserved;
+	u64 baseSha1;    // First 8 bytes of the SHA-1 over the padded, unpatched ROM.
+	RomCacheKey key; // Base ROM and patch file.
+	u32 romSize;     // Padded ROM size after patching.
+	u32 fillStart;
+	u32 fillEnd;
+	u32 runCount;
+	u32 dataSize;    // Sum of all run sizes.
+	// PatchRun runs[runCount];
+	// u8 data[dataSize];
+} PatchCacheHeader;
+static_assert(sizeof(PatchCacheHeader) == 56, "Error: Patch cache header struct is not packed!");
+
+
+
+void patchDeltaInit(PatchDelta *const delta)
+{
+	memset(delta, 0, sizeof(PatchDelta));
+}
+
+void patchDeltaAdd(PatchDelta *const delta, const u32 offset, const u32 size)
+{
+	if(delta == NULL || delta->overflow || size == 0) return;
+
+	// Patches usually change many small areas close to each other.
+	if(delta->count > 0)
+	{
+		PatchRun *const last = &delta->runs[delta->count - 1];
+		const u32 lastEnd = last->offset + last->size;
+		if(offset >= last->offset && offset <= lastEnd + PATCH_RUN_MERGE_GAP)
+		{
+			if(offset + size > lastEnd) last->size = offset + size - last->offset;
+			return;
+		}
+	}
+
+	if(delta->count == delta->capacity)
+	{
+		const u32 newCapacity = (delta->capacity == 0 ? 256 : delta->capacity * 2);
+		PatchRun *const newRuns = (PatchRun*)realloc(delta->runs, newCapacity * sizeof(PatchRun));
+		if(newRuns == NULL)
+		{
+			delta->overflow = true;
+			return;
+		}
+		delta->runs     = newRuns;
+		delta->capacity = newCapacity;
+	}
+
+	delta->runs[delta->count++] = (PatchRun){offset, size};
+}
+
+void patchDeltaFree(PatchDelta *const delta)
+{
+	free(delta->runs);
+	patchDeltaInit(delta);
+}
+
+static void makeCachePath(char path[32], const u32 pathHash)
+{
+	ee_sprintf(path, PATCH_CACHE_DIR "/%08lX.bin", pathHash);
+}
+
+static Result readExact(const FHandle f, void *const buf, const u32 size)
+{
+	u32 read;
+	const Result res = fRead(f, buf, size, &read);
+	return (res == RES_OK && read != size ? RES_FR_DISK_ERR : res);
+}
+
+static Result writeExact(const FHandle f, const void *const buf, const u32 size)
+{
+	u32 written;
+	const Result res = fWrite(f, buf, size, &written);
+	return (res == RES_OK && written != size ? RES_FR_DENIED : res);
+}
+
+static bool isHeaderValid(const PatchCacheHeader *const hdr, const RomCacheKey *const key,
+                          const u64 baseSha1, const u32 fileSize)
+{
+	if(hdr->magic != PATCH_CACHE_MAGIC || hdr->version != PATCH_CACHE_VERSION) return false;
+	if(hdr->baseSha1 != baseSha1 || memcmp(&hdr->key, key, sizeof(RomCacheKey)) != 0) return false;
+	if(hdr->romSize > LGY_MAX_ROM_SIZE || hdr->fillStart > hdr->fillEnd || hdr->fillEnd > LGY_MAX_ROM_SIZE)
+		return false;
+
+	// Runs can't be bigger than the ROM so this can't overflow.
+	if(hdr->runCount > LGY_MAX_ROM_SIZE / sizeof(PatchRun) || hdr->dataSize > LGY_MAX_ROM_SIZE) return false;
+	return fileSize == sizeof(PatchCacheHeader) + hdr->runCount * sizeof(PatchRun) + hdr->dataSize;
+}
+
+static bool areRunsValid(const PatchRun *const runs, const u32 runCount, const u32 dataSize)
+{
+	u32 total = 0;
+	for(u32 i = 0; i < runCount; i++)
+	{
+		const PatchRun *const run = &runs[i];
+		if(run->offset > LGY_MAX_ROM_SIZE || run->size > LGY_MAX_ROM_SIZE - run->offset) return false;
+		total += run->size; // Can't overflow. Both are limited to 32 MiB.
+		if(total > dataSize) return false;
+	}
+
+	return total == dataSize;
+}
+
+static Result applyRuns(const FHandle f, const PatchRun *const runs, const u32 runCount)
+{
+	u8 *const buf = (u8*)malloc(PATCH_CACHE_BUF_SIZE);
+	if(buf == NULL) return RES_OUT_OF_MEM;
+
+	Result res = RES_OK;
+	u32 bufPos = 0, bufFill = 0;
+	for(u32 i = 0; i < runCount && res == RES_OK; i++)
+	{
+		u8 *dst = (u8*)(LGY_ROM_LOC + runs[i].offset);
+		u32 size = runs[i].size;
+		while(size > 0)
+		{
+			if(bufPos == bufFill)
+			{
+				// Big runs go straight to the ROM.
+				if(size >= PATCH_CACHE_BUF_SIZE)
+				{
+					res = readExact(f, dst, size);
+					break;
+				}
+
+				res = fRead(f, buf, PATCH_CACHE_BUF_SIZE, &bufFill);
+				if(res == RES_OK && bufFill == 0) res = RES_FR_DISK_ERR;
+				if(res != RES_OK) break;
+				bufPos = 0;
+			}
+
+			const u32 copySize = (size < bufFill - bufPos ? size : bufFill - bufPos);
+			memcpy(dst, buf + bufPos, copySize);
+			bufPos += copySize;
+			dst    += copySize;
+			size   -= copySize;
+		}
+	}
+
+	free(buf);
+
+	return res;
+}
+
+Result patchCacheLoad(const RomCacheKey *const key, const u64 baseSha1, u32 *const romSize)
+{
+	char path[32];
+	makeCachePath(path, key->pathHash);
+
+	FHandle f;
+	if(fOpen(&f, path, FA_OPEN_EXISTING | FA_READ) != RES_OK) return RES_NOT_FOUND;
+
+	Result res = RES_NOT_FOUND;
+	PatchRun *runs = NULL;
+	do
+	{
+		// Verify everything before touching the ROM.
+		PatchCacheHeader hdr;
+		if(readExact(f, &hdr, sizeof(hdr)) != RES_OK) break;
+		if(!isHeaderValid(&hdr, key, baseSha1, fSize(f))) break;
+
+		runs = (PatchRun*)malloc(hdr.runCount * sizeof(PatchRun) + 1); // + 1 for 0 runs.
+		if(runs == NULL) break;
+		if(readExact(f, runs, hdr.runCount * sizeof(PatchRun)) != RES_OK) break;
+		if(!areRunsValid(runs, hdr.runCount, hdr.dataSize)) break;
+
+		// Same order as patching. The fill comes before the patch data.
+		memset((void*)(LGY_ROM_LOC + hdr.fillStart), 0xFF, hdr.fillEnd - hdr.fillStart);
+		res = applyRuns(f, runs, hdr.runCount);
+		if(res == RES_OK) *romSize = hdr.romSize;
+	} while(0);
+
+	free(runs);
+	fClose(f);
+
+	debug_printf("Patch cache %s.\n", (res == RES_OK ? "hit" : "miss"));
+
+	return res;
+}
+
+static Result writeRuns(const FHandle f, const PatchRun *const runs, const u32 runCount)
+{
+	u8 *const buf = (u8*)malloc(PATCH_CACHE_BUF_SIZE);
+	if(buf == NULL) return RES_OUT_OF_MEM;
+
+	Result res = RES_OK;
+	u32 bufFill = 0;
+	for(u32 i = 0; i < runCount && res == RES_OK; i++)
+	{
+		const u8 *const src = (const u8*)(LGY_ROM_LOC + runs[i].offset);
+		const u32 size = runs[i].size;
+		if(bufFill + size > PATCH_CACHE_BUF_SIZE)
+		{
+			res = writeExact(f, buf, bufFill);
+			bufFill = 0;
+			if(res != RES_OK) break;
+		}
+
+		// Big runs go straight to the file.
+		if(size >= PATCH_CACHE_BUF_SIZE) res = writeExact(f, src, size);
+		else
+		{
+			memcpy(buf + bufFill, src, size);
+			bufFill += size;
+		}
+	}
+	if(res == RES_OK && bufFill > 0) res = writeExact(f, buf, bufFill);
+
+	free(buf);
+
+	return res;
+}
+
+Result patchCacheStore(const RomCacheKey *const key, const u64 baseSha1, const u32 romSize, const PatchDelta *const delta)
+{
+	if(delta->overflow) return RES_OUT_OF_MEM;
+
+	Result res = fMkdir(PATCH_CACHE_DIR);
+	if(res != RES_OK && res != RES_FR_EXIST) return res;
+
+	PatchCacheHeader hdr;
+	hdr.magic     = PATCH_CACHE_MAGIC;
+	hdr.version   = PATCH_CACHE_VERSION;
+	hdr.reserved  = 0;
+	hdr.baseSha1  = baseSha1;
+	memcpy(&hdr.key, key, sizeof(RomCacheKey));
+	hdr.romSize   = romSize;
+	hdr.fillStart = delta->fillStart;
+	hdr.fillEnd   = delta->fillEnd;
+	hdr.runCount  = delta->count;
+	u32 dataSize = 0;
+	for(u32 i = 0; i < delta->count; i++) dataSize += delta->runs[i].size;
+	hdr.dataSize  = dataSize;
+
+	char path[32];
+	makeCachePath(path, key->pathHash);
+
+	FHandle f;
+	res = fOpen(&f, path, FA_CREATE_ALWAYS | FA_WRITE);
+	if(res != RES_OK) return res;
+
+	res = writeExact(f, &hdr, sizeof(hdr));
+	if(res == RES_OK) res = writeExact(f, delta->runs, delta->count * sizeof(PatchRun));
+	if(res == RES_OK) res = writeRuns(f, delta->runs, delta->count);
+	fClose(f);
+
+	// Don't leave broken files behind.
+	if(res != RES_OK) fUnlink(path);
+
+	return res;
+}
@@ -0,0 +1,181 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "types.h"
+#include "arm11/patch_stream.h"
+#include "oaf_error_codes.h"
+#include "arm11/crc32.h"
+#include "kernel.h"
+#include "kevent.h"
+
+
+static KHandle g_streamDataEvent = 0; // Signaled by the reader after each chunk and on exit.
+static KHandle g_streamFreeEvent = 0; // Signaled when a chunk is released or on abort.
+
+
+
+static void patchStreamTask(void *args)
+{
+	PatchStream *const s = (PatchStream*)args;
+
+	Result res = RES_OK;
+	const u32 size = s->size;
+	for(u32 i = 0; i * PATCH_STREAM_CHUNK_SIZE < size; i++)
+	{
+		// Wait for a free chunk.
+		while(i - s->chunksReleased >= PATCH_STREAM_CHUNKS && !s->abort)
+		{
+			waitForEvent(g_streamFreeEvent);
+			clearEvent(g_streamFreeEvent);
+		}
+		if(s->abort) break;
+
+		const u32 offset = i * PATCH_STREAM_CHUNK_SIZE;
+		const u32 chunkSize = (size - offset < PATCH_STREAM_CHUNK_SIZE ? size - offset : PATCH_STREAM_CHUNK_SIZE);
+		u32 read;
+		res = fRead(s->f, s->buf + (i % PATCH_STREAM_CHUNKS) * PATCH_STREAM_CHUNK_SIZE, chunkSize, &read);
+		if(res == RES_OK && read != chunkSize) res = RES_FR_DISK_ERR;
+		if(res != RES_OK) break;
+
+		s->chunksFilled = i + 1;
+		signalEvent(g_streamDataEvent, false);
+	}
+
+	// Note: s is owned by the consumer again after setting done.
+	s->res = res;
+	s->done = true;
+	signalEvent(g_streamDataEvent, false);
+
+	taskExit();
+}
+
+Result patchStreamStart(PatchStream *const s, const FHandle f, const u32 crcEnd)
+{
+	memset(s, 0, sizeof(PatchStream));
+	s->size   = fSize(f);
+	s->crcEnd = crcEnd;
+	s->f      = f;
+
+	Result res = fLseek(f, 0);
+	if(res != RES_OK) return res;
+
+	s->buf = (u8*)malloc(PATCH_STREAM_CHUNKS * PATCH_STREAM_CHUNK_SIZE);
+	if(s->buf == NULL) return RES_OUT_OF_MEM;
+
+	if(g_streamDataEvent == 0) g_streamDataEvent = createEvent(false);
+	if(g_streamFreeEvent == 0) g_streamFreeEvent = createEvent(false);
+	clearEvent(g_streamDataEvent);
+	clearEvent(g_streamFreeEvent);
+	createTask(0x800, 3, patchStreamTask, s);
+
+	return RES_OK;
+}
+
+Result patchStreamNextChunk(PatchStream *const s)
+{
+	// Give the current chunk back to the reader.
+	const u32 idx = s->nextChunk;
+	if(idx > 0)
+	{
+		s->chunksReleased = idx;
+		signalEvent(g_streamFreeEvent, false);
+	}
+	if(s->endOffset >= s->size) return RES_INVALID_PATCH;
+
+	while(1)
+	{
+		const bool done = s->done; // Must be read before chunksFilled.
+		if(s->chunksFilled > idx) break;
+		if(done) return (s->res != RES_OK ? s->res : RES_INVALID_PATCH);
+
+		waitForEvent(g_streamDataEvent);
+		clearEvent(g_streamDataEvent);
+	}
+
+	const u32 offset = s->endOffset;
+	const u32 chunkSize = (s->size - offset < PATCH_STREAM_CHUNK_SIZE ? s->size - offset : PATCH_STREAM_CHUNK_SIZE);
+	const u8 *const chunk = s->buf + (idx % PATCH_STREAM_CHUNKS) * PATCH_STREAM_CHUNK_SIZE;
+	s->ptr       = chunk;
+	s->end       = chunk + chunkSize;
+	s->endOffset = offset + chunkSize;
+	s->nextChunk = idx + 1;
+
+	// Hash while the reader waits for the SD card.
+	if(offset < s->crcEnd)
+		s->crc = crc32Update(s->crc, chunk, (s->crcEnd - offset < chunkSize ? s->crcEnd - offset : chunkSize));
+
+	return RES_OK;
+}
+
+Result patchStreamRead(PatchStream *const s, void *dst, u32 size)
+{
+	u8 *dst8 = (u8*)dst;
+	while(size > 0)
+	{
+		if(s->ptr == s->end)
+		{
+			const Result res = patchStreamNextChunk(s);
+			if(res != RES_OK) return res;
+		}
+
+		const u32 copySize = (size < patchStreamAvail(s) ? size : patchStreamAvail(s));
+		memcpy(dst8, s->ptr, copySize);
+		s->ptr += copySize;
+		dst8   += copySize;
+		size   -= copySize;
+	}
+
+	return RES_OK;
+}
+
+Result patchStreamSkip(PatchStream *const s, u32 size)
+{
+	while(size > 0)
+	{
+		if(s->ptr == s->end)
+		{
+			const Result res = patchStreamNextChunk(s);
+			if(res != RES_OK) return res;
+		}
+
+		const u32 skipSize = (size < patchStreamAvail(s) ? size : patchStreamAvail(s));
+		s->ptr += skipSize;
+		size   -= skipSize;
+	}
+
+	return RES_OK;
+}
+
+void patchStreamEnd(PatchStream *const s)
+{
+	if(s->buf == NULL) return;
+
+	// Stop the reader and wait until it no longer touches s.
+	s->abort = true;
+	signalEvent(g_streamFreeEvent, false);
+	while(!s->done)
+	{
+		waitForEvent(g_streamDataEvent);
+		clearEvent(g_streamDataEvent);
+	}
+
+	free(s->buf);
+	s->buf = NULL;
+}
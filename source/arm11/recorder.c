@@ -0,0 +1,331 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include "types.h"
+#include "arm11/recorder.h"
+#include "arm11/config.h"
+#include "arm11/drivers/gx.h"
+#include "drivers/gfx.h"
+#include "drivers/cache.h"
+#include "arm11/drivers/mcu.h"
+#include "arm11/fmt.h"
+#include "oaf_error_codes.h"
+#include "fs.h"
+#include "kernel.h"
+#include "kevent.h"
+
+
+#define RECORD_KEY_INTERVAL  (600u)    // About every 10 seconds.
+#define RECORD_MAX_RUN       (0x4000u)
+
+
+typedef struct
+{
+	volatile bool recording;
+	volatile bool stopRequested;
+	volatile bool encoderDone;
+	volatile bool active;
+	u16 w;
+	u16 h;
+	u32 pendingDrops;          // Only used by recorderAddFrame().
+	volatile u32 frameHead;    // Only written by recorderAddFrame().
+	volatile u32 frameTail;    // Only written by recEncodeTask().
+	u16 frameDropped[RECORD_FRAMES];
+	volatile u32 ringHead;     // Only written by recEncodeTask().
+	volatile u32 ringTail;     // Only written by recWriteTask().
+	KHandle frameEvent;
+	KHandle dataEvent;
+	char path[48];
+	RecorderStats stats;
+} Recorder;
+
+static Recorder g_rec = {0};
+
+
+
+static u16* framePixels(const u32 idx)
+{
+	return (u16*)(RECORD_FRAME_ADDR + RECORD_FRAME_SIZE * (idx % RECORD_FRAMES));
+}
+
+// Encodes cur as ops against ref. Returns the payload size in bytes.
+// Literals end as soon as a skip of 2 or fill of 3 pixels is possible so the
+// output never exceeds 2.5 bytes per pixel.
+static u32 encodeFrame(u16 *const out, const u16 *const cur, const u16 *const ref, const u32 n)
+{
+	u16 *o = out;
+	u32 i = 0;
+	while(i < n)
+	{
+		const u32 max = (n - i < RECORD_MAX_RUN ? n - i : RECORD_MAX_RUN);
+		const u16 px = cur[i];
+		u32 cnt = 1;
+		if(px == ref[i])
+		{
+			while(cnt < max && cur[i + cnt] == ref[i + cnt]) cnt++;
+			*o++ = RECORD_OP_SKIP | (cnt - 1);
+		}
+		else if(max >= 3 && cur[i + 1] == px && cur[i + 2] == px)
+		{
+			cnt = 3;
+			while(cnt < max && cur[i + cnt] == px) cnt++;
+			*o++ = RECORD_OP_FILL | (cnt - 1);
+			*o++ = px;
+		}
+		else
+		{
+			while(cnt < max)
+			{
+				const u32 j = i + cnt;
+				if(cur[j] == ref[j] && (j + 1 == n || cur[j + 1] == ref[j + 1])) break;
+				if(j + 2 < n && cur[j + 1] == cur[j] && cur[j + 2] == cur[j]) break;
+				cnt++;
+			}
+			*o++ = RECORD_OP_LITERAL | (cnt - 1);
+			memcpy(o, &cur[i], cnt * 2);
+			o += cnt;
+		}
+		i += cnt;
+	}
+
+	return (u32)(o - out) * 2;
+}
+
+static void ringPut(Recorder *const r, const void *const data, const u32 size)
+{
+	u8 *const ring = (u8*)RECORD_RING_ADDR;
+	const u32 off   = r->ringHead % RECORD_RING_SIZE;
+	const u32 first = (size < RECORD_RING_SIZE - off ? size : RECORD_RING_SIZE - off);
+	memcpy(ring + off, data, first);
+	memcpy(ring, (const u8*)data + first, size - first);
+
+	const u32 head = r->ringHead + size;
+	r->ringHead = head;
+	if(head - r->ringTail > r->stats.maxRing) r->stats.maxRing = head - r->ringTail;
+}
+
+static void encodeQueuedFrame(Recorder *const r, const u32 idx)
+{
+	const u32 n = r->w * r->h;
+	const u16 *const cur = framePixels(idx);
+	u16 *const ref = framePixels(idx - 1);
+	invalidateDCacheRange(cur, n * 2);
+
+	// Key frames are coded against black. The reference frame isn't needed anymore.
+	RecFrameHeader hdr;
+	hdr.flags   = 0;
+	hdr.dropped = r->frameDropped[idx % RECORD_FRAMES];
+	if(r->stats.frames % RECORD_KEY_INTERVAL == 0)
+	{
+		memset(ref, 0, n * 2);
+		cleanDCacheRange(ref, n * 2); // PPF writes this frame later.
+		hdr.flags = RECORD_FLAG_KEY;
+	}
+
+	// Encode a few lines at a time to not delay the display path.
+	u8 *const stage = (u8*)RECORD_STAGE_ADDR;
+	u32 size = 0;
+	for(u32 y = 0; y < r->h; y += 16)
+	{
+		const u32 lines = (r->h - y < 16 ? r->h - y : 16);
+		const u32 start = y * r->w;
+		size += encodeFrame((u16*)(stage + size), cur + start, ref + start, lines * r->w);
+
+		// Only use idle time.
+		yieldTask();
+	}
+	hdr.size = size;
+
+	// Wait for the write task if the ring is full. New frames are dropped meanwhile.
+	while(RECORD_RING_SIZE - (r->ringHead - r->ringTail) < sizeof(hdr) + size) yieldTask();
+	ringPut(r, &hdr, sizeof(hdr));
+	ringPut(r, stage, size);
+	r->stats.frames++;
+}
+
+static void recEncodeTask(UNUSED void *args)
+{
+	Recorder *const r = &g_rec;
+	while(1)
+	{
+		if(waitForEvent(r->frameEvent) != KRES_OK) break;
+		clearEvent(r->frameEvent);
+
+		u32 tail = r->frameTail;
+		while(tail != r->frameHead)
+		{
+			encodeQueuedFrame(r, tail);
+			r->frameTail = ++tail;
+			signalEvent(r->dataEvent, false);
+		}
+
+		// recorderAddFrame() doesn't queue frames after a stop request.
+		if(r->stopRequested && r->frameTail == r->frameHead) break;
+	}
+
+	r->encoderDone = true;
+	signalEvent(r->dataEvent, false);
+
+	taskExit();
+}
+
+static void recWriteTask(UNUSED void *args)
+{
+	Recorder *const r = &g_rec;
+	FHandle f;
+	Result res = fOpen(&f, r->path, FA_CREATE_ALWAYS | FA_WRITE);
+	const bool opened = (res == RES_OK);
+	if(!opened) recorderStop(); // Data is still consumed below so the encoder can finish.
+
+	const u8 *const ring = (const u8*)RECORD_RING_ADDR;
+	while(1)
+	{
+		// Only write big sequential pieces unless we are done.
+		const bool done = r->encoderDone;
+		const u32 avail = r->ringHead - r->ringTail;
+		if(avail >= RECORD_WRITE_SIZE || (done && avail > 0))
+		{
+			const u32 off = r->ringTail % RECORD_RING_SIZE;
+			u32 size = (avail < RECORD_WRITE_SIZE ? avail : RECORD_WRITE_SIZE);
+			size = (size < RECORD_RING_SIZE - off ? size : RECORD_RING_SIZE - off);
+			// Split the piece so a single call never blocks for long.
+			for(u32 pos = 0; pos < size && res == RES_OK; pos += RECORD_WRITE_CHUNK)
+			{
+				const u32 chunk = (size - pos < RECORD_WRITE_CHUNK ? size - pos : RECORD_WRITE_CHUNK);
+				u32 written;
+				res = fWrite(f, ring + off + pos, chunk, &written);
+				if(res != RES_OK) recorderStop();
+				yieldTask();
+			}
+			r->ringTail += size;
+			r->stats.bytes += size;
+			continue;
+		}
+		if(done) break;
+
+		if(waitForEvent(r->dataEvent) != KRES_OK) break;
+		clearEvent(r->dataEvent);
+	}
+
+	if(res != RES_OK) debug_printf("Recording failed: %s\n", result2String(res));
+	if(opened) fClose(f);
+	r->active = false;
+
+	taskExit();
+}
+
+void recorderStart(const u16 w, const u16 h)
+{
+	Recorder *const r = &g_rec;
+	if(r->active) return;
+
+	// The events are reused for all recordings.
+	if(r->frameEvent == 0)
+	{
+		r->frameEvent = createEvent(false);
+		r->dataEvent  = createEvent(false);
+	}
+	clearEvent(r->frameEvent);
+	clearEvent(r->dataEvent);
+
+	r->stopRequested = false;
+	r->encoderDone   = false;
+	r->w             = w;
+	r->h             = h;
+	r->pendingDrops  = 0;
+	r->frameHead     = 0;
+	r->frameTail     = 0;
+	r->ringHead      = 0;
+	r->ringTail      = 0;
+	memset(&r->stats, 0, sizeof(r->stats));
+
+	// Construct file path from date & time.
+	RtcTimeDate td;
+	MCU_getRtcTimeDate(&td);
+	ee_sprintf(r->path, OAF_RECORDING_DIR "/%04X_%02X_%02X_%02X_%02X_%02X.oafr",
+	           td.year + 0x2000, td.mon, td.day, td.hour, td.min, td.sec);
+
+	const RecFileHeader fileHdr = {{'O', 'A', 'F', 'R'}, 1, w, h, 0};
+	ringPut(r, &fileHdr, sizeof(fileHdr));
+
+	r->active    = true;
+	r->recording = true;
+	// Below the display tasks (priority 3) so they always preempt encoding and writing.
+	createTask(0x800, 2, recEncodeTask, NULL);
+	createTask(0x800, 2, recWriteTask, NULL);
+}
+
+void recorderStop(void)
+{
+	Recorder *const r = &g_rec;
+	if(!r->recording) return;
+
+	r->recording     = false;
+	r->stopRequested = true;
+	signalEvent(r->frameEvent, false);
+}
+
+bool recorderIsActive(void)
+{
+	return g_rec.active;
+}
+
+void recorderAddFrame(const u32 *const tex)
+{
+	Recorder *const r = &g_rec;
+	if(!r->recording) return;
+
+	// Drop the frame if the encoder is behind. One frame is the delta reference.
+	const u32 head = r->frameHead;
+	if(head - r->frameTail >= RECORD_FRAMES - 1)
+	{
+		r->pendingDrops++;
+		r->stats.dropped++;
+		return;
+	}
+	r->frameDropped[head % RECORD_FRAMES] = (r->pendingDrops < 0xFFFFu ? r->pendingDrops : 0xFFFFu);
+	r->pendingDrops = 0;
+
+	GX_displayTransfer(tex, PPF_DIM(512, r->h), (u32*)framePixels(head), PPF_DIM(r->w, r->h),
+	                   PPF_O_FMT(GX_A1BGR5) | PPF_I_FMT(GX_A1BGR5) | PPF_CROP_EN);
+	GFX_waitForPPF();
+
+	r->frameHead = head + 1;
+	signalEvent(r->frameEvent, false);
+}
+
+void recorderGetStats(RecorderStats *const stats)
+{
+	*stats = g_rec.stats;
+}
+
+void recorderExit(void)
+{
+	Recorder *const r = &g_rec;
+	recorderStop();
+	while(r->active) yieldTask();
+
+	if(r->frameEvent != 0)
+	{
+		deleteEvent(r->frameEvent);
+		deleteEvent(r->dataEvent);
+		r->frameEvent = 0;
+		r->dataEvent  = 0;
+	}
+}
@@ -0,0 +1,172 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "types.h"
+#include "arm11/rom_cache.h"
+#include "fs.h"
+#include "fsutil.h"
+#include "util.h"
+#include "arm11/fmt.h"
+
+
+#define ROM_CACHE_MAGIC    (0x4346414Fu) // "OAFC"
+#define ROM_CACHE_VERSION  (1u)
+#define ROM_CACHE_ENTRIES  (64u)
+
+
+typedef struct
+{
+	u32 magic;
+	u16 version;
+	u16 next;    // Entry to replace next.
+	RomCacheEntry entries[ROM_CACHE_ENTRIES];
+} RomCache;
+
+
+
+static u32 hashPath(const char *path)
+{
+	// 32 bit FNV-1a.
+	u32 hash = 2166136261u;
+	while(*path != '\0')
+	{
+		hash ^= (u8)*path++;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+static void getPatchFileInfo(const char *const romPath, RomCacheKey *const key)
+{
+	key->patchSize = 0;
+	key->patchTime = 0;
+
+	char *const patchPath = (char*)malloc(512);
+	if(patchPath == NULL) return;
+
+	// Same lookup order as patchRom().
+	// The hash is over the unpatched ROM but we still want
+	// to start from scratch if a patch is added, changed or removed.
+	static const char *const patchExts[] = {"ips", "ups", "bps"};
+	const u32 extOffset = strlen(romPath) - 3;
+	for(u32 i = 0; i < sizeof(patchExts) / sizeof(*patchExts); i++)
+	{
+		safeStrcpy(patchPath, romPath, 512);
+		strcpy(patchPath + extOffset, patchExts[i]);
+
+		FILINFO fi;
+		if(fStat(patchPath, &fi) == RES_OK)
+		{
+			key->patchSize = (u32)fi.fsize;
+			key->patchTime = (u32)fi.fdate<<16 | fi.ftime;
+			break;
+		}
+	}
+
+	free(patchPath);
+}
+
+Result romCacheMakeKey(const char *const romPath, RomCacheKey *const key)
+{
+	if(strlen(romPath) < 4 || strlen(romPath) > 511) return RES_INVALID_ARG;
+
+	FILINFO fi;
+	const Result res = fStat(romPath, &fi);
+	if(res != RES_OK) return res;
+
+	key->pathHash = hashPath(romPath);
+	key->fileSize = (u32)fi.fsize;
+	key->fileTime = (u32)fi.fdate<<16 | fi.ftime;
+	getPatchFileInfo(romPath, key);
+
+	return RES_OK;
+}
+
+static RomCache* loadCache(void)
+{
+	RomCache *const cache = (RomCache*)malloc(sizeof(RomCache));
+	if(cache == NULL) return NULL;
+
+	// Start with an empty cache if the file is missing or outdated.
+	const Result res = fsQuickRead(ROM_CACHE_PATH, cache, sizeof(RomCache));
+	if(res != RES_OK || cache->magic != ROM_CACHE_MAGIC || cache->version != ROM_CACHE_VERSION
+	   || cache->next >= ROM_CACHE_ENTRIES)
+	{
+		memset(cache, 0, sizeof(RomCache));
+		cache->magic   = ROM_CACHE_MAGIC;
+		cache->version = ROM_CACHE_VERSION;
+	}
+
+	return cache;
+}
+
+static s32 findEntry(const RomCache *const cache, const u32 pathHash)
+{
+	for(u32 i = 0; i < ROM_CACHE_ENTRIES; i++)
+	{
+		// A size of 0 marks unused entries. Empty ROMs are never cached.
+		const RomCacheEntry *const entry = &cache->entries[i];
+		if(entry->key.fileSize != 0 && entry->key.pathHash == pathHash) return i;
+	}
+
+	return -1;
+}
+
+bool romCacheLookup(const RomCacheKey *const key, RomCacheEntry *const entry)
+{
+	RomCache *const cache = loadCache();
+	if(cache == NULL) return false;
+
+	bool hit = false;
+	const s32 idx = findEntry(cache, key->pathHash);
+	if(idx >= 0 && memcmp(&cache->entries[idx].key, key, sizeof(RomCacheKey)) == 0)
+	{
+		memcpy(entry, &cache->entries[idx], sizeof(RomCacheEntry));
+		hit = true;
+	}
+	free(cache);
+
+	debug_printf("ROM cache %s.\n", (hit ? "hit" : "miss"));
+
+	return hit;
+}
+
+Result romCacheStore(const RomCacheEntry *const entry)
+{
+	if(entry->key.fileSize == 0) return RES_INVALID_ARG;
+
+	RomCache *const cache = loadCache();
+	if(cache == NULL) return RES_OUT_OF_MEM;
+
+	// Overwrite the stale entry for this path or the oldest one.
+	s32 idx = findEntry(cache, entry->key.pathHash);
+	if(idx < 0)
+	{
+		idx = cache->next;
+		cache->next = (idx + 1) % ROM_CACHE_ENTRIES;
+	}
+	memcpy(&cache->entries[idx], entry, sizeof(RomCacheEntry));
+
+	const Result res = fsQuickWrite(ROM_CACHE_PATH, cache, sizeof(RomCache));
+	free(cache);
+
+	return res;
+}
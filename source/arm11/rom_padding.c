@@ -0,0 +1,143 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include "types.h"
+#include "arm11/rom_padding.h"
+#include "util.h"
+#include "arm11/fast_rom_padding.h"
+#include "drivers/lgy_common.h"
+#include "arm11/drivers/gx.h"
+#include "drivers/gfx.h"
+#include "drivers/cache.h"
+#include "kernel.h"
+#include "kevent.h"
+
+
+#define OPEN_BUS_PERIOD  (0x20000u)                // The open bus pattern repeats every 128 KiB.
+#define PPF_LINEAR_DIM   (PPF_DIM(0x10000 / 16, 0)) // 64 KiB lines without gaps.
+
+
+typedef struct
+{
+	u32 fillStart;    // Start of the hardware 0xFF fill.
+	u32 romSize;
+	u32 mirroredSize;
+} RomPadding;
+
+static RomPadding g_romPadding;
+static KHandle g_paddingDoneEvent = 0;
+static bool g_paddingBusy = false;
+
+
+
+static void ppfCopy(const uintptr_t src, const uintptr_t dst, const u32 size)
+{
+	GX_textureCopy((u32*)src, PPF_LINEAR_DIM, (u32*)dst, PPF_LINEAR_DIM, size);
+	GFX_waitForPPF();
+}
+
+static void romPaddingTask(void *args)
+{
+	const RomPadding *const pad = (RomPadding*)args;
+	const uintptr_t romLoc = LGY_ROM_LOC;
+
+	// Pad unused ROM area with 0xFFs. Both fill units take one half.
+	const u32 fillStart = pad->fillStart;
+	const u32 romSize = pad->romSize;
+	if(fillStart < romSize)
+	{
+		const u32 half = ((romSize - fillStart) / 2) & ~15u;
+		GX_memoryFill((u32*)(romLoc + fillStart), PSC_FILL_32_BITS, half, 0xFFFFFFFF,
+		              (u32*)(romLoc + fillStart + half), PSC_FILL_32_BITS, romSize - fillStart - half, 0xFFFFFFFF);
+		GFX_waitForPSC0();
+		GFX_waitForPSC1();
+	}
+
+	// ROM mirroring for Classic NES Series/others with 8 Mbit ROM.
+	// The ROM is mirrored exactly 4 times.
+	// Thanks to endrift for discovering this.
+	const u32 mirroredSize = pad->mirroredSize;
+	if(romSize == 0x100000) // 1 MiB.
+	{
+		ppfCopy(romLoc, romLoc + romSize, romSize);
+		ppfCopy(romLoc, romLoc + romSize * 2, romSize * 2);
+	}
+
+	// Fake "open bus" padding. The CPU made the last period.
+	// Double the finished part until we reach the mirrored ROM end.
+	const uintptr_t romEnd = romLoc + LGY_MAX_ROM_SIZE;
+	const u32 openBusSize = LGY_MAX_ROM_SIZE - mirroredSize;
+	u32 finished = OPEN_BUS_PERIOD;
+	while(finished < openBusSize)
+	{
+		const u32 size = (openBusSize - finished < finished ? openBusSize - finished : finished);
+		ppfCopy(romEnd - finished, romEnd - finished - size, size);
+		finished += size;
+	}
+
+	signalEvent(g_paddingDoneEvent, false);
+
+	taskExit();
+}
+
+u32 romPaddingStart(const u32 romFileSize)
+{
+	// Smallest retail ROM chip is 8 Mbit (1 MiB).
+	u32 romSize = nextPow2(romFileSize);
+	romSize = (romSize < 0x100000 ? 0x100000 : romSize);
+	const u32 mirroredSize = (romSize == 0x100000 ? 0x400000 : romSize);
+
+	// The CPU pads the first bytes after the ROM. This aligns the
+	// hardware fill and everything reading a bit past the ROM end
+	// (save string scan, SHA tail) never touches the engine written area.
+	u32 fillStart = (romFileSize + ROM_PADDING_CPU_BYTES + 63) & ~63u;
+	fillStart = (fillStart > romSize ? romSize : fillStart);
+	const uintptr_t romLoc = LGY_ROM_LOC;
+	memset((void*)(romLoc + romFileSize), 0xFF, fillStart - romFileSize);
+
+	// The open bus pattern only depends on the address.
+	// Make the last period and let the engines copy it.
+	if(mirroredSize < LGY_MAX_ROM_SIZE)
+		makeOpenBusPaddingFast((u32*)(romLoc + LGY_MAX_ROM_SIZE - OPEN_BUS_PERIOD));
+
+	// Write back everything the engines read. This also evicts any
+	// cache lines of the padding area so later CPU writes can't
+	// overwrite engine results with stale data.
+	flushDCache();
+
+	g_romPadding.fillStart    = fillStart;
+	g_romPadding.romSize      = romSize;
+	g_romPadding.mirroredSize = mirroredSize;
+	if(g_paddingDoneEvent == 0) g_paddingDoneEvent = createEvent(false);
+	clearEvent(g_paddingDoneEvent);
+	g_paddingBusy = true;
+	createTask(0x800, 3, romPaddingTask, &g_romPadding);
+
+	// We don't return the mirrored size because the db hashes are over unmirrored dumps.
+	return romSize;
+}
+
+void romPaddingWait(void)
+{
+	if(!g_paddingBusy) return;
+
+	waitForEvent(g_paddingDoneEvent);
+	clearEvent(g_paddingDoneEvent);
+	g_paddingBusy = false;
+}
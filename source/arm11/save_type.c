@@ -19,10 +19,10 @@
 #include <string.h>
 #include "types.h"
 #include "arm11/save_type.h"
+#include "arm11/fast_save_scan.h"
 #include "drivers/lgy_common.h"
 #include "arm11/fmt.h"
 #include "fs.h"
-#include "drivers/sha.h"
 #include "oaf_error_codes.h"
 #include "arm11/console.h"
 #include "drivers/gfx.h"
@@ -45,104 +45,163 @@ static u16 checkSaveOverride(const u32 gameCode) // Save type overrides for mode
 	return 0xFF;
 }
 
-u16 detectSaveType(const u32 romSize, const u16 defaultSave)
+void saveTypeScanInit(SaveTypeScan *const scan)
 {
-	const u32 *romPtr = (u32*)LGY_ROM_LOC;
-	u16 saveType = checkSaveOverride(romPtr[0xAC / 4]);
-	if(saveType != 0xFF)
+	scan->offset   = 0xE4; // Skip headers.
+	scan->saveType = 0xFF;
+}
+
+// SDK save string matcher. The first 4 chars are found by findSaveStringFast().
+// The rest is matched in 2 steps: Prefix + stem and then the last digit.
+// Stems are sorted by length (longest first) per prefix.
+// None of the stems is a prefix of another so at most one can match.
+typedef struct
+{
+	u32 prefix;       // First 4 chars as little endian word.
+	char stem[9];     // The chars after the prefix without the last digit.
+	u8 stemLen;
+	u8 saveTypes[10]; // Indexed by the last digit. 0xFF = unknown version.
+} SaveStringStem;
+
+#define E8   SAVE_TYPE_EEPROM_8k
+#define E64  SAVE_TYPE_EEPROM_64k
+#define F512 SAVE_TYPE_FLASH_512k_PSC_RTC
+#define F1M  SAVE_TYPE_FLASH_1m_MRX_RTC
+#define SRAM SAVE_TYPE_SRAM_256k
+#define UNK  0xFF
+static const SaveStringStem g_saveStringStems[7] =
+{
+	// EEPROM
+	// Assume common sizes for popular games to aid ROM hacks.
+	{0x52504545u, "OM_V12", 6, {E8, E64, E8, UNK, E64, E8, E8, UNK, UNK, UNK}},   // EEPROM_V12x
+	{0x52504545u, "OM_V11", 6, {UNK, E8, UNK, UNK, UNK, UNK, UNK, UNK, UNK, UNK}}, // EEPROM_V11x
+
+	// FLASH
+	// Assume they all have RTC.
+	{0x53414C46u, "H512_V13", 8, {F512, F512, UNK, F512, UNK, UNK, UNK, UNK, UNK, UNK}},   // FLASH512_V13x
+	{0x53414C46u, "H1M_V10",  7, {UNK, UNK, F1M, F1M, UNK, UNK, UNK, UNK, UNK, UNK}},      // FLASH1M_V10x
+	{0x53414C46u, "H_V12",    5, {F512, F512, UNK, F512, F512, F512, F512, UNK, UNK, UNK}}, // FLASH_V12x
+
+	// FRAM & SRAM
+	{0x4D415253u, "_F_V10", 6, {SRAM, UNK, SRAM, SRAM, UNK, UNK, UNK, UNK, UNK, UNK}}, // SRAM_F_V10x
+	{0x4D415253u, "_V11",   4, {SRAM, SRAM, SRAM, SRAM, UNK, UNK, UNK, UNK, UNK, UNK}} // SRAM_V11x
+};
+#undef E8
+#undef E64
+#undef F512
+#undef F1M
+#undef SRAM
+#undef UNK
+
+static u16 matchSaveString(const u32 *const romPtr)
+{
+	const u32 prefix = *romPtr;
+	const char *const rest = (const char*)(romPtr + 1);
+	for(u32 i = 0; i < 7; i++)
 	{
-		debug_printf("Serial in override list.\n"
-		             "saveType: %u\n", saveType);
+		const SaveStringStem *const stem = &g_saveStringStems[i];
+		if(stem->prefix != prefix || memcmp(rest, stem->stem, stem->stemLen) != 0) continue;
+
+		const u32 digit = (u32)(rest[stem->stemLen] - '0');
+		const u16 saveType = (digit < 10 ? stem->saveTypes[digit] : 0xFF);
+#ifndef NDEBUG
+		if(saveType != 0xFF)
+		{
+			char str[16];
+			const u32 len = 4 + stem->stemLen + 1;
+			memcpy(str, romPtr, len);
+			str[len] = '\0';
+			debug_printf("SDK save string: %s\n", str);
+		}
+#endif
+
 		return saveType;
 	}
 
+	return 0xFF;
+}
+
+// Scans all aligned words from scan->offset up to end for SDK save strings.
+static void scanSaveStrings(SaveTypeScan *const scan, const u32 end)
+{
+	// The first save string found wins.
+	if(scan->saveType != 0xFF || end <= scan->offset) return;
+
 	// Code based on: https://github.com/Gericom/GBARunner2/blob/master/arm9/source/save/Save.vram.cpp
-	romPtr += 0xE4 / 4; // Skip headers.
-	if(defaultSave > SAVE_TYPE_NONE)
-		saveType = SAVE_TYPE_NONE;
-	else
-		saveType = defaultSave;
+	const u32 *romPtr = (u32*)(LGY_ROM_LOC + scan->offset);
+	const u32 *const romEnd = (u32*)(LGY_ROM_LOC + end);
+	while((romPtr = findSaveStringFast(romPtr, romEnd)) < romEnd)
+	{
+		const u16 saveType = matchSaveString(romPtr);
+		if(saveType != 0xFF)
+		{
+			scan->offset   = (uintptr_t)romPtr - LGY_ROM_LOC;
+			scan->saveType = saveType;
+			return;
+		}
 
-	for(; romPtr < (u32*)(LGY_ROM_LOC + romSize); romPtr++)
+		romPtr++;
+	}
+
+	scan->offset = end;
+}
+
+void saveTypeScanUpdate(SaveTypeScan *const scan, const u32 size)
+{
+	// Hold back the last 16 bytes. A save string may continue
+	// in data that has not been loaded yet. The longest one is 13 chars.
+	if(size < 16) return;
+	const u32 end = (size - 16) & ~3u;
+	if(end > scan->offset) scanSaveStrings(scan, end);
+}
+
+void saveTypeScanFinish(SaveTypeScan *const scan, const u32 romSize)
+{
+	scanSaveStrings(scan, romSize);
+	scan->offset = LGY_MAX_ROM_SIZE; // Prevent any further scanning.
+}
+
+void saveTypeScanSetResult(SaveTypeScan *const scan, const u16 saveType)
+{
+	// For results known from previous scans.
+	scan->offset   = LGY_MAX_ROM_SIZE;
+	scan->saveType = saveType;
+}
+
+u16 detectSaveType(SaveTypeScan *const scan, const u32 romSize, const u16 defaultSave)
+{
+	u16 saveType = checkSaveOverride(*(u32*)(LGY_ROM_LOC + 0xAC));
+	if(saveType != 0xFF)
 	{
-		u32 tmp = *romPtr;
+		debug_printf("Serial in override list.\n"
+		             "saveType: %u\n", saveType);
+		return saveType;
+	}
 
-		// "EEPR" "FLAS" "SRAM"
-		if(tmp == 0x52504545u || tmp == 0x53414C46u || tmp == 0x4D415253u)
+	saveTypeScanFinish(scan, romSize);
+	saveType = scan->saveType;
+	if(saveType != 0xFF)
+	{
+		if(saveType == SAVE_TYPE_EEPROM_8k || saveType == SAVE_TYPE_EEPROM_64k)
 		{
-			static const struct
-			{
-				const char *str;
-				u16 saveType;
-			} saveTypeLut[25] =
-			{
-				// EEPROM
-				// Assume common sizes for popular games to aid ROM hacks.
-				{"EEPROM_V111", SAVE_TYPE_EEPROM_8k},
-				{"EEPROM_V120", SAVE_TYPE_EEPROM_8k},
-				{"EEPROM_V121", SAVE_TYPE_EEPROM_64k},
-				{"EEPROM_V122", SAVE_TYPE_EEPROM_8k},
-				{"EEPROM_V124", SAVE_TYPE_EEPROM_64k},
-				{"EEPROM_V125", SAVE_TYPE_EEPROM_8k},
-				{"EEPROM_V126", SAVE_TYPE_EEPROM_8k},
-
-				// FLASH
-				// Assume they all have RTC.
-				{"FLASH_V120",    SAVE_TYPE_FLASH_512k_PSC_RTC},
-				{"FLASH_V121",    SAVE_TYPE_FLASH_512k_PSC_RTC},
-				{"FLASH_V123",    SAVE_TYPE_FLASH_512k_PSC_RTC},
-				{"FLASH_V124",    SAVE_TYPE_FLASH_512k_PSC_RTC},
-				{"FLASH_V125",    SAVE_TYPE_FLASH_512k_PSC_RTC},
-				{"FLASH_V126",    SAVE_TYPE_FLASH_512k_PSC_RTC},
-				{"FLASH512_V130", SAVE_TYPE_FLASH_512k_PSC_RTC},
-				{"FLASH512_V131", SAVE_TYPE_FLASH_512k_PSC_RTC},
-				{"FLASH512_V133", SAVE_TYPE_FLASH_512k_PSC_RTC},
-				{"FLASH1M_V102",  SAVE_TYPE_FLASH_1m_MRX_RTC},
-				{"FLASH1M_V103",  SAVE_TYPE_FLASH_1m_MRX_RTC},
-
-				// FRAM & SRAM
-				{"SRAM_F_V100", SAVE_TYPE_SRAM_256k},
-				{"SRAM_F_V102", SAVE_TYPE_SRAM_256k},
-				{"SRAM_F_V103", SAVE_TYPE_SRAM_256k},
-
-				{"SRAM_V110",   SAVE_TYPE_SRAM_256k},
-				{"SRAM_V111",   SAVE_TYPE_SRAM_256k},
-				{"SRAM_V112",   SAVE_TYPE_SRAM_256k},
-				{"SRAM_V113",   SAVE_TYPE_SRAM_256k}
-			};
-
-			for(u32 i = 0; i < 25; i++)
-			{
-				const char *const str = saveTypeLut[i].str;
-				u16 tmpSaveType = saveTypeLut[i].saveType;
-
-				if(memcmp(romPtr, str, strlen(str)) == 0)
-				{
-					if(tmpSaveType == SAVE_TYPE_EEPROM_8k || tmpSaveType == SAVE_TYPE_EEPROM_64k)
-					{
-						// If ROM bigger than 16 MiB --> SAVE_TYPE_EEPROM_8k_2 or SAVE_TYPE_EEPROM_64k_2.
-						if(romSize > 0x1000000) tmpSaveType++;
-					}
-					debug_printf("SDK save string: %s\n"
-					             "saveType: %u\n", str, tmpSaveType);
-					return tmpSaveType;
-				}
-			}
+			// If ROM bigger than 16 MiB --> SAVE_TYPE_EEPROM_8k_2 or SAVE_TYPE_EEPROM_64k_2.
+			if(romSize > 0x1000000) saveType++;
 		}
 	}
+	else if(defaultSave > SAVE_TYPE_NONE)
+		saveType = SAVE_TYPE_NONE;
+	else
+		saveType = defaultSave;
 
 	debug_printf("saveType: %u\n", saveType);
 	return saveType;
 }
 
 // Search for the entry with first u64 of the SHA1 = x using binary search.
+// Legacy db format without header.
 // Note: Loading the whole db to memory first is still slower.
-static Result searchGbaDb(const u64 x, GbaDbEntry *const db)
+static Result searchGbaDbLegacy(const FHandle f, const u64 x, GbaDbEntry *const db)
 {
-	FHandle f;
-	Result res = fOpen(&f, "gba_db.bin", FA_OPEN_EXISTING | FA_READ);
-	if(res != RES_OK) return res;
-
 	u32 l = 0;
 	u32 r = fSize(f) / sizeof(GbaDbEntry);
 	while(l < r)
@@ -150,18 +209,10 @@ static Result searchGbaDb(const u64 x, GbaDbEntry *const db)
 		const u32 m = l + (r - l) / 2;
 		//debug_printf("l: %" PRIu32 " m: %" PRIu32 " r: %" PRIu32 "\n", l, m, r);
 
-		res = fLseek(f, sizeof(GbaDbEntry) * m);
-		if(res != RES_OK)
-		{
-			fClose(f);
-			return res;
-		}
+		Result res = fLseek(f, sizeof(GbaDbEntry) * m);
+		if(res != RES_OK) return res;
 		res = fRead(f, db, sizeof(GbaDbEntry), NULL);
-		if(res != RES_OK)
-		{
-			fClose(f);
-			return res;
-		}
+		if(res != RES_OK) return res;
 
 		u64 tmp;
 		memcpy(&tmp, db->sha1, 8);
@@ -173,32 +224,91 @@ static Result searchGbaDb(const u64 x, GbaDbEntry *const db)
 		{
 			r = m;
 		}
-		else
+		else return RES_OK;
+	}
+
+	return RES_NOT_FOUND;
+}
+
+// Search for the entry with first u64 of the SHA1 = x.
+// The indexed format only needs the header and one bucket.
+static Result searchGbaDb(const u64 x, GbaDbEntry *const db)
+{
+	FHandle f;
+	Result res = fOpen(&f, "gba_db.bin", FA_OPEN_EXISTING | FA_READ);
+	if(res != RES_OK) return res;
+
+	do
+	{
+		GbaDbHeader header;
+		u32 read;
+		res = fRead(f, &header, sizeof(header), &read);
+		if(res != RES_OK) break;
+		if(read != sizeof(header) || header.magic != GBA_DB_MAGIC || header.version != GBA_DB_VERSION
+		   || header.entrySize != sizeof(GbaDbEntry))
+		{
+			res = searchGbaDbLegacy(f, x, db);
+			break;
+		}
+
+		// Buckets are indexed by the first SHA1 byte. x is little endian.
+		const u8 bucket = (u8)x;
+		u32 idx = (bucket > 0 ? header.fanout[bucket - 1] : 0);
+		const u32 end = header.fanout[bucket];
+		if(end > header.entryCount || idx > end)
 		{
-			fClose(f);
-			return RES_OK;
+			res = RES_NOT_FOUND; // Corrupted header.
+			break;
 		}
-	}
+
+		res = fLseek(f, sizeof(GbaDbHeader) + sizeof(GbaDbEntry) * idx);
+		if(res != RES_OK) break;
+
+		// Buckets are read in one go if they fit (all buckets in the official db do).
+		GbaDbEntry entries[32];
+		res = RES_NOT_FOUND;
+		while(idx < end)
+		{
+			const u32 num = (end - idx < 32 ? end - idx : 32);
+			const Result readRes = fRead(f, entries, sizeof(GbaDbEntry) * num, NULL);
+			if(readRes != RES_OK)
+			{
+				res = readRes;
+				break;
+			}
+
+			for(u32 i = 0; i < num; i++)
+			{
+				u64 tmp;
+				memcpy(&tmp, entries[i].sha1, 8);
+				if(tmp == x)
+				{
+					memcpy(db, &entries[i], sizeof(GbaDbEntry));
+					res = RES_OK;
+					break;
+				}
+			}
+			if(res == RES_OK) break;
+
+			idx += num;
+		}
+	} while(0);
 
 	fClose(f);
 
-	return RES_NOT_FOUND;
+	return res;
 }
 
-u16 getSaveType(const OafConfig *const cfg, const u32 romSize, const char *const savePath)
+u16 getSaveType(const OafConfig *const cfg, const u32 romSize, const u64 sha1, const u16 autoSaveType, const char *const savePath)
 {
 	FILINFO fi;
 	const bool saveOverride = cfg->saveOverride;
-	const u16 autoSaveType = detectSaveType(romSize, cfg->defaultSave);
 	const bool saveExists = fStat(savePath, &fi) == RES_OK;
 
-	u64 sha1[3];
-	sha((u32*)LGY_ROM_LOC, romSize, (u32*)sha1, SHA_IN_BIG | SHA_1_MODE, SHA_OUT_BIG);
-
 	Result res;
 	GbaDbEntry dbEntry;
 	u16 saveType = SAVE_TYPE_NONE;
-	res = searchGbaDb(*sha1, &dbEntry);
+	res = searchGbaDb(sha1, &dbEntry);
 	if(res == RES_OK) saveType = dbEntry.attr & 0xFu;
 	else if(!saveOverride && res == RES_NOT_FOUND) return autoSaveType;
 	else if(res != RES_NOT_FOUND)
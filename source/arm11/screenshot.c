@@ -0,0 +1,287 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include "types.h"
+#include "arm11/screenshot.h"
+#include "arm11/config.h"
+#include "arm11/drivers/gx.h"
+#include "drivers/gfx.h"
+#include "drivers/cache.h"
+#include "arm11/drivers/mcu.h"
+#include "arm11/fmt.h"
+#include "oaf_error_codes.h"
+#include "fs.h"
+#include "kernel.h"
+#include "kevent.h"
+
+
+#define QOI_OP_INDEX  (0x00u)
+#define QOI_OP_DIFF   (0x40u)
+#define QOI_OP_LUMA   (0x80u)
+#define QOI_OP_RUN    (0xC0u)
+#define QOI_OP_RGB    (0xFEu)
+#define QOI_BUF_SIZE  (0x1000u)
+
+
+typedef struct
+{
+	u16 w;
+	u16 h;
+	u8 seq;
+} ScreenshotSlot;
+
+typedef struct
+{
+	FHandle f;
+	u32 pos;
+	Result res;
+	alignas(4) u8 buf[QOI_BUF_SIZE];
+} QoiWriter;
+
+static KHandle g_queuedEvent = 0;
+static ScreenshotSlot g_slots[SCREENSHOT_SLOTS];
+static volatile u32 g_head = 0; // Only written by screenshotQueue().
+static volatile u32 g_tail = 0; // Only written by screenshotTask().
+static RtcTimeDate g_shotTime;  // Shared by all frames of a burst. Only used by screenshotTask().
+static QoiWriter g_qoi;
+
+
+
+static u16* slotPixels(const u32 idx)
+{
+	return (u16*)(SCREENSHOT_SLOT_ADDR + SCREENSHOT_SLOT_SIZE * (idx % SCREENSHOT_SLOTS));
+}
+
+static void qoiFlush(QoiWriter *const q)
+{
+	if(q->res == RES_OK && q->pos > 0)
+	{
+		u32 written;
+		q->res = fWrite(q->f, q->buf, q->pos, &written);
+	}
+	q->pos = 0;
+}
+
+// Makes room for at least 5 bytes (the longest op).
+static inline u8* qoiReserve(QoiWriter *const q)
+{
+	if(q->pos > QOI_BUF_SIZE - 5) qoiFlush(q);
+	return &q->buf[q->pos];
+}
+
+static void qoiPutU32BE(u8 *const p, const u32 val)
+{
+	p[0] = val>>24;
+	p[1] = val>>16;
+	p[2] = val>>8;
+	p[3] = val;
+}
+
+// Encodes A1BGR5 pixels as 3 channel QOI (https://qoiformat.org/qoi-specification.pdf).
+// GBA frames have few colors and large flat areas so most pixels end up as 1 byte ops.
+static Result qoiEncode(QoiWriter *const q, const u16 *pixels, const u16 w, const u16 h)
+{
+	u8 *p = q->buf;
+	memcpy(p, "qoif", 4);
+	qoiPutU32BE(p + 4, w);
+	qoiPutU32BE(p + 8, h);
+	p[12] = 3; // RGB.
+	p[13] = 0; // sRGB with linear alpha.
+	q->pos = 14;
+
+	// Alpha is always 0xFF so zeroed entries never match.
+	u32 index[64] = {0};
+	u32 prev = 0xFF000000u;
+	u32 run = 0;
+	for(u32 y = 0; y < h; y++)
+	{
+		for(u32 x = 0; x < w; x++)
+		{
+			// Expand 5 to 8 bits per channel.
+			const u32 px5 = *pixels++;
+			u32 r = px5>>11;
+			u32 g = px5>>6 & 0x1Fu;
+			u32 b = px5>>1 & 0x1Fu;
+			r = r<<3 | r>>2;
+			g = g<<3 | g>>2;
+			b = b<<3 | b>>2;
+			const u32 px = 0xFF000000u | b<<16 | g<<8 | r;
+
+			if(px == prev)
+			{
+				if(++run == 62)
+				{
+					*qoiReserve(q) = QOI_OP_RUN | (run - 1);
+					q->pos++;
+					run = 0;
+				}
+				continue;
+			}
+
+			u8 *op = qoiReserve(q);
+			if(run > 0)
+			{
+				*op++ = QOI_OP_RUN | (run - 1);
+				run = 0;
+			}
+
+			const u32 hash = (r * 3 + g * 5 + b * 7 + 0xFFu * 11) & 63u;
+			if(index[hash] == px)
+			{
+				*op++ = QOI_OP_INDEX | hash;
+			}
+			else
+			{
+				index[hash] = px;
+
+				// Differences wrap around.
+				const s32 dr = (s8)(r - (prev & 0xFFu));
+				const s32 dg = (s8)(g - (prev>>8 & 0xFFu));
+				const s32 db = (s8)(b - (prev>>16 & 0xFFu));
+				const s32 drDg = dr - dg;
+				const s32 dbDg = db - dg;
+				if(dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1)
+				{
+					*op++ = QOI_OP_DIFF | (dr + 2)<<4 | (dg + 2)<<2 | (db + 2);
+				}
+				else if(dg >= -32 && dg <= 31 && drDg >= -8 && drDg <= 7 && dbDg >= -8 && dbDg <= 7)
+				{
+					*op++ = QOI_OP_LUMA | (dg + 32);
+					*op++ = (drDg + 8)<<4 | (dbDg + 8);
+				}
+				else
+				{
+					*op++ = QOI_OP_RGB;
+					*op++ = r;
+					*op++ = g;
+					*op++ = b;
+				}
+			}
+			q->pos = op - q->buf;
+			prev = px;
+		}
+
+		// Only use idle time.
+		yieldTask();
+	}
+
+	if(run > 0)
+	{
+		*qoiReserve(q) = QOI_OP_RUN | (run - 1);
+		q->pos++;
+	}
+
+	// End marker.
+	static const u8 qoiEnd[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+	if(q->pos > QOI_BUF_SIZE - sizeof(qoiEnd)) qoiFlush(q);
+	memcpy(&q->buf[q->pos], qoiEnd, sizeof(qoiEnd));
+	q->pos += sizeof(qoiEnd);
+	qoiFlush(q);
+
+	return q->res;
+}
+
+static Result writeSlot(const u32 idx)
+{
+	const ScreenshotSlot *const slot = &g_slots[idx % SCREENSHOT_SLOTS];
+	const u16 *const pixels = slotPixels(idx);
+	invalidateDCacheRange(pixels, slot->w * slot->h * 2);
+
+	// The RTC is read here and not in screenshotQueue() to keep the I2C transfer out of the display path.
+	// All frames of a burst use the time of the first.
+	if(slot->seq <= 1) MCU_getRtcTimeDate(&g_shotTime);
+
+	// Construct file path from date & time. Burst frames get a number appended.
+	char fn[48];
+	const RtcTimeDate *const td = &g_shotTime;
+	u32 len = ee_sprintf(fn, OAF_SCREENSHOT_DIR "/%04X_%02X_%02X_%02X_%02X_%02X",
+	                     td->year + 0x2000, td->mon, td->day, td->hour, td->min, td->sec);
+	if(slot->seq > 0) len += ee_sprintf(fn + len, "_%03u", slot->seq);
+	memcpy(fn + len, ".qoi", 5);
+
+	QoiWriter *const q = &g_qoi;
+	Result res = fOpen(&q->f, fn, FA_CREATE_ALWAYS | FA_WRITE);
+	if(res != RES_OK) return res;
+
+	q->res = RES_OK;
+	res = qoiEncode(q, pixels, slot->w, slot->h);
+	const Result closeRes = fClose(q->f);
+
+	return (res != RES_OK ? res : closeRes);
+}
+
+static void screenshotTask(UNUSED void *args)
+{
+	const KHandle event = g_queuedEvent;
+	while(1)
+	{
+		if(waitForEvent(event) != KRES_OK) break;
+		clearEvent(event);
+
+		// Clear before draining so no queued slot is missed.
+		u32 tail = g_tail;
+		while(tail != g_head)
+		{
+			const Result res = writeSlot(tail);
+			if(res != RES_OK) debug_printf("Screenshot write failed: %s\n", result2String(res));
+			g_tail = ++tail;
+		}
+	}
+
+	taskExit();
+}
+
+void screenshotInit(void)
+{
+	g_head = 0;
+	g_tail = 0;
+	g_queuedEvent = createEvent(false);
+	createTask(0x800, 2, screenshotTask, NULL); // Below the display tasks.
+}
+
+bool screenshotQueue(const u32 *const tex, const u16 w, const u16 h, const u8 seq)
+{
+	const u32 head = g_head;
+	if(head - g_tail >= SCREENSHOT_SLOTS) return false;
+
+	ScreenshotSlot *const slot = &g_slots[head % SCREENSHOT_SLOTS];
+	slot->w   = w;
+	slot->h   = h;
+	slot->seq = seq;
+
+	// Transfer frame data out of the 512x512 texture.
+	GX_displayTransfer(tex, PPF_DIM(512, h), (u32*)slotPixels(head), PPF_DIM(w, h),
+	                   PPF_O_FMT(GX_A1BGR5) | PPF_I_FMT(GX_A1BGR5) | PPF_CROP_EN);
+	GFX_waitForPPF();
+
+	g_head = head + 1;
+	signalEvent(g_queuedEvent, false);
+
+	return true;
+}
+
+void screenshotExit(void)
+{
+	if(g_queuedEvent == 0) return;
+
+	// screenshotTask() terminates once its event is deleted.
+	while(g_tail != g_head) yieldTask();
+	deleteEvent(g_queuedEvent);
+	g_queuedEvent = 0;
+}
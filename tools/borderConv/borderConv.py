@@ -0,0 +1,140 @@
+#!/usr/bin/env python3
+
+# This file is part of open_agb_firm
+# Copyright (C) 2024 profi200
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# Converts a 400x240 image to border.qoi (or the old raw border.bgr).
+# Any format Pillow can open is accepted. Raw border.bgr files can be
+# converted without Pillow.
+#
+# border.qoi is a regular QOI image (https://qoiformat.org/) so any QOI
+# encoder works too. This script only exists for convenience.
+
+import argparse
+import os
+import struct
+import sys
+
+WIDTH  = 400
+HEIGHT = 240
+
+
+def loadRgb(path):
+	"""Returns the image as rows of (r, g, b) tuples."""
+	if path.lower().endswith('.bgr'):
+		# Frame buffer layout: pixel (x, y) is at ((x * 240) + (239 - y)) * 3 as BGR.
+		with open(path, 'rb') as f:
+			data = f.read()
+		if len(data) != WIDTH * HEIGHT * 3:
+			sys.exit(f'{path}: Expected {WIDTH * HEIGHT * 3} bytes but got {len(data)}.')
+
+		rows = []
+		for y in range(HEIGHT):
+			row = []
+			for x in range(WIDTH):
+				o = (x * HEIGHT + (HEIGHT - 1 - y)) * 3
+				row.append((data[o + 2], data[o + 1], data[o]))
+			rows.append(row)
+		return rows
+
+	try:
+		from PIL import Image
+	except ImportError:
+		sys.exit('Pillow is required for image input. Install it with "pip install Pillow".')
+
+	img = Image.open(path).convert('RGB')
+	if img.size != (WIDTH, HEIGHT):
+		sys.exit(f'{path}: Border must be {WIDTH}x{HEIGHT} but is {img.size[0]}x{img.size[1]}.')
+
+	px = list(img.getdata())
+	return [px[y * WIDTH:(y + 1) * WIDTH] for y in range(HEIGHT)]
+
+
+def encodeQoi(rows):
+	out = bytearray(b'qoif' + struct.pack('>IIBB', WIDTH, HEIGHT, 3, 0))
+	index = [(0, 0, 0, 0)] * 64
+	prev = (0, 0, 0, 255)
+	run = 0
+	for row in rows:
+		for r, g, b in row:
+			px = (r, g, b, 255)
+			if px == prev:
+				run += 1
+				if run == 62:
+					out.append(0xC0 | (run - 1))
+					run = 0
+				continue
+
+			if run > 0:
+				out.append(0xC0 | (run - 1))
+				run = 0
+
+			h = (r * 3 + g * 5 + b * 7 + 255 * 11) & 63
+			if index[h] == px:
+				out.append(h)
+			else:
+				index[h] = px
+				dr = ((r - prev[0] + 128) & 0xFF) - 128
+				dg = ((g - prev[1] + 128) & 0xFF) - 128
+				db = ((b - prev[2] + 128) & 0xFF) - 128
+				if -2 <= dr <= 1 and -2 <= dg <= 1 and -2 <= db <= 1:
+					out.append(0x40 | (dr + 2)<<4 | (dg + 2)<<2 | (db + 2))
+				elif -32 <= dg <= 31 and -8 <= dr - dg <= 7 and -8 <= db - dg <= 7:
+					out.append(0x80 | (dg + 32))
+					out.append((dr - dg + 8)<<4 | (db - dg + 8))
+				else:
+					out += bytes((0xFE, r, g, b))
+			prev = px
+
+	if run > 0: out.append(0xC0 | (run - 1))
+	out += b'\x00' * 7 + b'\x01'
+
+	return bytes(out)
+
+
+def encodeRaw(rows):
+	out = bytearray(WIDTH * HEIGHT * 3)
+	for y, row in enumerate(rows):
+		for x, (r, g, b) in enumerate(row):
+			o = (x * HEIGHT + (HEIGHT - 1 - y)) * 3
+			out[o:o + 3] = bytes((b, g, r))
+
+	return bytes(out)
+
+
+def main():
+	parser = argparse.ArgumentParser(description='Converts a 400x240 image to an open_agb_firm border.')
+	parser.add_argument('input', help='Image or raw border.bgr to convert.')
+	parser.add_argument('output', nargs='?', help='Output file. Default: border.qoi or border.bgr next to the input.')
+	parser.add_argument('--bgr', action='store_true', help='Output the old uncompressed border.bgr format.')
+	args = parser.parse_args()
+
+	rows = loadRgb(args.input)
+	data = (encodeRaw(rows) if args.bgr else encodeQoi(rows))
+
+	output = args.output
+	if output is None:
+		output = os.path.join(os.path.dirname(args.input), ('border.bgr' if args.bgr else 'border.qoi'))
+	if os.path.abspath(output) == os.path.abspath(args.input):
+		sys.exit('Input and output must be different files.')
+	with open(output, 'wb') as f:
+		f.write(data)
+
+	print(f'Wrote {output} ({len(data)} bytes).')
+
+
+if __name__ == '__main__':
+	main()
@@ -1,6 +1,6 @@
 #!/usr/bin/env python3
 
-# open_agb_firm gba_db.bin Builder v4.0
+# open_agb_firm gba_db.bin Builder v5.0
 # By HTV04
 #
 # This script parses MAME's "gba.xml" (https://github.com/mamedev/mame/blob/master/hash/gba.xml)
@@ -12,6 +12,20 @@
 #
 # Note that, for efficiency, this script does not check for formatting errors and assumes that all
 # entries are valid. Errors may occur otherwise.
+#
+# Since v5.0 the output starts with a header and a 256 entry fan-out table indexed by the first
+# SHA-1 byte. For every bucket the table stores the index of the first entry of the next bucket.
+# All entries of a bucket are stored back to back so a lookup is one header read and one bucket
+# read. "--legacy" outputs the old headerless format (entries sorted by the first 8 SHA-1 bytes
+# as little endian integer) which open_agb_firm still reads.
+#
+# Header layout (little endian):
+#   char magic[4];     // "GBDB"
+#   u16  version;      // 1
+#   u16  entrySize;    // 28
+#   u32  entryCount;
+#   u32  reserved;
+#   u16  fanout[256];
 
 # MIT License
 #
@@ -38,9 +52,14 @@
 import enum
 import sys
 import re
+import struct
 import xml.etree.ElementTree
 import csv
 
+DB_MAGIC = b'GBDB'
+DB_VERSION = 1
+ENTRY_SIZE = 28
+
 class Entry:
 	def __init__(self):
 		self.sha1 = '\x00' * 20
@@ -160,13 +179,28 @@ class Database:
 		fail_count = 0
 		count = 0
 
+		if '--from-bin' in sys.argv:
+			path = sys.argv[sys.argv.index('--from-bin') + 1]
+			log('Using entries from "' + path + '"!\n\n')
+
+			for entry in read_bin(path):
+				count += 1
+				self.entries.append(entry)
+				log('Added "' + entry.sha1.hex() + '"\n')
+			log('\n')
+
+		if '--from-bin' in sys.argv:
+			softwares = []
+		else:
+			softwares = xml.etree.ElementTree.parse('gba.xml').getroot().findall('software')
+
 		if '--dat' in sys.argv:
 			dat = xml.etree.ElementTree.parse('gba.dat').getroot()
 			log('Using gba.dat!\n\n')
 		else:
 			dat = None
 
-		for software in xml.etree.ElementTree.parse('gba.xml').getroot().findall('software'):
+		for software in softwares:
 			log('Adding "' + software.find('description').text + '"\n')
 			ret = get_entry(software, dat)
 			if isinstance(ret, Entry):
@@ -202,15 +236,57 @@ class Database:
 
 		log('Compiled with ' + str(count) + ' entries, ' + str(fail_count) + ' failures.\n')
 
-	def compile(self, out):
+	def compile_legacy(self, out):
 		for entry in sorted(self.entries, key=lambda a: int.from_bytes(a.sha1[:8], byteorder='little')):
 			out(entry.sha1)
 			out(entry.serial)
 			out(entry.attr)
 
+	def compile(self, out):
+		entries = sorted(self.entries, key=lambda a: a.sha1)
+		if len(entries) > 0xFFFF:
+			raise Exception('Too many entries for the fan-out table')
+
+		fanout = [0] * 256
+		for entry in entries:
+			fanout[entry.sha1[0]] += 1
+		for i in range(1, 256):
+			fanout[i] += fanout[i - 1]
+
+		out(struct.pack('<4sHHII', DB_MAGIC, DB_VERSION, ENTRY_SIZE, len(entries), 0))
+		out(struct.pack('<256H', *fanout))
+		for entry in entries:
+			out(entry.sha1)
+			out(entry.serial)
+			out(entry.attr)
+
+def read_bin(path):
+	with open(path, 'rb') as f:
+		data = f.read()
+
+	if data[:4] == DB_MAGIC:
+		_, version, entry_size, entry_count, _ = struct.unpack_from('<4sHHII', data)
+		if version != DB_VERSION or entry_size != ENTRY_SIZE:
+			raise Exception('Unsupported database version')
+		offset = 16 + 256 * 2
+	else:
+		entry_count = len(data) // ENTRY_SIZE
+		offset = 0
+
+	entries = []
+	for i in range(entry_count):
+		raw = data[offset + i * ENTRY_SIZE:offset + (i + 1) * ENTRY_SIZE]
+		entry = Entry()
+		entry.sha1 = raw[:20]
+		entry.serial = raw[20:24]
+		entry.attr = raw[24:28]
+		entries.append(entry)
+
+	return entries
+
 if __name__ == '__main__':
 	if '--help' in sys.argv:
-		print('open_agb_firm gba_db.bin Builder v4.0')
+		print('open_agb_firm gba_db.bin Builder v5.0')
 		print('By HTV04')
 		print()
 		print('Usage: gba-db.py [options]')
@@ -218,7 +294,9 @@ if __name__ == '__main__':
 		print()
 		print('  --dat: Use No-Intro "gba.dat" for verification')
 		print('  --csv: Use "gba.csv" for additional entries and overrides')
+		print('  --from-bin [file]: Use the entries of an existing gba_db.bin instead of "gba.xml"')
 		print()
+		print('  --legacy: Output the old format without header (pre v5.0)')
 		print('  --out [file]: Output to [file] instead of "gba_db.bin"')
 		print()
 		print('  --help: Display this help message and exit')
@@ -236,4 +314,7 @@ if __name__ == '__main__':
 	if '--out' in sys.argv:
 		out = sys.argv[sys.argv.index('--out') + 1]
 	with open(out, 'wb') as f:
-		db.compile(f.write)
+		if '--legacy' in sys.argv:
+			db.compile_legacy(f.write)
+		else:
+			db.compile(f.write)
@@ -0,0 +1,7 @@
+#!/bin/bash
+
+# Host build of the boot path kernels. Run ./hostBench from this directory.
+rm -f ./hostBench
+gcc -std=gnu2x -O2 -fstrict-aliasing -Wall -Wextra -D__ARM11__ -DNDEBUG -Dconstexpr=const -I./include -I../../include \
+	../../source/arm11/crc32.c ../../source/arm11/patch_stream.c ./kernels_patch.c ./kernels_save_type.c \
+	./kernels_color_lut.c ./kernels_filebrowser.c ./host_stubs.c ./hostBench.c -o ./hostBench -lm -lpthread
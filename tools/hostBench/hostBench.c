@@ -0,0 +1,764 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Host benchmark and regression harness for the boot path kernels.
+// Usage: ./hostBench [-n iterations] [-u] [-g golden file] [-d gba_db.bin dir] [ROMs/dirs...]
+// Every result is checked against the golden file. -u rewrites it with the current results.
+// ROMs given on the command line are benchmarked with the IPS/UPS patch next to them (if any).
+// Directories are benchmarked with the file browser scan.
+// Note: The color lut results depend on the libm powf(). The golden file is for glibc.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "types.h"
+#include "fs.h"
+#include "drivers/lgy_common.h"
+#include "util.h"
+#include "arm11/crc32.h"
+#include "oaf_error_codes.h"
+#include "kernels.h"
+
+
+#define MAX_ITERATIONS  (64u)
+#define MAX_GOLDEN      (256u)
+#define ROM_SIZE_16M    (1024u * 1024 * 16)
+#define SORT_ENTRIES    (20000u)
+#define SCAN_ENTRIES    (3000u)
+#define DB_MISSES       (1000u)
+
+typedef struct
+{
+	char name[64];
+	u32 value;
+	bool seen;
+} GoldenEntry;
+
+typedef struct
+{
+	u32 iterations;
+	bool update;
+	const char *goldenPath;
+	const char *dbDir;
+} BenchOptions;
+
+
+static BenchOptions g_opts = {5, false, "golden.txt", "../../resources"};
+static GoldenEntry g_golden[MAX_GOLDEN];
+static u32 g_goldenNum = 0;
+static u32 g_failures = 0;
+static u32 g_rng = 0;
+static char g_tmpDir[64];
+
+
+
+static u64 nowNs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (u64)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+// xorshift32. Every corpus file is generated from a fixed seed.
+static u32 rnd(void)
+{
+	u32 x = g_rng;
+	x ^= x<<13;
+	x ^= x>>17;
+	x ^= x<<5;
+	g_rng = x;
+
+	return x;
+}
+
+static void rndFill(u8 *const buf, const u32 size)
+{
+	for(u32 i = 0; i < size; i += 4)
+	{
+		const u32 w = rnd();
+		memcpy(&buf[i], &w, (size - i < 4 ? size - i : 4));
+	}
+}
+
+static bool writeFile(const char *const path, const void *const data, const u32 size)
+{
+	FILE *const f = fopen(path, "wb");
+	if(f == NULL) return false;
+	const bool ok = fwrite(data, 1, size, f) == size;
+
+	return fclose(f) == 0 && ok;
+}
+
+static u8* readFile(const char *const path, u32 *const size)
+{
+	FILE *const f = fopen(path, "rb");
+	if(f == NULL) return NULL;
+
+	fseek(f, 0, SEEK_END);
+	const long fileSize = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	u8 *buf = (fileSize >= 0 ? (u8*)malloc(fileSize + 1) : NULL);
+	if(buf != NULL && fread(buf, 1, fileSize, f) != (size_t)fileSize)
+	{
+		free(buf);
+		buf = NULL;
+	}
+	fclose(f);
+	*size = fileSize;
+
+	return buf;
+}
+
+
+// Golden results.
+static void loadGolden(void)
+{
+	FILE *const f = fopen(g_opts.goldenPath, "r");
+	if(f == NULL) return;
+
+	char line[128];
+	while(fgets(line, sizeof(line), f) != NULL && g_goldenNum < MAX_GOLDEN)
+	{
+		GoldenEntry *const e = &g_golden[g_goldenNum];
+		if(line[0] == '#' || sscanf(line, "%63s %" SCNx32, e->name, &e->value) != 2) continue;
+		e->seen = false;
+		g_goldenNum++;
+	}
+	fclose(f);
+}
+
+static void storeGolden(void)
+{
+	FILE *const f = fopen(g_opts.goldenPath, "w");
+	if(f == NULL)
+	{
+		fprintf(stderr, "Could not write '%s'.\n", g_opts.goldenPath);
+		g_failures++;
+		return;
+	}
+
+	fputs("# Generated by hostBench -u. <name> <expected result>\n", f);
+	for(u32 i = 0; i < g_goldenNum; i++)
+	{
+		if(g_golden[i].seen) fprintf(f, "%s %08" PRIX32 "\n", g_golden[i].name, g_golden[i].value);
+	}
+	fclose(f);
+}
+
+static const char* checkGolden(const char *const name, const u32 value)
+{
+	GoldenEntry *e = NULL;
+	for(u32 i = 0; i < g_goldenNum; i++)
+	{
+		if(strcmp(g_golden[i].name, name) == 0) e = &g_golden[i];
+	}
+
+	if(e == NULL)
+	{
+		if(g_goldenNum == MAX_GOLDEN) return "NEW";
+		e = &g_golden[g_goldenNum++];
+		safeStrcpy(e->name, name, sizeof(e->name));
+		e->value = value;
+		e->seen  = true;
+		return (g_opts.update ? "NEW" : "NEW (run with -u)");
+	}
+
+	e->seen = true;
+	if(e->value == value) return "OK";
+	if(g_opts.update)
+	{
+		e->value = value;
+		return "UPDATED";
+	}
+
+	g_failures++;
+	return "FAIL";
+}
+
+static int compareU64(const void *a, const void *b)
+{
+	const u64 x = *(const u64*)a;
+	const u64 y = *(const u64*)b;
+
+	return (x > y) - (x < y);
+}
+
+// bytes is the amount of data processed per iteration. 0 for no throughput.
+static void report(const char *const name, u64 *const times, const u32 n, const u64 bytes, const u32 value, const bool verified)
+{
+	qsort(times, n, sizeof(u64), compareU64);
+	const u64 med = times[n / 2];
+	const char *status = checkGolden(name, value);
+	if(!verified)
+	{
+		g_failures++;
+		status = "FAIL (reference mismatch)";
+	}
+
+	printf("%-28s %9.3f %9.3f %9.3f", name, times[0] / 1e6, med / 1e6, times[n - 1] / 1e6);
+	if(bytes != 0) printf(" %10.1f", bytes / (med / 1e9) / (1024 * 1024));
+	else           printf(" %10s", "-");
+	printf("  %08" PRIX32 " %s\n", value, status);
+}
+
+
+// Save type detection.
+static void placeString(u8 *const rom, const u32 offset, const char *const str)
+{
+	memcpy(&rom[offset], str, strlen(str));
+}
+
+// Random ROM with decoy save string prefixes. saveString is placed at offset if not NULL.
+static void makeRom(u8 *const rom, const u32 size, const u32 seed, const char *const saveString, const u32 offset)
+{
+	g_rng = seed;
+	rndFill(rom, size);
+	placeString(rom, 0xAC, "BTST");
+
+	// Prefixes which don't match any save string make the matcher work.
+	static const char *const decoys[3] = {"EEPROM_V9", "FLASH_V1x", "SRAM_F_X"};
+	for(u32 i = 0x1000; i < size - 16; i += 0x1000) placeString(rom, i, decoys[(i>>12) % 3]);
+
+	if(saveString != NULL) placeString(rom, offset, saveString);
+}
+
+static void benchSaveType(const char *const name, const u32 romSize, const u32 loadStep)
+{
+	u64 times[MAX_ITERATIONS];
+	u16 saveType = 0;
+	for(u32 i = 0; i < g_opts.iterations; i++)
+	{
+		const u64 start = nowNs();
+		saveType = benchDetectSaveType(romSize, loadStep);
+		times[i] = nowNs() - start;
+	}
+
+	report(name, times, g_opts.iterations, romSize, saveType, true);
+}
+
+static void runSaveTypeBenches(void)
+{
+	u8 *const rom = (u8*)LGY_ROM_LOC;
+	makeRom(rom, ROM_SIZE_16M, 0x1234567u, "FLASH1M_V103", ROM_SIZE_16M - 0x10000);
+	benchSaveType("save_flash1m_16m", ROM_SIZE_16M, 0);
+	benchSaveType("save_flash1m_16m_streamed", ROM_SIZE_16M, 1024 * 1024);
+
+	makeRom(rom, LGY_MAX_ROM_SIZE, 0x2345678u, "EEPROM_V124", LGY_MAX_ROM_SIZE - 0x100);
+	benchSaveType("save_eeprom64k_32m", LGY_MAX_ROM_SIZE, 0);
+
+	makeRom(rom, ROM_SIZE_16M / 2, 0x3456789u, NULL, 0);
+	benchSaveType("save_none_8m", ROM_SIZE_16M / 2, 0);
+}
+
+
+// Patches.
+// The ROM region is reset to base + 0xFF padding before every iteration.
+static void resetRom(const u8 *const base, const u32 baseSize)
+{
+	memcpy((void*)LGY_ROM_LOC, base, baseSize);
+	memset((u8*)LGY_ROM_LOC + baseSize, 0xFF, LGY_HOST_ROM_SIZE - baseSize);
+}
+
+static bool benchPatch(const char *const name, const char *const patchPath, const u8 *const base, const u32 baseSize,
+                       const u8 *const expected, const u32 expectedSize)
+{
+	const bool isUps = strcmp(patchPath + strlen(patchPath) - 4, ".ups") == 0;
+	u64 times[MAX_ITERATIONS];
+	u64 patchSize = 0;
+	Result res = RES_OK;
+	u32 romSize = baseSize;
+	for(u32 i = 0; i < g_opts.iterations; i++)
+	{
+		resetRom(base, baseSize);
+		romSize = baseSize;
+
+		FHandle f;
+		if((res = fOpen(&f, patchPath, FA_OPEN_EXISTING | FA_READ)) != RES_OK) break;
+		patchSize = fSize(f);
+
+		const u64 start = nowNs();
+		res = (isUps ? benchPatchUps(f, &romSize) : benchPatchIps(f, &romSize));
+		times[i] = nowNs() - start;
+
+		fClose(f);
+	}
+	if(res == RES_FR_NO_FILE) return false;
+
+	// The result covers the whole virtual cart, the return code and the new size.
+	u32 value = crc32Update(0, (void*)LGY_ROM_LOC, romSize);
+	value = crc32Update(value, &res, sizeof(res));
+	value = crc32Update(value, &romSize, sizeof(romSize));
+	const bool verified = expected == NULL || (res == RES_OK && memcmp((void*)LGY_ROM_LOC, expected, expectedSize) == 0);
+	report(name, times, g_opts.iterations, patchSize, value, verified);
+
+	return true;
+}
+
+static void putBigEndian(u8 **const out, const u32 val, const u32 size)
+{
+	for(u32 i = 0; i < size; i++) *(*out)++ = val>>(8 * (size - 1 - i));
+}
+
+// Writes an IPS patch with random hunks and applies it to target.
+static u32 makeIps(u8 *const patch, u8 *const target, const u32 romSize, const u32 hunks)
+{
+	u8 *out = patch;
+	memcpy(out, "PATCH", 5);
+	out += 5;
+	for(u32 i = 0; i < hunks; i++)
+	{
+		const u32 offset = rnd() % (romSize - 0x10000);
+		if(offset == 0x454F46u) continue; // "EOF".
+
+		putBigEndian(&out, offset, 3);
+		if(rnd() % 10 == 0)
+		{
+			// RLE.
+			const u32 length = 1 + rnd() % 0x4000;
+			const u8 val = rnd();
+			putBigEndian(&out, 0, 2);
+			putBigEndian(&out, length, 2);
+			*out++ = val;
+			memset(&target[offset], val, length);
+		}
+		else
+		{
+			const u32 length = 1 + rnd() % 512;
+			putBigEndian(&out, length, 2);
+			rndFill(out, length);
+			memcpy(&target[offset], out, length);
+			out += length;
+		}
+	}
+	memcpy(out, "EOF", 3);
+	out += 3;
+
+	return out - patch;
+}
+
+static void putVuint(u8 **const out, u32 val)
+{
+	while(1)
+	{
+		const u8 x = val & 0x7Fu;
+		val >>= 7;
+		if(val == 0)
+		{
+			*(*out)++ = 0x80u | x;
+			break;
+		}
+		*(*out)++ = x;
+		val--;
+	}
+}
+
+// Writes a UPS patch for source to target.
+static u32 makeUps(u8 *const patch, const u8 *const source, const u32 sourceSize, const u8 *const target, const u32 targetSize)
+{
+	u8 *out = patch;
+	memcpy(out, "UPS1", 4);
+	out += 4;
+	putVuint(&out, sourceSize);
+	putVuint(&out, targetSize);
+
+	const u32 size = (sourceSize > targetSize ? sourceSize : targetSize);
+	u32 pos = 0, last = 0;
+	while(pos < size)
+	{
+		const u8 x = (pos < sourceSize ? source[pos] : 0) ^ (pos < targetSize ? target[pos] : 0);
+		if(x == 0)
+		{
+			pos++;
+			continue;
+		}
+
+		putVuint(&out, pos - last);
+		while(pos < size)
+		{
+			const u8 y = (pos < sourceSize ? source[pos] : 0) ^ (pos < targetSize ? target[pos] : 0);
+			if(y == 0) break;
+			*out++ = y;
+			pos++;
+		}
+		*out++ = 0;
+		last = ++pos;
+	}
+
+	u32 crcs[3] = {crc32Update(0, source, sourceSize), crc32Update(0, target, targetSize), 0};
+	memcpy(out, crcs, 8);
+	crcs[2] = crc32Update(0, patch, out + 8 - patch);
+	memcpy(out + 8, &crcs[2], 4);
+
+	return out + 12 - patch;
+}
+
+static void runPatchBenches(void)
+{
+	const u32 targetSize = ROM_SIZE_16M + ROM_SIZE_16M / 4;
+	u8 *const base   = (u8*)malloc(ROM_SIZE_16M);
+	u8 *const target = (u8*)malloc(targetSize);
+	u8 *const patch  = (u8*)malloc(32 * 1024 * 1024);
+	if(base == NULL || target == NULL || patch == NULL)
+	{
+		fprintf(stderr, "Out of memory.\n");
+		g_failures++;
+		goto end;
+	}
+	makeRom(base, ROM_SIZE_16M, 0x4567891u, "SRAM_V113", 0x200000);
+
+	// IPS with many small hunks.
+	char path[128];
+	memcpy(target, base, ROM_SIZE_16M);
+	g_rng = 0x5678912u;
+	u32 patchSize = makeIps(patch, target, ROM_SIZE_16M, 4000);
+	snprintf(path, sizeof(path), "%s/synthetic.ips", g_tmpDir);
+	if(writeFile(path, patch, patchSize)) benchPatch("ips_4000_hunks", path, base, ROM_SIZE_16M, target, ROM_SIZE_16M);
+
+	// UPS with changed runs and a 4 MiB bigger target.
+	memcpy(target, base, ROM_SIZE_16M);
+	g_rng = 0x6789123u;
+	for(u32 i = 0; i < 4000; i++)
+	{
+		const u32 offset = rnd() % (ROM_SIZE_16M - 0x1000);
+		rndFill(&target[offset], 1 + rnd() % 1024);
+	}
+	rndFill(&target[ROM_SIZE_16M], targetSize - ROM_SIZE_16M);
+	patchSize = makeUps(patch, base, ROM_SIZE_16M, target, targetSize);
+	snprintf(path, sizeof(path), "%s/synthetic.ups", g_tmpDir);
+	if(writeFile(path, patch, patchSize)) benchPatch("ups_grow_4m", path, base, ROM_SIZE_16M, target, targetSize);
+
+	// Broken target CRC. Must be rejected.
+	patch[patchSize - 8] ^= 1u;
+	snprintf(path, sizeof(path), "%s/bad_crc.ups", g_tmpDir);
+	if(writeFile(path, patch, patchSize)) benchPatch("ups_bad_crc", path, base, ROM_SIZE_16M, NULL, 0);
+
+end:
+	free(patch);
+	free(target);
+	free(base);
+}
+
+
+// Color lut.
+static void runColorLutBenches(void)
+{
+	u32 *const lut = (u32*)malloc(32768 * sizeof(u32));
+	if(lut == NULL) return;
+
+	for(u8 profile = 1; profile <= 8; profile++)
+	{
+		u64 times[MAX_ITERATIONS];
+		for(u32 i = 0; i < g_opts.iterations; i++)
+		{
+			const u64 start = nowNs();
+			benchMakeColorLut(profile, lut);
+			times[i] = nowNs() - start;
+		}
+
+		char name[32];
+		snprintf(name, sizeof(name), "color_lut_profile%u", profile);
+		report(name, times, g_opts.iterations, 32768 * sizeof(u32), crc32Update(0, lut, 32768 * sizeof(u32)), true);
+	}
+
+	free(lut);
+}
+
+
+// File browser.
+static void makeName(char *const name, const bool isDir)
+{
+	static const char chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789 -_()[]";
+	const u32 len = 4 + rnd() % 36;
+	for(u32 i = 0; i < len; i++) name[i] = chars[rnd() % (sizeof(chars) - 1)];
+	if(isDir) name[len] = '\0';
+	else      strcpy(&name[len], ".gba");
+}
+
+static void runSortBenches(void)
+{
+	char (*const names)[48] = malloc(SORT_ENTRIES * 48);
+	const char **const ptrs = (const char**)malloc(SORT_ENTRIES * sizeof(char*));
+	if(names == NULL || ptrs == NULL) goto end;
+
+	g_rng = 0x789123u;
+	u64 bytes = 0;
+	for(u32 i = 0; i < SORT_ENTRIES; i++)
+	{
+		const bool isDir = rnd() % 10 == 0;
+		names[i][0] = (isDir ? '1' : '0');
+		makeName(&names[i][1], isDir);
+		ptrs[i] = names[i];
+		bytes += strlen(names[i]) + 1;
+	}
+
+	// Runs of 40 entries like SCAN_STEP_BLOCKS * DIR_READ_BLOCKS and one big sort.
+	static const u32 runSizes[2] = {40, SORT_ENTRIES};
+	static const char *const benchNames[2] = {"sort_20000_runs_of_40", "sort_20000_one_run"};
+	u32 crcs[2];
+	for(u32 r = 0; r < 2; r++)
+	{
+		u64 times[MAX_ITERATIONS];
+		for(u32 i = 0; i < g_opts.iterations; i++)
+		{
+			const u64 start = nowNs();
+			crcs[r] = benchSortEntries(ptrs, SORT_ENTRIES, runSizes[r]);
+			times[i] = nowNs() - start;
+		}
+
+		// Both must result in the same order.
+		report(benchNames[r], times, g_opts.iterations, bytes, crcs[r], crcs[r] == crcs[0]);
+	}
+
+end:
+	free(ptrs);
+	free(names);
+}
+
+static void benchScan(const char *const name, const char *const path)
+{
+	u64 times[MAX_ITERATIONS];
+	u64 maxStep = 0;
+	u32 crc = 0, entries = 0;
+	for(u32 i = 0; i < g_opts.iterations; i++)
+	{
+		const u64 start = nowNs();
+		void *const ctx = benchDirScanStart(path);
+		if(ctx == NULL)
+		{
+			fprintf(stderr, "Could not scan '%s'.\n", path);
+			g_failures++;
+			return;
+		}
+
+		// The browser runs one step per VBlank. The longest one matters for input lag.
+		bool active = true;
+		while(active)
+		{
+			const u64 stepStart = nowNs();
+			active = benchDirScanStep(ctx);
+			const u64 step = nowNs() - stepStart;
+			maxStep = (step > maxStep ? step : maxStep);
+		}
+		crc = benchDirScanFinish(ctx, &entries);
+		times[i] = nowNs() - start;
+	}
+
+	report(name, times, g_opts.iterations, 0, crc, true);
+	printf("%-28s %u entries, longest step %.3f ms\n", "", entries, maxStep / 1e6);
+}
+
+static void runScanBench(void)
+{
+	char path[128];
+	snprintf(path, sizeof(path), "%s/dir", g_tmpDir);
+	if(mkdir(path, 0777) != 0) return;
+
+	g_rng = 0x891234u;
+	for(u32 i = 0; i < SCAN_ENTRIES; i++)
+	{
+		// Some entries are filtered.
+		const bool isDir = rnd() % 20 == 0;
+		char name[48], entPath[192];
+		makeName(name, isDir);
+		if(!isDir && rnd() % 8 == 0) strcpy(&name[strlen(name) - 4], ".sav");
+		snprintf(entPath, sizeof(entPath), "%s/%s", path, name);
+		if(isDir) mkdir(entPath, 0777);
+		else      writeFile(entPath, "", 0);
+	}
+
+	benchScan("scan_3000_entries", path);
+}
+
+
+// gba_db.bin.
+static void runGbaDbBench(void)
+{
+	char path[512];
+	snprintf(path, sizeof(path), "%s/gba_db.bin", g_opts.dbDir);
+	u32 size;
+	u8 *const db = readFile(path, &size);
+	if(db == NULL)
+	{
+		printf("%-28s skipped ('%s' not found)\n", "gba_db_lookup", path);
+		return;
+	}
+
+	// Look up every entry and some which don't exist.
+	GbaDbHeader hdr;
+	memcpy(&hdr, db, sizeof(hdr));
+	const u32 first = (hdr.magic == GBA_DB_MAGIC ? sizeof(GbaDbHeader) : 0);
+	const u32 num = (size - first) / sizeof(GbaDbEntry);
+	u64 *const keys = (u64*)malloc((num + DB_MISSES) * sizeof(u64));
+	if(keys == NULL) goto end;
+	for(u32 i = 0; i < num; i++) memcpy(&keys[i], db + first + i * sizeof(GbaDbEntry), 8);
+	g_rng = 0x912345u;
+	for(u32 i = 0; i < DB_MISSES; i++) keys[num + i] = (u64)rnd()<<32 | rnd();
+
+	hostFsSetRoot(g_opts.dbDir);
+	u64 times[MAX_ITERATIONS];
+	u32 found = 0, crc = 0;
+	for(u32 i = 0; i < g_opts.iterations; i++)
+	{
+		found = crc = 0;
+		const u64 start = nowNs();
+		for(u32 k = 0; k < num + DB_MISSES; k++)
+		{
+			GbaDbEntry entry;
+			if(benchSearchGbaDb(keys[k], &entry) != RES_OK) continue;
+			found++;
+			crc = crc32Update(crc, &entry, sizeof(entry));
+		}
+		times[i] = nowNs() - start;
+	}
+	hostFsSetRoot(".");
+
+	report("gba_db_lookup", times, g_opts.iterations, 0, crc32Update(crc, &found, sizeof(found)), found <= num);
+	printf("%-28s %u/%u found, %.3f us per lookup\n", "", found, num + DB_MISSES, times[g_opts.iterations / 2] / 1e3 / (num + DB_MISSES));
+
+end:
+	free(keys);
+	free(db);
+}
+
+
+// Files from the command line.
+static void baseName(const char *const path, char *const out, const u32 size)
+{
+	const char *name = strrchr(path, '/');
+	name = (name != NULL ? name + 1 : path);
+	safeStrcpy(out, name, size);
+	char *const ext = strrchr(out, '.');
+	if(ext != NULL) *ext = '\0';
+}
+
+static void runFileBench(const char *const path)
+{
+	struct stat st;
+	if(stat(path, &st) != 0)
+	{
+		fprintf(stderr, "'%s' not found.\n", path);
+		g_failures++;
+		return;
+	}
+
+	char name[40], benchName[64];
+	baseName(path, name, sizeof(name));
+	if(S_ISDIR(st.st_mode))
+	{
+		snprintf(benchName, sizeof(benchName), "scan_%s", name);
+		benchScan(benchName, path);
+		return;
+	}
+
+	u32 romSize;
+	u8 *const rom = readFile(path, &romSize);
+	if(rom == NULL || romSize > LGY_MAX_ROM_SIZE)
+	{
+		fprintf(stderr, "'%s' is not a valid ROM.\n", path);
+		g_failures++;
+		free(rom);
+		return;
+	}
+
+	resetRom(rom, romSize);
+	snprintf(benchName, sizeof(benchName), "save_%s", name);
+	benchSaveType(benchName, romSize, 0);
+
+	// The patch must have the same name.
+	static const char *const exts[2] = {"ips", "ups"};
+	for(u32 i = 0; i < 2; i++)
+	{
+		char patchPath[512];
+		safeStrcpy(patchPath, path, sizeof(patchPath) - 4);
+		char *const ext = strrchr(patchPath, '.');
+		if(ext == NULL) break;
+		strcpy(ext + 1, exts[i]);
+
+		snprintf(benchName, sizeof(benchName), "%s_%s", exts[i], name);
+		benchPatch(benchName, patchPath, rom, romSize, NULL, 0);
+	}
+
+	free(rom);
+}
+
+static void removeTree(const char *const path)
+{
+	char cmd[128];
+	snprintf(cmd, sizeof(cmd), "rm -rf '%s'", path);
+	if(system(cmd) != 0) fprintf(stderr, "Could not remove '%s'.\n", path);
+}
+
+int main(int argc, char *argv[])
+{
+	int opt;
+	while((opt = getopt(argc, argv, "n:ug:d:")) != -1)
+	{
+		switch(opt)
+		{
+			case 'n':
+				g_opts.iterations = atoi(optarg);
+				if(g_opts.iterations < 1) g_opts.iterations = 1;
+				if(g_opts.iterations > MAX_ITERATIONS) g_opts.iterations = MAX_ITERATIONS;
+				break;
+			case 'u':
+				g_opts.update = true;
+				break;
+			case 'g':
+				g_opts.goldenPath = optarg;
+				break;
+			case 'd':
+				g_opts.dbDir = optarg;
+				break;
+			default:
+				fprintf(stderr, "Usage: %s [-n iterations] [-u] [-g golden file] [-d gba_db.bin dir] [ROMs/dirs...]\n", argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+
+	// The ROM and the BPS target area after it.
+	void *const romBuf = aligned_alloc(64, LGY_HOST_ROM_SIZE);
+	strcpy(g_tmpDir, "/tmp/hostBenchXXXXXX");
+	if(romBuf == NULL || mkdtemp(g_tmpDir) == NULL)
+	{
+		fprintf(stderr, "Setup failed.\n");
+		return EXIT_FAILURE;
+	}
+	g_hostRomLoc = (uintptr_t)romBuf;
+	loadGolden();
+
+	printf("%-28s %9s %9s %9s %10s  %s\n", "benchmark", "min ms", "med ms", "max ms", "MiB/s", "result");
+	runSaveTypeBenches();
+	runPatchBenches();
+	runColorLutBenches();
+	runSortBenches();
+	runScanBench();
+	runGbaDbBench();
+	for(int i = optind; i < argc; i++) runFileBench(argv[i]);
+
+	if(g_opts.update) storeGolden();
+	removeTree(g_tmpDir);
+	free(romBuf);
+
+	if(g_failures > 0) printf("%u failure(s).\n", g_failures);
+
+	return (g_failures > 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+}
@@ -0,0 +1,491 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Host implementations of the libn3ds and open_agb_firm functions
+// the benchmarked translation units depend on.
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "types.h"
+#include "error_codes.h"
+#include "fs.h"
+#include "util.h"
+#include "kernel.h"
+#include "kevent.h"
+#include "arm11/fmt.h"
+#include "arm11/console.h"
+#include "arm11/power.h"
+#include "arm11/drivers/hid.h"
+#include "arm11/drivers/gx.h"
+#include "drivers/gfx.h"
+#include "drivers/sha.h"
+#include "arm11/config.h"
+#include "arm11/fast_save_scan.h"
+#include "arm11/patch_cache.h"
+#include "arm11/rom_padding.h"
+#include "arm11/core1_jobs.h"
+#include "oaf_error_codes.h"
+
+
+#define MAX_FILES  (16u)
+#define MAX_DIRS   (4u)
+
+typedef struct
+{
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	bool oneShot;
+	bool signaled;
+} HostEvent;
+
+typedef struct
+{
+	TaskFunc entry;
+	void *arg;
+} HostTask;
+
+
+uintptr_t g_hostRomLoc = 0;
+OafConfig g_oafConfig =
+{
+	.colorProfile = 1,
+	.contrast     = 1.f,
+	.brightness   = 0.f,
+	.saturation   = 1.f
+};
+
+static char g_fsRoot[256] = ".";
+static FILE *g_files[MAX_FILES] = {0};
+static DIR *g_dirs[MAX_DIRS] = {0};
+static char g_dirPaths[MAX_DIRS][512];
+static bool g_consoleEnabled = false;
+
+
+
+// Files.
+void hostFsSetRoot(const char *const path)
+{
+	safeStrcpy(g_fsRoot, path, sizeof(g_fsRoot));
+}
+
+static void resolvePath(const char *path, char out[512])
+{
+	if(strncmp(path, "sdmc:", 5) == 0) path += 5;
+	if(*path == '/') safeStrcpy(out, path, 512);
+	else             snprintf(out, 512, "%s/%s", g_fsRoot, path);
+}
+
+Result fOpen(FHandle *const hOut, const char *const path, u8 mode)
+{
+	u32 h = 0;
+	while(h < MAX_FILES && g_files[h] != NULL) h++;
+	if(h == MAX_FILES) return RES_FR_INT_ERR;
+
+	const char *fmode;
+	if(mode & FA_CREATE_ALWAYS)                         fmode = "w+b";
+	else if((mode & FA_OPEN_APPEND) == FA_OPEN_APPEND) fmode = "a+b";
+	else if(mode & FA_WRITE)                           fmode = "r+b";
+	else                                               fmode = "rb";
+
+	char hostPath[512];
+	resolvePath(path, hostPath);
+	FILE *f = fopen(hostPath, fmode);
+	if(f == NULL && (mode & (FA_OPEN_ALWAYS | FA_CREATE_NEW)) != 0) f = fopen(hostPath, "w+b");
+	if(f == NULL) return RES_FR_NO_FILE;
+
+	g_files[h] = f;
+	*hOut = h;
+
+	return RES_OK;
+}
+
+Result fRead(FHandle h, void *const buf, u32 size, u32 *const bytesRead)
+{
+	const size_t read = fread(buf, 1, size, g_files[h]);
+	if(bytesRead != NULL) *bytesRead = read;
+
+	return (ferror(g_files[h]) ? RES_FR_DISK_ERR : RES_OK);
+}
+
+Result fWrite(FHandle h, const void *const buf, u32 size, u32 *const bytesWritten)
+{
+	const size_t written = fwrite(buf, 1, size, g_files[h]);
+	if(bytesWritten != NULL) *bytesWritten = written;
+
+	return (written != size ? RES_DISK_FULL : RES_OK);
+}
+
+Result fSync(FHandle h)
+{
+	return (fflush(g_files[h]) == 0 ? RES_OK : RES_FR_DISK_ERR);
+}
+
+Result fLseek(FHandle h, u32 off)
+{
+	return (fseek(g_files[h], off, SEEK_SET) == 0 ? RES_OK : RES_FR_DISK_ERR);
+}
+
+u32 fTell(FHandle h)
+{
+	return ftell(g_files[h]);
+}
+
+u32 fSize(FHandle h)
+{
+	struct stat st;
+	fflush(g_files[h]);
+	if(fstat(fileno(g_files[h]), &st) != 0) return 0;
+
+	return st.st_size;
+}
+
+Result fClose(FHandle h)
+{
+	const int res = fclose(g_files[h]);
+	g_files[h] = NULL;
+
+	return (res == 0 ? RES_OK : RES_FR_DISK_ERR);
+}
+
+Result fExpand(UNUSED FHandle h, UNUSED u32 size)
+{
+	return RES_OK;
+}
+
+static void stat2FileInfo(const struct stat *const st, const char *const name, FILINFO *const fi)
+{
+	// FAT time stamps in local time.
+	struct tm t;
+	localtime_r(&st->st_mtime, &t);
+	fi->fsize   = st->st_size;
+	fi->fdate   = (t.tm_year - 80)<<9 | (t.tm_mon + 1)<<5 | t.tm_mday;
+	fi->ftime   = t.tm_hour<<11 | t.tm_min<<5 | t.tm_sec / 2;
+	fi->fattrib = (S_ISDIR(st->st_mode) ? AM_DIR : 0);
+	fi->altname[0] = '\0';
+	safeStrcpy(fi->fname, name, sizeof(fi->fname));
+}
+
+Result fStat(const char *const path, FILINFO *const fi)
+{
+	char hostPath[512];
+	resolvePath(path, hostPath);
+	struct stat st;
+	if(stat(hostPath, &st) != 0) return RES_FR_NO_FILE;
+
+	const char *const name = strrchr(hostPath, '/');
+	stat2FileInfo(&st, (name != NULL ? name + 1 : hostPath), fi);
+
+	return RES_OK;
+}
+
+Result fOpenDir(DHandle *const hOut, const char *const path)
+{
+	u32 h = 0;
+	while(h < MAX_DIRS && g_dirs[h] != NULL) h++;
+	if(h == MAX_DIRS) return RES_FR_INT_ERR;
+
+	resolvePath(path, g_dirPaths[h]);
+	g_dirs[h] = opendir(g_dirPaths[h]);
+	if(g_dirs[h] == NULL) return RES_FR_NO_PATH;
+	*hOut = h;
+
+	return RES_OK;
+}
+
+Result fReadDir(DHandle h, FILINFO *const fi, u32 num, u32 *const entriesRead)
+{
+	u32 read = 0;
+	while(read < num)
+	{
+		const struct dirent *const ent = readdir(g_dirs[h]);
+		if(ent == NULL) break;
+		if(strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0) continue;
+
+		struct stat st;
+		if(fstatat(dirfd(g_dirs[h]), ent->d_name, &st, 0) != 0) return RES_FR_DISK_ERR;
+		stat2FileInfo(&st, ent->d_name, &fi[read++]);
+	}
+	*entriesRead = read;
+
+	return RES_OK;
+}
+
+Result fCloseDir(DHandle h)
+{
+	closedir(g_dirs[h]);
+	g_dirs[h] = NULL;
+
+	return RES_OK;
+}
+
+Result fMkdir(const char *const path)
+{
+	char hostPath[512];
+	resolvePath(path, hostPath);
+
+	return (mkdir(hostPath, 0777) == 0 ? RES_OK : RES_FR_EXIST);
+}
+
+Result fRename(const char *const old, const char *const new_)
+{
+	char oldPath[512], newPath[512];
+	resolvePath(old, oldPath);
+	resolvePath(new_, newPath);
+
+	return (rename(oldPath, newPath) == 0 ? RES_OK : RES_FR_DENIED);
+}
+
+Result fUnlink(const char *const path)
+{
+	char hostPath[512];
+	resolvePath(path, hostPath);
+
+	return (unlink(hostPath) == 0 ? RES_OK : RES_FR_NO_FILE);
+}
+
+
+// Tasks and events.
+static void* taskEntry(void *arg)
+{
+	const HostTask task = *(HostTask*)arg;
+	free(arg);
+	task.entry(task.arg);
+
+	return NULL;
+}
+
+KHandle createTask(UNUSED size_t stackSize, UNUSED u8 priority, TaskFunc entry, void *taskArg)
+{
+	HostTask *const task = (HostTask*)malloc(sizeof(HostTask));
+	if(task == NULL) return 0;
+	task->entry = entry;
+	task->arg   = taskArg;
+
+	pthread_t thread;
+	if(pthread_create(&thread, NULL, taskEntry, task) != 0)
+	{
+		free(task);
+		return 0;
+	}
+	pthread_detach(thread);
+
+	return 1;
+}
+
+void yieldTask(void)
+{
+	sched_yield();
+}
+
+void taskExit(void)
+{
+	pthread_exit(NULL);
+}
+
+KHandle createEvent(bool oneShot)
+{
+	HostEvent *const e = (HostEvent*)calloc(1, sizeof(HostEvent));
+	if(e == NULL) return 0;
+	pthread_mutex_init(&e->mutex, NULL);
+	pthread_cond_init(&e->cond, NULL);
+	e->oneShot = oneShot;
+
+	return (KHandle)e;
+}
+
+void deleteEvent(const KHandle kevent)
+{
+	HostEvent *const e = (HostEvent*)kevent;
+	pthread_cond_destroy(&e->cond);
+	pthread_mutex_destroy(&e->mutex);
+	free(e);
+}
+
+KRes waitForEvent(const KHandle kevent)
+{
+	HostEvent *const e = (HostEvent*)kevent;
+	pthread_mutex_lock(&e->mutex);
+	while(!e->signaled) pthread_cond_wait(&e->cond, &e->mutex);
+	if(e->oneShot) e->signaled = false;
+	pthread_mutex_unlock(&e->mutex);
+
+	return KRES_OK;
+}
+
+void signalEvent(const KHandle kevent, UNUSED bool reschedule)
+{
+	HostEvent *const e = (HostEvent*)kevent;
+	pthread_mutex_lock(&e->mutex);
+	e->signaled = true;
+	pthread_cond_broadcast(&e->cond);
+	pthread_mutex_unlock(&e->mutex);
+}
+
+void clearEvent(const KHandle kevent)
+{
+	HostEvent *const e = (HostEvent*)kevent;
+	pthread_mutex_lock(&e->mutex);
+	e->signaled = false;
+	pthread_mutex_unlock(&e->mutex);
+}
+
+
+// Console.
+void hostConsoleEnable(const bool enable)
+{
+	g_consoleEnabled = enable;
+}
+
+int ee_printf(const char *const fmt, ...)
+{
+	if(!g_consoleEnabled) return 0;
+
+	va_list args;
+	va_start(args, fmt);
+	const int res = vfprintf(stderr, fmt, args);
+	va_end(args);
+
+	return res;
+}
+
+int ee_sprintf(char *const buf, const char *const fmt, ...)
+{
+	va_list args;
+	va_start(args, fmt);
+	const int res = vsprintf(buf, fmt, args);
+	va_end(args);
+
+	return res;
+}
+
+int ee_snprintf(char *const buf, size_t size, const char *const fmt, ...)
+{
+	va_list args;
+	va_start(args, fmt);
+	const int res = vsnprintf(buf, size, fmt, args);
+	va_end(args);
+
+	return res;
+}
+
+int ee_puts(const char *const str)
+{
+	return (g_consoleEnabled ? fprintf(stderr, "%s\n", str) : 0);
+}
+
+void consoleClear(void) {}
+
+const char* result2String(Result res)
+{
+	static char str[16];
+	snprintf(str, sizeof(str), "error %" PRIu32, res);
+
+	return str;
+}
+
+void printError(UNUSED Result res) {}
+void printErrorWaitInput(UNUSED Result res, UNUSED u32 waitKeys) {}
+
+
+// Hardware.
+void hidScanInput(void) {}
+u32 hidKeysHeld(void) { return 0; }
+u32 hidKeysDown(void) { return 0; }
+u32 hidGetExtraKeys(UNUSED u32 clearMask) { return 0; }
+
+void GFX_flushBuffers(void) {}
+void GFX_waitForVBlank0(void) {}
+void GFX_waitForPPF(void) {}
+
+void GX_textureCopy(const u32 *const in, UNUSED u32 indim, u32 *out, UNUSED u32 outdim, u32 size)
+{
+	memcpy(out, in, size);
+}
+
+void sha(UNUSED const u32 *data, UNUSED u32 size, u32 *const hash, UNUSED u16 params, UNUSED u16 hashEndianess)
+{
+	memset(hash, 0, 20);
+}
+
+void power_off(void)
+{
+	exit(EXIT_FAILURE);
+}
+
+
+// Misc.
+u32 nextPow2(u32 v)
+{
+	v--;
+	v |= v>>1;
+	v |= v>>2;
+	v |= v>>4;
+	v |= v>>8;
+	v |= v>>16;
+
+	return v + 1;
+}
+
+void safeStrcpy(char *const dst, const char *const src, size_t num)
+{
+	if(num == 0) return;
+
+	const size_t len = strlen(src) + 1;
+	const size_t copySize = (len < num ? len : num);
+	memcpy(dst, src, copySize);
+	dst[copySize - 1] = '\0';
+}
+
+// There is no second core. Jobs run right away.
+u32 core1JobSubmit(Core1JobFn fn, void *arg)
+{
+	fn(arg);
+	return 0;
+}
+
+void core1JobWait(UNUSED const u32 ticket) {}
+
+// C version of the assembly search in fast_save_scan.s.
+const u32* findSaveStringFast(const u32 *start, const u32 *end)
+{
+	for(; start < end; start++)
+	{
+		const u32 w = *start;
+		if(w == 0x52504545u || w == 0x53414C46u || w == 0x4D415253u) break; // "EEPR", "FLAS", "SRAM".
+	}
+
+	return (start < end ? start : end);
+}
+
+// The caches are not benchmarked.
+Result romCacheMakeKey(UNUSED const char *const romPath, UNUSED RomCacheKey *const key) { return RES_NOT_FOUND; }
+void patchDeltaInit(UNUSED PatchDelta *const delta) {}
+void patchDeltaAdd(UNUSED PatchDelta *const delta, UNUSED const u32 offset, UNUSED const u32 size) {}
+void patchDeltaFree(UNUSED PatchDelta *const delta) {}
+Result patchCacheLoad(UNUSED const RomCacheKey *const key, UNUSED const u64 baseSha1, UNUSED u32 *const romSize) { return RES_NOT_FOUND; }
+Result patchCacheStore(UNUSED const RomCacheKey *const key, UNUSED const u64 baseSha1, UNUSED const u32 romSize, UNUSED const PatchDelta *const delta) { return RES_NOT_FOUND; }
+void romPaddingWait(void) {}
@@ -0,0 +1,39 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+
+
+// Console output is dropped unless hostConsoleEnable() was called.
+// Note: No format checks. u32 is unsigned long on the 3DS.
+
+
+
+void hostConsoleEnable(const bool enable);
+int ee_printf(const char *const fmt, ...);
+int ee_sprintf(char *const buf, const char *const fmt, ...);
+int ee_snprintf(char *const buf, size_t size, const char *const fmt, ...);
+int ee_puts(const char *const str);
+
+#ifndef NDEBUG
+#define debug_printf(fmt, ...)  ee_printf(fmt, ##__VA_ARGS__)
+#else
+#define debug_printf(fmt, ...)  ((void)0)
+#endif
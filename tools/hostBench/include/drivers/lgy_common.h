@@ -0,0 +1,49 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+
+
+// The ROM lives in a host buffer. The memory after the ROM (used by BPS) is part of it.
+extern uintptr_t g_hostRomLoc;
+#define LGY_ROM_LOC        (g_hostRomLoc)
+#define LGY_MAX_ROM_SIZE   (1024u * 1024 * 32)
+#define LGY_HOST_ROM_SIZE  (LGY_MAX_ROM_SIZE * 2)
+
+enum
+{
+	SAVE_TYPE_EEPROM_8k          = 0x0u,
+	SAVE_TYPE_EEPROM_8k_2        = 0x1u,
+	SAVE_TYPE_EEPROM_64k         = 0x2u,
+	SAVE_TYPE_EEPROM_64k_2       = 0x3u,
+	SAVE_TYPE_FLASH_512k_AML_RTC = 0x4u,
+	SAVE_TYPE_FLASH_512k_AML     = 0x5u,
+	SAVE_TYPE_FLASH_512k_SST_RTC = 0x6u,
+	SAVE_TYPE_FLASH_512k_SST     = 0x7u,
+	SAVE_TYPE_FLASH_512k_PSC_RTC = 0x8u,
+	SAVE_TYPE_FLASH_512k_PSC     = 0x9u,
+	SAVE_TYPE_FLASH_1m_MRX_RTC   = 0xAu,
+	SAVE_TYPE_FLASH_1m_MRX       = 0xBu,
+	SAVE_TYPE_FLASH_1m_SNO_RTC   = 0xCu,
+	SAVE_TYPE_FLASH_1m_SNO       = 0xDu,
+	SAVE_TYPE_SRAM_256k          = 0xEu,
+	SAVE_TYPE_NONE               = 0xFu,
+	SAVE_TYPE_MASK               = SAVE_TYPE_NONE
+};
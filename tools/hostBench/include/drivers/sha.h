@@ -0,0 +1,31 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+
+
+#define SHA_IN_BIG      (1u<<3)
+#define SHA_OUT_BIG     SHA_IN_BIG
+#define SHA_1_MODE      (2u<<4)
+
+
+
+// Not implemented. Only referenced by debug builds.
+void sha(const u32 *data, u32 size, u32 *const hash, u16 params, u16 hashEndianess);
@@ -0,0 +1,49 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+
+
+enum
+{
+	RES_OK = 0u,
+	RES_SD_CARD_REMOVED,
+	RES_DISK_FULL,
+	RES_INVALID_ARG,
+	RES_OUT_OF_MEM,
+	RES_OUT_OF_RANGE,
+	RES_NOT_FOUND,
+	RES_PATH_TOO_LONG,
+
+	RES_FR_DISK_ERR,
+	RES_FR_INT_ERR,
+	RES_FR_NOT_READY,
+	RES_FR_NO_FILE,
+	RES_FR_NO_PATH,
+	RES_FR_INVALID_NAME,
+	RES_FR_DENIED,
+	RES_FR_EXIST,
+
+	CUSTOM_ERR_OFFSET = 200u
+};
+
+
+
+const char* result2String(Result res);
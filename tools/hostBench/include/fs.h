@@ -0,0 +1,67 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "error_codes.h"
+
+
+// Maps to stdio. Relative paths are relative to the root set with hostFsSetRoot().
+#define FA_READ           (0x01u)
+#define FA_WRITE          (0x02u)
+#define FA_OPEN_EXISTING  (0x00u)
+#define FA_CREATE_NEW     (0x04u)
+#define FA_CREATE_ALWAYS  (0x08u)
+#define FA_OPEN_ALWAYS    (0x10u)
+#define FA_OPEN_APPEND    (0x30u)
+
+#define AM_DIR            (0x10u)
+
+typedef u32 FHandle;
+typedef u32 DHandle;
+
+typedef struct
+{
+	u64 fsize;
+	u16 fdate;
+	u16 ftime;
+	u8 fattrib;
+	char altname[13];
+	char fname[256];
+} FILINFO;
+
+
+
+void hostFsSetRoot(const char *const path);
+
+Result fOpen(FHandle *const hOut, const char *const path, u8 mode);
+Result fRead(FHandle h, void *const buf, u32 size, u32 *const bytesRead);
+Result fWrite(FHandle h, const void *const buf, u32 size, u32 *const bytesWritten);
+Result fSync(FHandle h);
+Result fLseek(FHandle h, u32 off);
+u32 fTell(FHandle h);
+u32 fSize(FHandle h);
+Result fClose(FHandle h);
+Result fExpand(FHandle h, u32 size);
+Result fStat(const char *const path, FILINFO *const fi);
+Result fOpenDir(DHandle *const hOut, const char *const path);
+Result fReadDir(DHandle h, FILINFO *const fi, u32 num, u32 *const entriesRead);
+Result fCloseDir(DHandle h);
+Result fMkdir(const char *const path);
+Result fRename(const char *const old, const char *const new_);
+Result fUnlink(const char *const path);
@@ -0,0 +1,38 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+
+
+// Tasks are host threads. Priorities are ignored.
+typedef uintptr_t KHandle;
+typedef void (*TaskFunc)(void*);
+
+typedef enum
+{
+	KRES_OK            = 0u,
+	KRES_HANDLE_DELETED = 2u
+} KRes;
+
+
+
+KHandle createTask(size_t stackSize, u8 priority, TaskFunc entry, void *taskArg);
+void yieldTask(void);
+void taskExit(void);
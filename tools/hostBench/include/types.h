@@ -0,0 +1,55 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Host replacements for the libn3ds headers used by the benchmarked code.
+// Only what the benchmarked translation units need.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdalign.h>
+#include <assert.h>
+#include <inttypes.h>
+
+
+typedef uint8_t   u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+
+typedef int8_t    s8;
+typedef int16_t  s16;
+typedef int32_t  s32;
+typedef int64_t  s64;
+
+typedef volatile u8   vu8;
+typedef volatile u16 vu16;
+typedef volatile u32 vu32;
+typedef volatile u64 vu64;
+
+typedef u32 Result;
+
+#define PACKED          __attribute__((packed))
+#define ALIGN(a)        __attribute__((aligned(a)))
+#define UNUSED          __attribute__((unused))
+#define NOINLINE        __attribute__((noinline))
+#define ALWAYS_INLINE   static inline __attribute__((always_inline))
+#define USED            __attribute__((used))
+#define arrayEntries(a) (sizeof(a) / sizeof(*(a)))
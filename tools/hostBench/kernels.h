@@ -0,0 +1,54 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+#include "fs.h"
+#include "arm11/save_type.h"
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Wrappers around functions which are static in the benchmarked translation units.
+// Each kernels_*.c file includes one of them.
+
+
+// patch.c. The patched ROM is at LGY_ROM_LOC.
+Result benchPatchIps(const FHandle f, u32 *const romSize);
+Result benchPatchUps(const FHandle f, u32 *const romSize);
+
+// save_type.c. The ROM is at LGY_ROM_LOC.
+u16 benchDetectSaveType(const u32 romSize, const u32 loadStep);
+Result benchSearchGbaDb(const u64 x, GbaDbEntry *const db);
+
+// color_lut.c. lut must have room for 32768 entries.
+void benchMakeColorLut(const u8 profile, u32 *const lut);
+
+// filebrowser.c. names are prefixed with the entry type ('0' file, '1' dir).
+u32 benchSortEntries(const char *const *const names, const u32 num, const u32 runSize);
+void* benchDirScanStart(const char *const path);
+bool benchDirScanStep(void *const ctx);                     // Returns false once the scan is done.
+u32 benchDirScanFinish(void *const ctx, u32 *const entries); // Returns the CRC of the sorted list.
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,32 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Pulls in the static table builder.
+#include "../../source/arm11/color_lut.c"
+#include "kernels.h"
+
+
+
+void benchMakeColorLut(const u8 profile, u32 *const lut)
+{
+	g_oafConfig.colorProfile = profile;
+
+	ColorLutTables t;
+	prepareTables(&t, getColorProfile());
+	for(u32 r = 0; r < COLOR_LUT_SLICES; r++) buildSlice(&t, lut, r);
+}
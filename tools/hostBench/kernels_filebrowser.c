@@ -0,0 +1,97 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Pulls in the static directory list code.
+#include "../../source/arm11/filebrowser.c"
+#include "arm11/crc32.h"
+#include "kernels.h"
+
+
+
+static u32 hashDirList(const DirList *const dList)
+{
+	u32 crc = 0;
+	for(u32 i = 0; i < dList->num; i++)
+		crc = crc32Update(crc, dList->ptrs[i], strlen(&dList->ptrs[i][1]) + 2);
+
+	return crc;
+}
+
+u32 benchSortEntries(const char *const *const names, const u32 num, const u32 runSize)
+{
+	DirList *const dList = dirListAlloc();
+	if(dList == NULL) return 0;
+
+	// Merged in runs like the background scan does.
+	static const u32 meta[2] = {0};
+	for(u32 i = 0; i < num; i++)
+	{
+		if(!dirListAdd(dList, meta, names[i][0] - '0', &names[i][1])) break;
+		if(dList->num - dList->sorted >= runSize) dirListMergeRun(dList);
+	}
+	dirListMergeRun(dList);
+
+	const u32 crc = hashDirList(dList);
+	dirListFree(dList);
+	freeChunkPool();
+
+	return crc;
+}
+
+typedef struct
+{
+	DirScan scan;
+	DirList *dList;
+} BenchDirScan;
+
+void* benchDirScanStart(const char *const path)
+{
+	BenchDirScan *const ctx = (BenchDirScan*)calloc(1, sizeof(BenchDirScan));
+	if(ctx == NULL) return NULL;
+
+	ctx->dList = dirListAlloc();
+	if(ctx->dList == NULL || dirScanStart(&ctx->scan, path, ctx->dList, ".gba") != RES_OK)
+	{
+		dirListFree(ctx->dList);
+		free(ctx);
+		return NULL;
+	}
+
+	return ctx;
+}
+
+bool benchDirScanStep(void *const ctx)
+{
+	DirScan *const scan = &((BenchDirScan*)ctx)->scan;
+	if(scan->active) dirScanStep(scan, SCAN_STEP_BLOCKS, 0xFFFFFFFFu);
+
+	return scan->active;
+}
+
+u32 benchDirScanFinish(void *const ctx, u32 *const entries)
+{
+	BenchDirScan *const c = (BenchDirScan*)ctx;
+	dirScanEnd(&c->scan);
+	*entries = c->dList->num;
+	const u32 crc = hashDirList(c->dList);
+	dirListFree(c->dList);
+	freeChunkPool();
+	free(c);
+
+	return crc;
+}
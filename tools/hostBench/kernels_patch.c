@@ -0,0 +1,33 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Pulls in the static patchers.
+#include "../../source/arm11/patch.c"
+#include "kernels.h"
+
+
+
+Result benchPatchIps(const FHandle f, u32 *const romSize)
+{
+	return patchIPS(f, romSize, NULL);
+}
+
+Result benchPatchUps(const FHandle f, u32 *const romSize)
+{
+	return patchUPS(f, romSize, NULL);
+}
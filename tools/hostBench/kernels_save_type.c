@@ -0,0 +1,42 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Pulls in the static gba_db.bin lookup.
+#include "../../source/arm11/save_type.c"
+#include "kernels.h"
+
+
+
+u16 benchDetectSaveType(const u32 romSize, const u32 loadStep)
+{
+	// Same calls as streamed ROM loading if loadStep is not 0.
+	SaveTypeScan scan;
+	saveTypeScanInit(&scan);
+	if(loadStep != 0)
+	{
+		for(u32 loaded = loadStep; loaded < romSize; loaded += loadStep)
+			saveTypeScanUpdate(&scan, loaded);
+	}
+
+	return detectSaveType(&scan, romSize, SAVE_TYPE_NONE);
+}
+
+Result benchSearchGbaDb(const u64 x, GbaDbEntry *const db)
+{
+	return searchGbaDb(x, db);
+}
@@ -16,9 +16,23 @@
  */
 
 #include <cstdio>
+#include <cstring>
 #include <cinttypes>
+#include <cmath>
 #include <exception>
 #include <memory>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <filesystem>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 #include "lodepng.h"
 
 
@@ -172,7 +186,8 @@ public:
 };
 
 
-static void scaleFrame(Pixel *buf, const ScalerParams &params)
+// Reference implementation. Slow but close to the hardware.
+static void scaleFrameRef(Pixel *buf, const ScalerParams &params)
 {
 	std::unique_ptr<Pixel[]> tmpBuf(new(std::nothrow) Pixel[512 * 512]);
 	const u16 oHight = params.oHight;
@@ -211,11 +226,271 @@ static void scaleFrame(Pixel *buf, const ScalerParams &params)
 	}
 }
 
+// Source pixel index and coefficient of each tap for one output pixel.
+typedef struct
+{
+	u16 src[6];
+	s16 coef[6];
+} Tap;
+
+// Same sequence of windows and coefficients as Scaler::calcPixel()/next().
+static void makeTaps(Tap *taps, u16 num, u16 lineLen, const s16 *matrix, u8 patt, u8 pattLen, u8 pattPos)
+{
+	s16 pos = 0;
+	for(u16 k = 0; k < num; k++)
+	{
+		for(u8 i = 0; i < 6; i++)
+		{
+			const s32 srcPos = pos - (5 - i);
+			if(srcPos <= 0)             taps[k].src[i] = 0;
+			else if(srcPos >= lineLen)  taps[k].src[i] = lineLen - 1;
+			else                        taps[k].src[i] = srcPos;
+			taps[k].coef[i] = matrix[pattPos + i * 8];
+		}
+
+		if(patt & 1u<<pattPos++)
+		{
+			if(pos == 0) pos = 3; // Hardware loads 3 more pixels after the first.
+			else         pos++;
+		}
+		if(pattPos == pattLen) pattPos = 0;
+	}
+}
+
+// out[j] = clamp(sum(rows[i][j] * coef[i])) / 0x4000 for 6 taps.
+// Clamping after the shift gives the same result as Scaler::calcPixel().
+static void tapKernel(const s16 *const rows[6], const s16 coef[6], s16 *out, u32 num) noexcept
+{
+	u32 j = 0;
+#if defined(__SSE2__)
+	const __m128i c01 = _mm_set1_epi32((u16)coef[0] | (u32)(u16)coef[1]<<16);
+	const __m128i c23 = _mm_set1_epi32((u16)coef[2] | (u32)(u16)coef[3]<<16);
+	const __m128i c45 = _mm_set1_epi32((u16)coef[4] | (u32)(u16)coef[5]<<16);
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i max = _mm_set1_epi16(255);
+	for(; j + 8 <= num; j += 8)
+	{
+		const __m128i r0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&rows[0][j]));
+		const __m128i r1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&rows[1][j]));
+		const __m128i r2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&rows[2][j]));
+		const __m128i r3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&rows[3][j]));
+		const __m128i r4 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&rows[4][j]));
+		const __m128i r5 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&rows[5][j]));
+
+		// Tap pairs are interleaved so madd does 2 taps per instruction.
+		__m128i lo = _mm_madd_epi16(_mm_unpacklo_epi16(r0, r1), c01);
+		lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(r2, r3), c23));
+		lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(r4, r5), c45));
+		__m128i hi = _mm_madd_epi16(_mm_unpackhi_epi16(r0, r1), c01);
+		hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(r2, r3), c23));
+		hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(r4, r5), c45));
+
+		__m128i res = _mm_packs_epi32(_mm_srai_epi32(lo, 14), _mm_srai_epi32(hi, 14));
+		res = _mm_min_epi16(_mm_max_epi16(res, zero), max);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(&out[j]), res);
+	}
+#elif defined(__ARM_NEON)
+	const int16x8_t zero = vdupq_n_s16(0);
+	const int16x8_t max = vdupq_n_s16(255);
+	for(; j + 8 <= num; j += 8)
+	{
+		int16x8_t r = vld1q_s16(&rows[0][j]);
+		int32x4_t lo = vmull_n_s16(vget_low_s16(r), coef[0]);
+		int32x4_t hi = vmull_n_s16(vget_high_s16(r), coef[0]);
+		for(u8 i = 1; i < 6; i++)
+		{
+			r = vld1q_s16(&rows[i][j]);
+			lo = vmlal_n_s16(lo, vget_low_s16(r), coef[i]);
+			hi = vmlal_n_s16(hi, vget_high_s16(r), coef[i]);
+		}
+
+		int16x8_t res = vcombine_s16(vqmovn_s32(vshrq_n_s32(lo, 14)), vqmovn_s32(vshrq_n_s32(hi, 14)));
+		res = vminq_s16(vmaxq_s16(res, zero), max);
+		vst1q_s16(&out[j], res);
+	}
+#endif
+
+	for(; j < num; j++)
+	{
+		s32 acc = 0;
+		for(u8 i = 0; i < 6; i++) acc += rows[i][j] * coef[i];
+
+		acc = (acc > 0x3FC000 ? 0x3FC000 : acc);
+		acc = (acc < 0 ? 0 : acc);
+		out[j] = acc / 0x4000;
+	}
+}
+
+// Runs fn(start, end) on up to threads parts of [0, num).
+template<typename F>
+static void parallelFor(u32 num, u32 threads, F fn)
+{
+	threads = (threads > num ? num : threads);
+	if(threads <= 1)
+	{
+		fn(0u, num);
+		return;
+	}
+
+	std::vector<std::thread> workers;
+	for(u32 t = 0; t < threads; t++)
+		workers.emplace_back(fn, num * t / threads, num * (t + 1) / threads);
+	for(auto &w : workers) w.join();
+}
+
+// Same output as scaleFrameRef() on planar 16 bit buffers. Every tap of both passes
+// reads one contiguous row of lanes so it's vectorized across pixels.
+// Horizontal pass: The input is transposed so lanes are input lines. The
+// pattern position carries over between lines (like Scaler::nextLine()). Lines with
+// the same start position share taps and are grouped into one lane span.
+// Vertical pass: Lanes are columns and all columns share the taps.
+class FastScaler final
+{
+	static constexpr u32 STRIDE = 512;
+
+	std::unique_ptr<s16[]> m_in;   // 3 planes [x][lane].
+	std::unique_ptr<s16[]> m_hOut; // 3 planes [w][lane].
+	std::unique_ptr<s16[]> m_vIn;  // 3 planes [y][w].
+	std::unique_ptr<Tap[]> m_hTaps; // [start pattern position][w].
+	std::unique_ptr<Tap[]> m_vTaps;
+	u16 m_lane[STRIDE];            // Lane of each input line.
+	u16 m_spans[9];                // Lanes of start pattern position p are m_spans[p] to m_spans[p + 1].
+
+
+	// Constructors
+	FastScaler(const FastScaler&) noexcept = delete; // Copy
+	FastScaler(FastScaler&&) noexcept = delete;      // Move
+
+	// Operators
+	FastScaler& operator =(const FastScaler&) noexcept = delete; // Copy
+	FastScaler& operator =(FastScaler&&) noexcept = delete;      // Move
+
+
+public:
+	// Constructors
+	FastScaler(void) noexcept
+	: m_in(new(std::nothrow) s16[3 * STRIDE * STRIDE]), m_hOut(new(std::nothrow) s16[3 * STRIDE * STRIDE]),
+	  m_vIn(new(std::nothrow) s16[3 * STRIDE * STRIDE]), m_hTaps(new(std::nothrow) Tap[8 * STRIDE]),
+	  m_vTaps(new(std::nothrow) Tap[STRIDE])
+	{
+	}
+
+	// Functions
+	bool valid(void) const noexcept
+	{
+		return m_in && m_hOut && m_vIn && m_hTaps && m_vTaps;
+	}
+
+	// in is RGBA8 with oWidth * oHight pixels. out gets width * hight pixels.
+	void scale(const u8 *in, u8 *out, const ScalerParams &params, u32 threads) noexcept
+	{
+		const u16 oWidth = params.oWidth;
+		const u16 oHight = params.oHight;
+		const u16 width  = params.width;
+		const u16 hight  = params.hight;
+		const u8 hLen    = params.hLen;
+
+		// Group input lines by the pattern position they start with.
+		u16 counts[9] = {};
+		for(u32 h = 0; h < oHight; h++) counts[(h * width) % hLen + 1]++;
+		for(u8 p = 0; p < 8; p++) counts[p + 1] += counts[p];
+		memcpy(m_spans, counts, sizeof(m_spans));
+		for(u32 h = 0; h < oHight; h++) m_lane[h] = counts[(h * width) % hLen]++;
+
+		for(u8 p = 0; p < hLen; p++)
+		{
+			if(m_spans[p] != m_spans[p + 1])
+				makeTaps(&m_hTaps[p * STRIDE], width, oWidth, params.hMatrix, params.hPatt, hLen, p);
+		}
+		makeTaps(m_vTaps.get(), hight, oHight, params.vMatrix, params.vPatt, params.vLen, 0);
+
+		// Deinterleave and transpose.
+		parallelFor(oHight, threads, [&](u32 start, u32 end)
+		{
+			for(u32 h = start; h < end; h++)
+			{
+				const u8 *src = &in[h * oWidth * 4];
+				const u32 lane = m_lane[h];
+				for(u32 x = 0; x < oWidth; x++, src += 4)
+				{
+					for(u32 c = 0; c < 3; c++) m_in[(c * STRIDE + x) * STRIDE + lane] = src[c];
+				}
+			}
+		});
+
+		// Horizontal pass.
+		parallelFor(width, threads, [&](u32 start, u32 end)
+		{
+			for(u32 w = start; w < end; w++)
+			{
+				for(u8 p = 0; p < hLen; p++)
+				{
+					const u32 spanStart = m_spans[p];
+					const u32 spanLen = m_spans[p + 1] - spanStart;
+					if(spanLen == 0) continue;
+
+					const Tap &tap = m_hTaps[p * STRIDE + w];
+					for(u32 c = 0; c < 3; c++)
+					{
+						const s16 *const plane = &m_in[c * STRIDE * STRIDE + spanStart];
+						const s16 *const rows[6] = {&plane[tap.src[0] * STRIDE], &plane[tap.src[1] * STRIDE],
+						                            &plane[tap.src[2] * STRIDE], &plane[tap.src[3] * STRIDE],
+						                            &plane[tap.src[4] * STRIDE], &plane[tap.src[5] * STRIDE]};
+						tapKernel(rows, tap.coef, &m_hOut[(c * STRIDE + w) * STRIDE + spanStart], spanLen);
+					}
+				}
+			}
+		});
+
+		// Back to line order with columns as lanes.
+		parallelFor(oHight, threads, [&](u32 start, u32 end)
+		{
+			for(u32 h = start; h < end; h++)
+			{
+				const u32 lane = m_lane[h];
+				for(u32 c = 0; c < 3; c++)
+				{
+					s16 *const dst = &m_vIn[(c * STRIDE + h) * STRIDE];
+					for(u32 w = 0; w < width; w++) dst[w] = m_hOut[(c * STRIDE + w) * STRIDE + lane];
+				}
+			}
+		});
+
+		// Vertical pass and interleave.
+		parallelFor(hight, threads, [&](u32 start, u32 end)
+		{
+			s16 line[3][STRIDE];
+			for(u32 y = start; y < end; y++)
+			{
+				const Tap &tap = m_vTaps[y];
+				for(u32 c = 0; c < 3; c++)
+				{
+					const s16 *const plane = &m_vIn[c * STRIDE * STRIDE];
+					const s16 *const rows[6] = {&plane[tap.src[0] * STRIDE], &plane[tap.src[1] * STRIDE],
+					                            &plane[tap.src[2] * STRIDE], &plane[tap.src[3] * STRIDE],
+					                            &plane[tap.src[4] * STRIDE], &plane[tap.src[5] * STRIDE]};
+					tapKernel(rows, tap.coef, line[c], width);
+				}
+
+				u8 *dst = &out[y * width * 4];
+				for(u32 w = 0; w < width; w++, dst += 4)
+				{
+					dst[0] = line[0][w];
+					dst[1] = line[1][w];
+					dst[2] = line[2][w];
+					dst[3] = 0xFFu;
+				}
+			}
+		});
+	}
+};
+
 // TODO: More validation.
 static bool parseMatrix(const char *const file, ScalerParams &params)
 {
 	char buf[1024] = {};
 	FILE *f = fopen(file, "r");
+	if(f == nullptr) return false;
 	fread(buf, 1023, 1, f);
 	fclose(f);
 
@@ -251,50 +526,575 @@ static bool parseMatrix(const char *const file, ScalerParams &params)
 	return true;
 }
 
-// Compile with "g++ -std=c++17 -s -flto -O2 -fstrict-aliasing -ffunction-sections -Wall -Wextra -I./lodepng -Wl,--gc-sections ./lodepng/lodepng.cpp ./lgyFbScaler.cpp -o ./lgyFbScaler"
-int main(int argc, char const *argv[])
+// Fills in the output size. Returns false if the hardware can't do it.
+static bool setOutputSize(ScalerParams &params)
+{
+	const float scaleX = (float)params.hLen / __builtin_popcount(params.hPatt);
+	const float scaleY = (float)params.vLen / __builtin_popcount(params.vPatt);
+	const u32 width = params.oWidth * scaleX;
+	const u32 hight = params.oHight * scaleY;
+	params.width = width;
+	params.hight = hight;
+
+	return params.hPatt != 0 && params.vPatt != 0 && width <= 512 && hight <= 512;
+}
+
+// Scales one image. verify also runs scaleFrameRef() and compares the results.
+static int scaleImage(FastScaler &scaler, const char *const inPath, const char *const outPath,
+                      const ScalerParams &matrix, u32 threads, bool verify, bool printSize)
 {
 	unsigned char *inBuf;
 	u32 oWidth, oHight;
 	u32 lpngErr;
-	if((lpngErr = lodepng_decode32_file(&inBuf, &oWidth, &oHight, argv[1])))
+	if((lpngErr = lodepng_decode32_file(&inBuf, &oWidth, &oHight, inPath)))
 	{
-		fprintf(stderr, "lodepng error: %s", lodepng_error_text(lpngErr));
+		fprintf(stderr, "%s: lodepng error: %s\n", inPath, lodepng_error_text(lpngErr));
 		return 1;
 	}
+	std::unique_ptr<unsigned char, decltype(&free)> inGuard(inBuf, free);
 
 	if(oWidth > 512 || oHight > 512)
 	{
-		fputs("Error: Input image too big.", stderr);
-		free(inBuf);
+		fprintf(stderr, "%s: Error: Input image too big.\n", inPath);
+		return 2;
+	}
+
+	ScalerParams params = matrix;
+	params.oWidth = oWidth;
+	params.oHight = oHight;
+	if(!setOutputSize(params))
+	{
+		fprintf(stderr, "%s: Error: Output image too big.\n", inPath);
 		return 2;
 	}
+	if(printSize)
+	{
+		printf("Output width: %" PRIu16 " (x%f)\nOutput hight: %" PRIu16 " (x%f)\n",
+		       params.width, (float)params.width / oWidth, params.hight, (float)params.hight / oHight);
+	}
+
+	std::unique_ptr<u8[]> outBuf(new(std::nothrow) u8[4 * params.width * params.hight]);
+	if(!outBuf)
+	{
+		fputs("Error: Out of memory.\n", stderr);
+		return 5;
+	}
+	scaler.scale(inBuf, outBuf.get(), params, threads);
+
+	if(verify)
+	{
+		std::unique_ptr<Pixel[]> refBuf(new(std::nothrow) Pixel[512 * 512]);
+		memcpy(refBuf.get(), inBuf, sizeof(Pixel) * oWidth * oHight);
+		scaleFrameRef(refBuf.get(), params);
+		if(memcmp(refBuf.get(), outBuf.get(), 4 * params.width * params.hight) != 0)
+		{
+			fprintf(stderr, "%s: Error: Output differs from the reference.\n", inPath);
+			return 6;
+		}
+	}
+
+	if((lpngErr = lodepng_encode32_file(outPath, outBuf.get(), params.width, params.hight)))
+	{
+		fprintf(stderr, "%s: lodepng error: %s\n", outPath, lodepng_error_text(lpngErr));
+		return 4;
+	}
+
+	return 0;
+}
+
+// Expands dirs to the *.png files in them.
+static bool collectImages(const char *const *paths, int num, std::vector<std::string> &out)
+{
+	namespace fs = std::filesystem;
+	try
+	{
+		for(int i = 0; i < num; i++)
+		{
+			if(!fs::is_directory(paths[i]))
+			{
+				out.emplace_back(paths[i]);
+				continue;
+			}
+
+			const size_t first = out.size();
+			for(const auto &ent : fs::directory_iterator(paths[i]))
+			{
+				if(ent.is_regular_file() && ent.path().extension() == ".png") out.emplace_back(ent.path().string());
+			}
+			std::sort(out.begin() + first, out.end());
+		}
+	}
+	catch(const fs::filesystem_error &e)
+	{
+		fprintf(stderr, "Error: %s\n", e.what());
+		return false;
+	}
+
+	return true;
+}
+
+struct TrainingImage
+{
+	std::unique_ptr<u8[]> in;
+	std::unique_ptr<u8[]> ref;
+	ScalerParams params;
+};
+
+static float lanczos3(float x)
+{
+	x = (x < 0 ? -x : x);
+	if(x < 1e-6f) return 1.f;
+	if(x >= 3.f) return 0.f;
+
+	const float pix = 3.14159265f * x;
+	return 3.f * sinf(pix) * sinf(pix / 3.f) / (pix * pix);
+}
+
+// Resamples one channel line by line. Samples are centered like the hardware output.
+static void lanczosPass(const float *in, u32 inLen, u32 inStep, u32 inLineStep, float *out, u32 outLen, u32 outStep,
+                        u32 outLineStep, u32 lines)
+{
+	const float scale = (float)inLen / outLen;
+	for(u32 o = 0; o < outLen; o++)
+	{
+		const float center = (o + 0.5f) * scale - 0.5f;
+		const s32 first = (s32)floorf(center) - 2;
+		float weights[6], sum = 0;
+		for(u32 k = 0; k < 6; k++) sum += (weights[k] = lanczos3(center - (first + (s32)k)));
+
+		for(u32 l = 0; l < lines; l++)
+		{
+			float acc = 0;
+			for(u32 k = 0; k < 6; k++)
+			{
+				s32 pos = first + k;
+				pos = (pos < 0 ? 0 : (pos >= (s32)inLen ? inLen - 1 : pos)); // Repeat edge pixels.
+				acc += in[l * inLineStep + pos * inStep] * weights[k];
+			}
+			out[l * outLineStep + o * outStep] = acc / sum;
+		}
+	}
+}
+
+// Reference upscale for training images without one.
+static void lanczosUpscale(const u8 *in, u32 w, u32 h, u8 *out, u32 ow, u32 oh)
+{
+	std::vector<float> src(w * h), tmp(ow * h), dst(ow * oh);
+	for(u32 c = 0; c < 3; c++)
+	{
+		for(u32 i = 0; i < w * h; i++) src[i] = in[i * 4 + c];
+		lanczosPass(src.data(), w, 1, w, tmp.data(), ow, 1, ow, h);
+		lanczosPass(tmp.data(), h, ow, 1, dst.data(), oh, ow, 1, ow);
+		for(u32 i = 0; i < ow * oh; i++)
+		{
+			const float v = dst[i] + 0.5f;
+			out[i * 4 + c] = (v < 0 ? 0 : (v > 255 ? 255 : (u8)v));
+		}
+	}
+	for(u32 i = 0; i < ow * oh; i++) out[i * 4 + 3] = 0xFFu;
+}
+
+static bool loadTrainingImage(const std::string &path, const char *const refDir, const ScalerParams &matrix, TrainingImage &img)
+{
+	unsigned char *buf;
+	u32 w, h, lpngErr;
+	if((lpngErr = lodepng_decode32_file(&buf, &w, &h, path.c_str())))
+	{
+		fprintf(stderr, "%s: lodepng error: %s\n", path.c_str(), lodepng_error_text(lpngErr));
+		return false;
+	}
+	std::unique_ptr<unsigned char, decltype(&free)> bufGuard(buf, free);
+
+	img.params = matrix;
+	img.params.oWidth = w;
+	img.params.oHight = h;
+	if(w > 512 || h > 512 || !setOutputSize(img.params))
+	{
+		fprintf(stderr, "%s: Error: Image too big.\n", path.c_str());
+		return false;
+	}
+	const u32 outSize = 4 * img.params.width * img.params.hight;
+	img.in.reset(new(std::nothrow) u8[4 * w * h]);
+	img.ref.reset(new(std::nothrow) u8[outSize]);
+	if(!img.in || !img.ref)
+	{
+		fputs("Error: Out of memory.\n", stderr);
+		return false;
+	}
+	memcpy(img.in.get(), buf, 4 * w * h);
+
+	if(refDir == nullptr)
+	{
+		lanczosUpscale(buf, w, h, img.ref.get(), img.params.width, img.params.hight);
+		return true;
+	}
+
+	// The reference has the same name and the output size.
+	const std::string refPath = (std::filesystem::path(refDir) / std::filesystem::path(path).filename()).string();
+	unsigned char *ref;
+	u32 rw, rh;
+	if((lpngErr = lodepng_decode32_file(&ref, &rw, &rh, refPath.c_str())))
+	{
+		fprintf(stderr, "%s: lodepng error: %s\n", refPath.c_str(), lodepng_error_text(lpngErr));
+		return false;
+	}
+	std::unique_ptr<unsigned char, decltype(&free)> refGuard(ref, free);
+	if(rw != img.params.width || rh != img.params.hight)
+	{
+		fprintf(stderr, "%s: Error: Reference must be %" PRIu16 "x%" PRIu16 ".\n", refPath.c_str(), img.params.width, img.params.hight);
+		return false;
+	}
+	memcpy(img.ref.get(), ref, outSize);
+
+	return true;
+}
+
+// Sum of squared RGB errors over all training images.
+class ErrorMetric final
+{
+	const std::vector<TrainingImage> &m_images;
+	std::vector<std::unique_ptr<FastScaler>> m_scalers;
+	std::vector<std::unique_ptr<u8[]>> m_outBufs;
+
+
+public:
+	ErrorMetric(const std::vector<TrainingImage> &images, u32 threads) : m_images(images)
+	{
+		threads = (threads > images.size() ? images.size() : threads);
+		for(u32 t = 0; t < threads; t++)
+		{
+			m_scalers.emplace_back(new(std::nothrow) FastScaler);
+			m_outBufs.emplace_back(new(std::nothrow) u8[4 * 512 * 512]);
+		}
+	}
+
+	bool valid(void) const noexcept
+	{
+		for(u32 t = 0; t < m_scalers.size(); t++)
+		{
+			if(!m_scalers[t] || !m_scalers[t]->valid() || !m_outBufs[t]) return false;
+		}
+
+		return !m_scalers.empty();
+	}
+
+	u64 pixels(void) const noexcept
+	{
+		u64 num = 0;
+		for(const auto &img : m_images) num += (u32)img.params.width * img.params.hight;
+
+		return num;
+	}
+
+	u64 operator ()(const ScalerParams &matrix)
+	{
+		const u32 threads = m_scalers.size();
+		std::vector<u64> errors(threads, 0);
+		parallelFor(threads, threads, [&](u32 start, u32 end)
+		{
+			for(u32 t = start; t < end; t++)
+			{
+				for(u32 i = t; i < m_images.size(); i += threads)
+				{
+					const TrainingImage &img = m_images[i];
+					ScalerParams params = matrix;
+					params.oWidth = img.params.oWidth;
+					params.oHight = img.params.oHight;
+					params.width  = img.params.width;
+					params.hight  = img.params.hight;
+
+					u8 *const out = m_outBufs[t].get();
+					m_scalers[t]->scale(img.in.get(), out, params, 1);
+
+					u64 err = 0;
+					const u32 size = 4 * params.width * params.hight;
+					for(u32 k = 0; k < size; k += 4)
+					{
+						for(u32 c = 0; c < 3; c++)
+						{
+							const s32 d = (s32)out[k + c] - img.ref[k + c];
+							err += d * d;
+						}
+					}
+					errors[t] += err;
+				}
+			}
+		});
+
+		u64 sum = 0;
+		for(u64 e : errors) sum += e;
+
+		return sum;
+	}
+};
+
+static double toPsnr(u64 err, u64 pixels)
+{
+	const double mse = (double)err / (pixels * 3);
+	return (mse > 0 ? 10 * log10(255.0 * 255.0 / mse) : 99.0);
+}
+
+// Coordinate descent over all coefficients the patterns use. Each coefficient is moved
+// by +-step while the error decreases. The step is halved down to 0x10 (bits 0-3 are not used).
+static void optimizeMatrix(ScalerParams &matrix, ErrorMetric &metric, u32 rounds)
+{
+	std::vector<s16*> coefs;
+	for(u8 row = 0; row < 6; row++)
+	{
+		for(u8 col = 0; col < matrix.vLen; col++) coefs.push_back(&matrix.vMatrix[row * 8 + col]);
+		for(u8 col = 0; col < matrix.hLen; col++) coefs.push_back(&matrix.hMatrix[row * 8 + col]);
+	}
+
+	const u64 pixels = metric.pixels();
+	u64 err = metric(matrix);
+	printf("Start: PSNR %.4f dB\n", toPsnr(err, pixels));
+	for(s32 step = 0x800; step >= 0x10; step /= 2)
+	{
+		bool improved = true;
+		for(u32 round = 0; round < rounds && improved; round++)
+		{
+			improved = false;
+			for(s16 *coef : coefs)
+			{
+				for(s32 dir = -1; dir <= 1; dir += 2)
+				{
+					// Keep going while it helps.
+					bool moved = false;
+					while(1)
+					{
+						const s16 old = *coef;
+						const s32 val = old + dir * step;
+						if(val < -0x8000 || val > 0x7FF0) break;
 
-	std::unique_ptr<Pixel[]> outBuf(new(std::nothrow) Pixel[512 * 512]);
-	memcpy(outBuf.get(), inBuf, sizeof(Pixel) * oWidth * oHight);
-	free(inBuf);
+						*coef = val;
+						const u64 newErr = metric(matrix);
+						if(newErr >= err)
+						{
+							*coef = old;
+							break;
+						}
+						err = newErr;
+						moved = true;
+					}
+					if(moved)
+					{
+						improved = true;
+						break;
+					}
+				}
+			}
+		}
+		printf("Step 0x%03" PRIX32 ": PSNR %.4f dB\n", (u32)step, toPsnr(err, pixels));
+	}
+}
 
-	static ScalerParams params = {(u16)oWidth, (u16)oHight};
-	if(!parseMatrix(argv[2], params))
+// Same layout as the hard-coded matrix in setupFrameCapture(). Vertical first.
+static bool writeMatrixBin(const char *const path, const ScalerParams &matrix)
+{
+	u8 buf[12 * 8 * 2];
+	for(u32 i = 0; i < 6 * 8; i++)
+	{
+		buf[i * 2]                  = (u16)matrix.vMatrix[i];
+		buf[i * 2 + 1]              = (u16)matrix.vMatrix[i]>>8;
+		buf[(6 * 8 + i) * 2]        = (u16)matrix.hMatrix[i];
+		buf[(6 * 8 + i) * 2 + 1]    = (u16)matrix.hMatrix[i]>>8;
+	}
+
+	FILE *f = fopen(path, "wb");
+	if(f == nullptr) return false;
+	const bool ok = fwrite(buf, sizeof(buf), 1, f) == 1;
+
+	return fclose(f) == 0 && ok;
+}
+
+// Prints the matrix in the matrix file format.
+static void printMatrix(const ScalerParams &matrix)
+{
+	for(u32 side = 0; side < 2; side++)
+	{
+		const u8 patt = (side == 0 ? matrix.hPatt : matrix.vPatt);
+		const u8 len  = (side == 0 ? matrix.hLen : matrix.vLen);
+		const s16 *const m = (side == 0 ? matrix.hMatrix : matrix.vMatrix);
+		for(s32 bit = len - 1; bit >= 0; bit--) putchar(patt & 1u<<bit ? '1' : '0');
+		printf(", %" PRIu8 ",\n", len);
+		for(u32 row = 0; row < 6; row++)
+		{
+			for(u32 col = 0; col < 8; col++)
+			{
+				const s16 v = m[row * 8 + col];
+				printf("%s0x%04X,%s", (v < 0 ? "-" : " "), (u32)(v < 0 ? -v : v), (col == 7 ? "\n" : " "));
+			}
+		}
+	}
+}
+
+static int optimize(const char *const outPath, const char *const matrixPath, const char *const refDir,
+                    const char *const *paths, int num, u32 threads, u32 rounds)
+{
+	static ScalerParams matrix = {};
+	if(!parseMatrix(matrixPath, matrix))
 	{
 		fputs("Failed to parse matrix file.", stderr);
 		return 3;
 	}
+	if(matrix.hPatt != 0b00011011 || matrix.hLen != 6 || matrix.vPatt != 0b00011011 || matrix.vLen != 6)
+		fputs("Warning: open_agb_firm uses the pattern 00011011 with length 6.\n", stderr);
 
-	const float scaleX = (float)params.hLen / __builtin_popcount(params.hPatt);
-	const float scaleY = (float)params.vLen / __builtin_popcount(params.vPatt);
-	params.width = oWidth * scaleX;
-	params.hight = oHight * scaleY;
-	printf("Output width: %" PRIu16 " (x%f)\nOutput hight: %" PRIu16 " (x%f)\n",
-	       params.width, scaleX, params.hight, scaleY);
+	std::vector<std::string> inputs;
+	if(!collectImages(paths, num, inputs)) return 3;
+	std::vector<TrainingImage> images(inputs.size());
+	for(size_t i = 0; i < inputs.size(); i++)
+	{
+		if(!loadTrainingImage(inputs[i], refDir, matrix, images[i])) return 1;
+	}
 
-	scaleFrame(outBuf.get(), params);
+	ErrorMetric metric(images, threads);
+	if(!metric.valid())
+	{
+		fputs("Error: No training images or out of memory.\n", stderr);
+		return 5;
+	}
 
-	if((lpngErr = lodepng_encode32_file(argv[3], reinterpret_cast<const unsigned char*>(outBuf.get()), params.width, params.hight)))
+	const auto start = std::chrono::steady_clock::now();
+	optimizeMatrix(matrix, metric, rounds);
+	const auto sec = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - start).count();
+	printf("Optimized over %zu images in %lld s.\n", images.size(), (long long)sec);
+
+	printMatrix(matrix);
+	if(!writeMatrixBin(outPath, matrix))
 	{
-		fprintf(stderr, "lodepng error: %s", lodepng_error_text(lpngErr));
+		fprintf(stderr, "Error: Failed to write '%s'.\n", outPath);
 		return 4;
 	}
 
 	return 0;
 }
+
+static void usage(const char *const name)
+{
+	fprintf(stderr, "Usage: %s [-j threads] [-v] <input.png> <matrix.txt> <output.png>\n"
+	                "       %s [-j threads] [-v] -o <output dir> <matrix.txt> <images and dirs...>\n"
+	                "       %s [-j threads] [-i rounds] [-r reference dir] -O <gba_scaler_matrix.bin> <start matrix.txt> <images and dirs...>\n"
+	                "  -j  Number of threads (default: all cores).\n"
+	                "  -v  Verify against the reference scaler.\n"
+	                "  -o  Batch mode. Dirs are searched for *.png files.\n"
+	                "  -O  Optimize the matrix coefficients for the training images.\n"
+	                "  -r  Reference upscales with the same names. Default: Lanczos-3 of each image.\n"
+	                "  -i  Maximum rounds per step size (default: 8).\n", name, name, name);
+}
+
+// Compile with "g++ -std=c++17 -s -flto -O2 -fstrict-aliasing -ffunction-sections -Wall -Wextra -pthread -I./lodepng -Wl,--gc-sections ./lodepng/lodepng.cpp ./lgyFbScaler.cpp -o ./lgyFbScaler"
+int main(int argc, char const *argv[])
+{
+	u32 threads = std::thread::hardware_concurrency();
+	bool verify = false;
+	const char *outDir = nullptr;
+	const char *optOut = nullptr;
+	const char *refDir = nullptr;
+	u32 rounds = 8;
+	int argPos = 1;
+	for(; argPos < argc && argv[argPos][0] == '-'; argPos++)
+	{
+		const char *const opt = argv[argPos];
+		if(strcmp(opt, "-j") == 0 && argPos + 1 < argc)      threads = strtoul(argv[++argPos], nullptr, 10);
+		else if(strcmp(opt, "-o") == 0 && argPos + 1 < argc) outDir = argv[++argPos];
+		else if(strcmp(opt, "-O") == 0 && argPos + 1 < argc) optOut = argv[++argPos];
+		else if(strcmp(opt, "-r") == 0 && argPos + 1 < argc) refDir = argv[++argPos];
+		else if(strcmp(opt, "-i") == 0 && argPos + 1 < argc) rounds = strtoul(argv[++argPos], nullptr, 10);
+		else if(strcmp(opt, "-v") == 0)                      verify = true;
+		else
+		{
+			usage(argv[0]);
+			return 3;
+		}
+	}
+	threads = (threads < 1 ? 1 : threads);
+
+	if(optOut != nullptr)
+	{
+		if(argc - argPos < 2)
+		{
+			usage(argv[0]);
+			return 3;
+		}
+		return optimize(optOut, argv[argPos], refDir, &argv[argPos + 1], argc - argPos - 1, threads, rounds);
+	}
+
+	static ScalerParams matrix = {};
+	if(outDir == nullptr)
+	{
+		if(argc - argPos != 3)
+		{
+			usage(argv[0]);
+			return 3;
+		}
+		if(!parseMatrix(argv[argPos + 1], matrix))
+		{
+			fputs("Failed to parse matrix file.", stderr);
+			return 3;
+		}
+
+		FastScaler scaler;
+		if(!scaler.valid())
+		{
+			fputs("Error: Out of memory.\n", stderr);
+			return 5;
+		}
+		return scaleImage(scaler, argv[argPos], argv[argPos + 2], matrix, threads, verify, true);
+	}
+
+	// Batch mode.
+	if(argc - argPos < 2)
+	{
+		usage(argv[0]);
+		return 3;
+	}
+	if(!parseMatrix(argv[argPos], matrix))
+	{
+		fputs("Failed to parse matrix file.", stderr);
+		return 3;
+	}
+
+	namespace fs = std::filesystem;
+	std::vector<std::string> inputs;
+	if(!collectImages(&argv[argPos + 1], argc - argPos - 1, inputs)) return 3;
+	try
+	{
+		fs::create_directories(outDir);
+	}
+	catch(const fs::filesystem_error &e)
+	{
+		fprintf(stderr, "Error: %s\n", e.what());
+		return 3;
+	}
+
+	// Images are spread over the threads. A single image is split by rows/columns instead.
+	const u32 workers = (inputs.size() < threads ? inputs.size() : threads);
+	const u32 threadsPerImage = (inputs.size() == 1 ? threads : 1);
+	std::atomic<u32> next(0), failed(0);
+	const auto start = std::chrono::steady_clock::now();
+	parallelFor(workers, workers, [&](u32, u32)
+	{
+		FastScaler scaler;
+		if(!scaler.valid())
+		{
+			fputs("Error: Out of memory.\n", stderr);
+			failed += inputs.size();
+			return;
+		}
+
+		u32 idx;
+		while((idx = next++) < inputs.size())
+		{
+			const std::string outPath = (fs::path(outDir) / fs::path(inputs[idx]).filename()).string();
+			if(scaleImage(scaler, inputs[idx].c_str(), outPath.c_str(), matrix, threadsPerImage, verify, false) != 0)
+				failed++;
+		}
+	});
+	const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+	printf("Scaled %zu images in %lld ms with %" PRIu32 " threads. %" PRIu32 " failed.\n",
+	       inputs.size() - failed, (long long)ms, workers, failed.load());
+
+	return (failed != 0 ? 7 : 0);
+}